@@ -0,0 +1,77 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ANNOTATION_CACHE_H_20201016_
+#define ANNOTATION_CACHE_H_20201016_
+
+#include "API.h"
+#include "Types.h"
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <functional>
+
+// Remembers the descriptions that the views show next to addresses, things
+// like "ASCII "hello"" or "return to 0x401000 <main>". Working those out reads
+// the debuggee, so it doesn't happen while painting: a lookup which misses
+// queues the address and returns what it was described as at the previous
+// stop (or nothing), and the queue is worked through from the event loop,
+// after which updated() is emitted so that the views can paint again.
+// Entries only describe the debuggee as it is now, so invalidate() should be
+// called whenever it may have changed. Not thread safe.
+class EDB_EXPORT AnnotationCache : public QObject {
+	Q_OBJECT
+
+public:
+	static constexpr int MaxEntries = 0x10000;
+
+public:
+	enum class Kind {
+		String,  // a string at the address
+		Pointer, // what the address is, for pointer sized values
+	};
+
+	using Resolver = std::function<QString(edb::address_t)>;
+
+public:
+	explicit AnnotationCache(QObject *parent = nullptr);
+	AnnotationCache(const AnnotationCache &) = delete;
+	AnnotationCache &operator=(const AnnotationCache &) = delete;
+	~AnnotationCache() override                         = default;
+
+public:
+	QString find(Kind kind, edb::address_t address, const Resolver &resolver);
+	void invalidate();
+	void clear();
+
+Q_SIGNALS:
+	void updated();
+
+private:
+	void resolvePending();
+
+private:
+	static constexpr int KindCount = 2;
+
+	QHash<edb::address_t, QString> entries_[KindCount];
+	QHash<edb::address_t, QString> previous_[KindCount];
+	QHash<edb::address_t, Resolver> pending_[KindCount];
+	bool scheduled_ = false;
+};
+
+#endif
@@ -20,23 +20,39 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define BASIC_BLOCK_H_20130830_
 
 #include "API.h"
+#include "Instruction.h"
 #include "Types.h"
+#include <cstdint>
 #include <iterator>
-#include <memory>
 #include <vector>
 
 class QString;
 
-using instruction_pointer = std::shared_ptr<edb::Instruction>;
+// an analysis can produce millions of these, so rather than keeping a fully
+// decoded instruction, a block only keeps its address and bytes.
+// decode() recreates the instruction when the operands are needed
+class EDB_EXPORT InstructionRecord {
+public:
+	InstructionRecord() = default;
+	explicit InstructionRecord(const edb::Instruction &inst);
+
+public:
+	edb::Instruction decode() const;
+
+public:
+	edb::address_t address                   = 0;
+	uint8_t size                             = 0;
+	uint8_t bytes[edb::Instruction::MaxSize] = {};
+};
 
 class EDB_EXPORT BasicBlock {
 public:
 	using size_type              = size_t;
-	using value_type             = instruction_pointer;
-	using reference              = instruction_pointer &;
-	using const_reference        = const instruction_pointer &;
-	using iterator               = std::vector<instruction_pointer>::iterator;
-	using const_iterator         = std::vector<instruction_pointer>::const_iterator;
+	using value_type             = InstructionRecord;
+	using reference              = InstructionRecord &;
+	using const_reference        = const InstructionRecord &;
+	using iterator               = std::vector<InstructionRecord>::iterator;
+	using const_iterator         = std::vector<InstructionRecord>::const_iterator;
 	using reverse_iterator       = std::reverse_iterator<iterator>;
 	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
@@ -49,7 +65,7 @@ public:
 	~BasicBlock()                           = default;
 
 public:
-	void push_back(const instruction_pointer &inst);
+	void push_back(const InstructionRecord &inst);
 	void addReference(edb::address_t refsite, edb::address_t target);
 
 public:
@@ -90,7 +106,7 @@ public:
 	edb::address_t lastAddress() const;
 
 private:
-	std::vector<instruction_pointer> instructions_;
+	std::vector<InstructionRecord> instructions_;
 	std::vector<std::pair<edb::address_t, edb::address_t>> references_;
 };
 
@@ -0,0 +1,80 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BYTE_PATTERN_H_20201016_
+#define BYTE_PATTERN_H_20201016_
+
+#include "API.h"
+#include "Status.h"
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QString>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A fixed length sequence of bytes where every position may match more than
+// one value. Patterns are written as whitespace separated bytes, for example:
+//
+//   48 8B ?? ?? 00 00 E8     "??" (or "?") matches any byte
+//   4? 8B C?                 "?" in place of a hex digit matches any nibble
+//   (48|49|4C) 8B            matches any one of the listed bytes
+//
+// The matcher anchors its search on the position that is least likely to
+// appear by chance and only checks the remaining positions on a hit.
+class EDB_EXPORT BytePattern {
+	Q_DECLARE_TR_FUNCTIONS(BytePattern)
+
+public:
+	static Result<BytePattern, QString> compile(const QString &pattern);
+	static BytePattern fromBytes(const QByteArray &bytes);
+
+public:
+	BytePattern()                    = default;
+	BytePattern(const BytePattern &) = default;
+	BytePattern &operator=(const BytePattern &) = default;
+	BytePattern(BytePattern &&)                 = default;
+	BytePattern &operator=(BytePattern &&) = default;
+
+public:
+	std::size_t size() const { return size_; }
+	bool isEmpty() const { return size_ == 0; }
+
+public:
+	bool matches(const uint8_t *p) const;
+	const uint8_t *find(const uint8_t *first, const uint8_t *last) const;
+
+private:
+	bool accepts(std::size_t position, uint8_t value) const { return table_[position * 256 + value] != 0; }
+	void prepare();
+
+private:
+	std::size_t size_ = 0;
+
+	// 256 entries per position, non-zero if that byte value is allowed there
+	std::vector<uint8_t> table_;
+
+	// the position we search for first, and its value if only one is allowed
+	std::size_t anchor_ = 0;
+	int anchorByte_     = -1;
+
+	// the positions to check after the anchor matched, most selective first
+	std::vector<std::size_t> order_;
+};
+
+#endif
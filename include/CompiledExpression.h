@@ -0,0 +1,118 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COMPILED_EXPRESSION_H_20201016_
+#define COMPILED_EXPRESSION_H_20201016_
+
+#include "API.h"
+#include "Expression.h"
+#include "Status.h"
+#include "Types.h"
+#include <QString>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+class State;
+
+// An expression in the same language as Expression<T>, parsed once into a
+// small stack machine program so that it can be evaluated repeatedly, for
+// example every time a conditional breakpoint is hit. Variables are resolved
+// when the expression is compiled, either to a constant (such as a symbol's
+// address) or to a register which is read from a State at evaluation time.
+class EDB_EXPORT CompiledExpression {
+public:
+	struct Variable {
+		enum Kind : uint8_t {
+			Constant,
+			GpRegister,
+			InstructionPointer,
+			Flags,
+			NamedRegister,
+		};
+
+		Kind kind            = Constant;
+		edb::address_t value = 0; // the constant, or the index of a GpRegister
+		QString name;             // the name of a NamedRegister
+	};
+
+public:
+	using VariableResolver = std::function<std::optional<Variable>(const QString &name, ExpressionError *error)>;
+	using MemoryReader     = std::function<edb::address_t(edb::address_t address, bool *ok, ExpressionError *error)>;
+	using RegisterReader   = std::function<edb::address_t(const Variable &variable, bool *ok, ExpressionError *error)>;
+
+public:
+	static Result<CompiledExpression, ExpressionError> compile(const QString &expression, const VariableResolver &resolver);
+
+public:
+	CompiledExpression()                           = default;
+	CompiledExpression(const CompiledExpression &) = default;
+	CompiledExpression &operator=(const CompiledExpression &) = default;
+	CompiledExpression(CompiledExpression &&)                 = default;
+	CompiledExpression &operator=(CompiledExpression &&) = default;
+
+public:
+	Result<edb::address_t, ExpressionError> evaluate(const State &state, const MemoryReader &reader) const;
+	Result<edb::address_t, ExpressionError> evaluate(const RegisterReader &registers, const MemoryReader &reader) const;
+
+private:
+	enum class Opcode : uint8_t {
+		Push,
+		Load,
+		Deref,
+		Negate,
+		Complement,
+		Not,
+		And,
+		Or,
+		Xor,
+		LogicalAnd,
+		LogicalOr,
+		ShiftLeft,
+		ShiftRight,
+		Add,
+		Subtract,
+		Multiply,
+		Divide,
+		Modulo,
+		Less,
+		LessEqual,
+		Greater,
+		GreaterEqual,
+		Equal,
+		NotEqual,
+	};
+
+	struct Instruction {
+		Opcode opcode;
+		uint64_t operand; // the constant for Push, the variable index for Load
+	};
+
+	friend class ExpressionCompiler;
+
+	template <class Load>
+	Result<edb::address_t, ExpressionError> run(Load load, const MemoryReader &reader) const;
+
+private:
+	std::vector<Instruction> program_;
+	std::vector<Variable> variables_;
+	std::size_t stackDepth_ = 0;
+};
+
+#endif
@@ -77,70 +77,82 @@ private:
 	ErrorMessage error_ = None;
 };
 
-template <class T>
-class Expression {
-public:
-	using variable_getter_t = std::function<T(const QString &, bool *, ExpressionError *)>;
-	using memoryReader_t    = std::function<T(T, bool *, ExpressionError *)>;
+struct ExpressionToken {
+	ExpressionToken()                             = default;
+	ExpressionToken(const ExpressionToken &other) = default;
+
+	enum Operator {
+		NONE,
+		AND,
+		OR,
+		XOR,
+		LSHFT,
+		RSHFT,
+		PLUS,
+		MINUS,
+		MUL,
+		DIV,
+		MOD,
+		CMP,
+		LPAREN,
+		RPAREN,
+		LBRACE,
+		RBRACE,
+		NOT,
+		LT,
+		LE,
+		GT,
+		GE,
+		EQ,
+		NE,
+		LOGICAL_AND,
+		LOGICAL_OR
+	};
 
-public:
-	Expression(const QString &s, variable_getter_t vg, memoryReader_t mr);
-	~Expression() = default;
+	enum Type {
+		UNKNOWN,
+		OPERATOR,
+		NUMBER,
+		VARIABLE
+	};
 
-private:
-	struct Token {
-		Token()                   = default;
-		Token(const Token &other) = default;
-
-		enum Operator {
-			NONE,
-			AND,
-			OR,
-			XOR,
-			LSHFT,
-			RSHFT,
-			PLUS,
-			MINUS,
-			MUL,
-			DIV,
-			MOD,
-			CMP,
-			LPAREN,
-			RPAREN,
-			LBRACE,
-			RBRACE,
-			NOT,
-			LT,
-			LE,
-			GT,
-			GE,
-			EQ,
-			NE,
-			LOGICAL_AND,
-			LOGICAL_OR
-		};
-
-		enum Type {
-			UNKNOWN,
-			OPERATOR,
-			NUMBER,
-			VARIABLE
-		};
-
-		void set(const QString &data, Operator oper, Type type) {
-			data_     = data;
-			operator_ = oper;
-			type_     = type;
-		}
+	void set(const QString &data, Operator oper, Type type) {
+		data_     = data;
+		operator_ = oper;
+		type_     = type;
+	}
 
-		QString data_;
-		Operator operator_ = NONE;
-		Type type_         = UNKNOWN;
-	};
+	QString data_;
+	Operator operator_ = NONE;
+	Type type_         = UNKNOWN;
+};
 
-private:
-	T evalInternal() {
-		T result;
+// The tokenizer and grammar of the expression language. What is done at each
+// node of the parse is up to <Actions>, which provides a value_type and:
+//
+//     value_type number(quint64 value);
+//     value_type variable(const QString &name);
+//     value_type dereference(const value_type &address);
+//     value_type unary(ExpressionToken::Operator op, const value_type &value);
+//     value_type binary(ExpressionToken::Operator op, const value_type &lhs, const value_type &rhs);
+//
+// any of which may throw an ExpressionError. Expression<T> computes a value,
+// CompiledExpression emits code.
+template <class Actions>
+class ExpressionParser {
+public:
+	using Token      = ExpressionToken;
+	using value_type = typename Actions::value_type;
+
+public:
+	ExpressionParser(const QString &s, Actions *actions);
+	ExpressionParser(const ExpressionParser &) = delete;
+	ExpressionParser &operator=(const ExpressionParser &) = delete;
+	~ExpressionParser()                                   = default;
+
+public:
+	value_type parse() {
+		value_type result;
 
 		getToken();
 		evalExp(result);
@@ -148,32 +160,59 @@ private:
 		return result;
 	}
 
+private:
+	void evalExp(value_type &result);
+	void evalExp0(value_type &result);
+	void evalExp1(value_type &result);
+	void evalExp2(value_type &result);
+	void evalExp3(value_type &result);
+	void evalExp4(value_type &result);
+	void evalExp5(value_type &result);
+	void evalExp6(value_type &result);
+	void evalExp7(value_type &result);
+	void evalAtom(value_type &result);
+	void getToken();
+
+private:
+	QString expression_;
+	QString::const_iterator expressionPtr_;
+	Token token_;
+	Actions *actions_;
+};
+
+template <class T>
+class Expression {
+	friend class ExpressionParser<Expression>;
+
+public:
+	using variable_getter_t = std::function<T(const QString &, bool *, ExpressionError *)>;
+	using memoryReader_t    = std::function<T(T, bool *, ExpressionError *)>;
+
+public:
+	Expression(const QString &s, variable_getter_t vg, memoryReader_t mr);
+	~Expression() = default;
+
 public:
 	Result<T, ExpressionError> evaluate() noexcept {
 		try {
-			return evalInternal();
+			ExpressionParser<Expression> parser(expression_, this);
+			return parser.parse();
 		} catch (const ExpressionError &e) {
 			return make_unexpected(e);
 		}
 	}
 
 private:
-	void evalExp(T &result);
-	void evalExp0(T &result);
-	void evalExp1(T &result);
-	void evalExp2(T &result);
-	void evalExp3(T &result);
-	void evalExp4(T &result);
-	void evalExp5(T &result);
-	void evalExp6(T &result);
-	void evalExp7(T &result);
-	void evalAtom(T &result);
-	void getToken();
+	using value_type = T;
+
+	T number(quint64 value);
+	T variable(const QString &name);
+	T dereference(const T &address);
+	T unary(ExpressionToken::Operator op, T value);
+	T binary(ExpressionToken::Operator op, T lhs, const T &rhs);
 
 private:
 	QString expression_;
-	QString::const_iterator expressionPtr_;
-	Token token_;
 	variable_getter_t variableReader_;
 	memoryReader_t memoryReader_;
 };
@@ -28,20 +28,20 @@ inline bool is_delim(QChar ch) {
 }
 
 //------------------------------------------------------------------------------
-// Name: Expression
+// Name: ExpressionParser
 // Desc:
 //------------------------------------------------------------------------------
-template <class T>
-Expression<T>::Expression(const QString &s, variable_getter_t vg, memoryReader_t mr)
-	: expression_(s), expressionPtr_(expression_.begin()), variableReader_(vg), memoryReader_(mr) {
+template <class Actions>
+ExpressionParser<Actions>::ExpressionParser(const QString &s, Actions *actions)
+	: expression_(s), expressionPtr_(expression_.begin()), actions_(actions) {
 }
 
 //------------------------------------------------------------------------------
 // Name: evalExp
 // Desc: private entry point with sanity check
 //------------------------------------------------------------------------------
-template <class T>
-void Expression<T>::evalExp(T &result) {
+template <class Actions>
+void ExpressionParser<Actions>::evalExp(value_type &result) {
 	if (token_.type_ == Token::UNKNOWN) {
 		throw ExpressionError(ExpressionError::Syntax);
 	}
@@ -73,27 +73,16 @@ void Expression<T>::evalExp(T &result) {
 // Name: evalExp0
 // Desc: logic
 //------------------------------------------------------------------------------
-template <class T>
-void Expression<T>::evalExp0(T &result) {
+template <class Actions>
+void ExpressionParser<Actions>::evalExp0(value_type &result) {
 	evalExp1(result);
 
 	for (Token op = token_; op.operator_ == Token::LOGICAL_AND || op.operator_ == Token::LOGICAL_OR; op = token_) {
-		T partial_value;
+		value_type partial_value;
 
 		getToken();
 		evalExp1(partial_value);
-
-		// add or subtract
-		switch (op.operator_) {
-		case Token::LOGICAL_AND:
-			result = result && partial_value;
-			break;
-		case Token::LOGICAL_OR:
-			result = result || partial_value;
-			break;
-		default:
-			break;
-		}
+		result = actions_->binary(op.operator_, result, partial_value);
 	}
 }
 
@@ -101,30 +90,16 @@ void Expression<T>::evalExp0(T &result) {
 // Name: evalExp1
 // Desc: binary logic
 //------------------------------------------------------------------------------
-template <class T>
-void Expression<T>::evalExp1(T &result) {
+template <class Actions>
+void ExpressionParser<Actions>::evalExp1(value_type &result) {
 	evalExp2(result);
 
 	for (Token op = token_; op.operator_ == Token::AND || op.operator_ == Token::OR || op.operator_ == Token::XOR; op = token_) {
-		T partial_value;
+		value_type partial_value;
 
 		getToken();
 		evalExp2(partial_value);
-
-		// add or subtract
-		switch (op.operator_) {
-		case Token::AND:
-			result &= partial_value;
-			break;
-		case Token::OR:
-			result |= partial_value;
-			break;
-		case Token::XOR:
-			result ^= partial_value;
-			break;
-		default:
-			break;
-		}
+		result = actions_->binary(op.operator_, result, partial_value);
 	}
 }
 
@@ -132,39 +107,16 @@ void Expression<T>::evalExp1(T &result) {
 // Name: evalExp2
 // Desc: comparisons
 //------------------------------------------------------------------------------
-template <class T>
-void Expression<T>::evalExp2(T &result) {
+template <class Actions>
+void ExpressionParser<Actions>::evalExp2(value_type &result) {
 	evalExp3(result);
 
 	for (Token op = token_; op.operator_ == Token::LT || op.operator_ == Token::LE || op.operator_ == Token::GT || op.operator_ == Token::GE || op.operator_ == Token::EQ || op.operator_ == Token::NE; op = token_) {
-		T partial_value;
+		value_type partial_value;
 
 		getToken();
 		evalExp3(partial_value);
-
-		// perform the relational operation
-		switch (op.operator_) {
-		case Token::LT:
-			result = result < partial_value;
-			break;
-		case Token::LE:
-			result = result <= partial_value;
-			break;
-		case Token::GT:
-			result = result > partial_value;
-			break;
-		case Token::GE:
-			result = result >= partial_value;
-			break;
-		case Token::EQ:
-			result = result == partial_value;
-			break;
-		case Token::NE:
-			result = result != partial_value;
-			break;
-		default:
-			break;
-		}
+		result = actions_->binary(op.operator_, result, partial_value);
 	}
 }
 
@@ -172,27 +124,16 @@ void Expression<T>::evalExp2(T &result) {
 // Name: evalExp3
 // Desc: shifts
 //------------------------------------------------------------------------------
-template <class T>
-void Expression<T>::evalExp3(T &result) {
+template <class Actions>
+void ExpressionParser<Actions>::evalExp3(value_type &result) {
 	evalExp4(result);
 
 	for (Token op = token_; op.operator_ == Token::RSHFT || op.operator_ == Token::LSHFT; op = token_) {
-		T partial_value;
+		value_type partial_value;
 
 		getToken();
 		evalExp4(partial_value);
-
-		// perform the shift operation
-		switch (op.operator_) {
-		case Token::LSHFT:
-			result <<= partial_value;
-			break;
-		case Token::RSHFT:
-			result >>= partial_value;
-			break;
-		default:
-			break;
-		}
+		result = actions_->binary(op.operator_, result, partial_value);
 	}
 }
 
@@ -200,35 +141,16 @@ void Expression<T>::evalExp3(T &result) {
 // Name: evalExp4
 // Desc: addition/subtraction
 //------------------------------------------------------------------------------
-template <class T>
-void Expression<T>::evalExp4(T &result) {
+template <class Actions>
+void ExpressionParser<Actions>::evalExp4(value_type &result) {
 	evalExp5(result);
 
 	for (Token op = token_; op.operator_ == Token::PLUS || op.operator_ == Token::MINUS; op = token_) {
-		T partial_value;
+		value_type partial_value;
 
 		getToken();
 		evalExp5(partial_value);
-
-		// add or subtract
-		switch (op.operator_) {
-		case Token::PLUS:
-			result += partial_value;
-			break;
-		case Token::MINUS:
-#ifdef _MSC_VER
-#pragma warning(push)
-/* disable warning about applying unary - to an unsigned type */
-#pragma warning(disable : 4146)
-#endif
-			result -= partial_value;
-#ifdef _MSC_VER
-#pragma warning(pop)
-#endif
-			break;
-		default:
-			break;
-		}
+		result = actions_->binary(op.operator_, result, partial_value);
 	}
 }
 
@@ -236,36 +158,16 @@ void Expression<T>::evalExp4(T &result) {
 // Name: evalExp5
 // Desc: multiplication/division
 //------------------------------------------------------------------------------
-template <class T>
-void Expression<T>::evalExp5(T &result) {
+template <class Actions>
+void ExpressionParser<Actions>::evalExp5(value_type &result) {
 	evalExp6(result);
 
 	for (Token op = token_; op.operator_ == Token::MUL || op.operator_ == Token::DIV || op.operator_ == Token::MOD; op = token_) {
-		T partial_value;
+		value_type partial_value;
 
 		getToken();
 		evalExp6(partial_value);
-
-		// mul, div, or modulus
-		switch (op.operator_) {
-		case Token::MUL:
-			result *= partial_value;
-			break;
-		case Token::DIV:
-			if (partial_value == 0) {
-				throw ExpressionError(ExpressionError::DivideByZero);
-			}
-			result /= partial_value;
-			break;
-		case Token::MOD:
-			if (partial_value == 0) {
-				throw ExpressionError(ExpressionError::DivideByZero);
-			}
-			result %= partial_value;
-			break;
-		default:
-			break;
-		}
+		result = actions_->binary(op.operator_, result, partial_value);
 	}
 }
 
@@ -273,8 +175,8 @@ void Expression<T>::evalExp5(T &result) {
 // Name: evalExp6
 // Desc: unary expressions
 //------------------------------------------------------------------------------
-template <class T>
-void Expression<T>::evalExp6(T &result) {
+template <class Actions>
+void ExpressionParser<Actions>::evalExp6(value_type &result) {
 
 	Token op = token_;
 	if (op.operator_ == Token::PLUS || op.operator_ == Token::MINUS || op.operator_ == Token::CMP || op.operator_ == Token::NOT) {
@@ -285,25 +187,10 @@ void Expression<T>::evalExp6(T &result) {
 
 	switch (op.operator_) {
 	case Token::PLUS:
-		// this may seems like a waste, but unary + can be overloaded for a type
-		// to have a non-nop effect!
-		result = +result;
-		break;
 	case Token::MINUS:
-#ifdef _MSC_VER
-#pragma warning(push)
-#pragma warning(disable : 4146)
-#endif
-		result = -result;
-#ifdef _MSC_VER
-#pragma warning(pop)
-#endif
-		break;
 	case Token::CMP:
-		result = ~result;
-		break;
 	case Token::NOT:
-		result = !result;
+		result = actions_->unary(op.operator_, result);
 		break;
 	default:
 		break;
@@ -314,8 +201,8 @@ void Expression<T>::evalExp6(T &result) {
 // Name: evalExp7
 // Desc: sub-expressions
 //------------------------------------------------------------------------------
-template <class T>
-void Expression<T>::evalExp7(T &result) {
+template <class Actions>
+void ExpressionParser<Actions>::evalExp7(value_type &result) {
 
 	switch (token_.operator_) {
 	case Token::LPAREN:
@@ -338,20 +225,10 @@ void Expression<T>::evalExp7(T &result) {
 			getToken();
 
 			// get sub-expression
-			T effective_address;
+			value_type effective_address;
 			evalExp0(effective_address);
 
-			if (memoryReader_) {
-				bool ok;
-				ExpressionError error;
-
-				result = memoryReader_(effective_address, &ok, &error);
-				if (!ok) {
-					throw error;
-				}
-			} else {
-				throw ExpressionError(ExpressionError::CannotReadMemory);
-			}
+			result = actions_->dereference(effective_address);
 
 			if (token_.operator_ != Token::RBRACE) {
 				throw ExpressionError(ExpressionError::UnbalancedBraces);
@@ -373,31 +250,24 @@ void Expression<T>::evalExp7(T &result) {
 // Name: evalAtom
 // Desc: atoms (variables/constants)
 //------------------------------------------------------------------------------
-template <class T>
-void Expression<T>::evalAtom(T &result) {
+template <class Actions>
+void ExpressionParser<Actions>::evalAtom(value_type &result) {
 
 	switch (token_.type_) {
 	case Token::VARIABLE:
-		if (variableReader_) {
-			bool ok;
-			ExpressionError error;
-			result = variableReader_(token_.data_, &ok, &error);
-			if (!ok) {
-				throw error;
-			}
-		} else {
-			throw ExpressionError(ExpressionError::UnknownVariable);
-		}
+		result = actions_->variable(token_.data_);
 		getToken();
 		break;
-	case Token::NUMBER:
+	case Token::NUMBER: {
 		bool ok;
-		result = token_.data_.toULongLong(&ok, 0);
+		const quint64 value = token_.data_.toULongLong(&ok, 0);
 		if (!ok) {
 			throw ExpressionError(ExpressionError::InvalidNumber);
 		}
+		result = actions_->number(value);
 		getToken();
 		break;
+	}
 	default:
 		throw ExpressionError(ExpressionError::Syntax);
 		break;
@@ -408,8 +278,8 @@ void Expression<T>::evalAtom(T &result) {
 // Name: getToken
 // Desc:
 //------------------------------------------------------------------------------
-template <class T>
-void Expression<T>::getToken() {
+template <class Actions>
+void ExpressionParser<Actions>::getToken() {
 
 	// clear previous token
 	token_ = Token();
@@ -576,4 +446,179 @@ void Expression<T>::getToken() {
 	}
 }
 
+//------------------------------------------------------------------------------
+// Name: Expression
+// Desc:
+//------------------------------------------------------------------------------
+template <class T>
+Expression<T>::Expression(const QString &s, variable_getter_t vg, memoryReader_t mr)
+	: expression_(s), variableReader_(vg), memoryReader_(mr) {
+}
+
+//------------------------------------------------------------------------------
+// Name: number
+// Desc:
+//------------------------------------------------------------------------------
+template <class T>
+T Expression<T>::number(quint64 value) {
+	return T(value);
+}
+
+//------------------------------------------------------------------------------
+// Name: variable
+// Desc:
+//------------------------------------------------------------------------------
+template <class T>
+T Expression<T>::variable(const QString &name) {
+	if (!variableReader_) {
+		throw ExpressionError(ExpressionError::UnknownVariable);
+	}
+
+	bool ok;
+	ExpressionError error;
+	const T result = variableReader_(name, &ok, &error);
+	if (!ok) {
+		throw error;
+	}
+
+	return result;
+}
+
+//------------------------------------------------------------------------------
+// Name: dereference
+// Desc:
+//------------------------------------------------------------------------------
+template <class T>
+T Expression<T>::dereference(const T &address) {
+	if (!memoryReader_) {
+		throw ExpressionError(ExpressionError::CannotReadMemory);
+	}
+
+	bool ok;
+	ExpressionError error;
+	const T result = memoryReader_(address, &ok, &error);
+	if (!ok) {
+		throw error;
+	}
+
+	return result;
+}
+
+//------------------------------------------------------------------------------
+// Name: unary
+// Desc:
+//------------------------------------------------------------------------------
+template <class T>
+T Expression<T>::unary(ExpressionToken::Operator op, T value) {
+	switch (op) {
+	case ExpressionToken::PLUS:
+		// this may seems like a waste, but unary + can be overloaded for a type
+		// to have a non-nop effect!
+		value = +value;
+		break;
+	case ExpressionToken::MINUS:
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4146)
+#endif
+		value = -value;
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+		break;
+	case ExpressionToken::CMP:
+		value = ~value;
+		break;
+	case ExpressionToken::NOT:
+		value = !value;
+		break;
+	default:
+		break;
+	}
+
+	return value;
+}
+
+//------------------------------------------------------------------------------
+// Name: binary
+// Desc:
+//------------------------------------------------------------------------------
+template <class T>
+T Expression<T>::binary(ExpressionToken::Operator op, T lhs, const T &rhs) {
+	switch (op) {
+	case ExpressionToken::LOGICAL_AND:
+		lhs = lhs && rhs;
+		break;
+	case ExpressionToken::LOGICAL_OR:
+		lhs = lhs || rhs;
+		break;
+	case ExpressionToken::AND:
+		lhs &= rhs;
+		break;
+	case ExpressionToken::OR:
+		lhs |= rhs;
+		break;
+	case ExpressionToken::XOR:
+		lhs ^= rhs;
+		break;
+	case ExpressionToken::LT:
+		lhs = lhs < rhs;
+		break;
+	case ExpressionToken::LE:
+		lhs = lhs <= rhs;
+		break;
+	case ExpressionToken::GT:
+		lhs = lhs > rhs;
+		break;
+	case ExpressionToken::GE:
+		lhs = lhs >= rhs;
+		break;
+	case ExpressionToken::EQ:
+		lhs = lhs == rhs;
+		break;
+	case ExpressionToken::NE:
+		lhs = lhs != rhs;
+		break;
+	case ExpressionToken::LSHFT:
+		lhs <<= rhs;
+		break;
+	case ExpressionToken::RSHFT:
+		lhs >>= rhs;
+		break;
+	case ExpressionToken::PLUS:
+		lhs += rhs;
+		break;
+	case ExpressionToken::MINUS:
+#ifdef _MSC_VER
+#pragma warning(push)
+/* disable warning about applying unary - to an unsigned type */
+#pragma warning(disable : 4146)
+#endif
+		lhs -= rhs;
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+		break;
+	case ExpressionToken::MUL:
+		lhs *= rhs;
+		break;
+	case ExpressionToken::DIV:
+		if (rhs == 0) {
+			throw ExpressionError(ExpressionError::DivideByZero);
+		}
+		lhs /= rhs;
+		break;
+	case ExpressionToken::MOD:
+		if (rhs == 0) {
+			throw ExpressionError(ExpressionError::DivideByZero);
+		}
+		lhs %= rhs;
+		break;
+	default:
+		break;
+	}
+
+	return lhs;
+}
+
 #endif
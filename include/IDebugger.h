@@ -91,6 +91,11 @@ public:
 	virtual void kill()                                                                                                                      = 0;
 	virtual void endDebugSession()                                                                                                           = 0;
 
+public:
+	// a descriptor which becomes readable when waitDebugEvent has something to
+	// return, or -1 if waitDebugEvent has to be polled
+	virtual int debugEventDescriptor() const { return -1; }
+
 public:
 	// basic breakpoint managment
 	// TODO(eteran): these should be logically moved to IProcess
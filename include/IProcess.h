@@ -37,6 +37,12 @@ class IProcess {
 public:
 	virtual ~IProcess() = default;
 
+public:
+	struct CacheStatistics {
+		uint64_t hits   = 0;
+		uint64_t misses = 0;
+	};
+
 public:
 	// legal to call when not attached
 	virtual QDateTime startTime() const                     = 0;
@@ -59,6 +65,7 @@ public:
 public:
 	virtual edb::address_t debugPointer() const { return 0; }
 	virtual edb::address_t calculateMain() const { return 0; }
+	virtual CacheStatistics cacheStatistics() const { return CacheStatistics(); }
 
 public:
 	// only legal to call when attached
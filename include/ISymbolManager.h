@@ -19,8 +19,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef ISYMBOL_MANAGER_H_20110307_
 #define ISYMBOL_MANAGER_H_20110307_
 
+#include "API.h"
 #include "Types.h"
 #include <QHash>
+#include <QObject>
+#include <cstddef>
 #include <memory>
 #include <vector>
 
@@ -28,23 +31,33 @@ class QString;
 class Symbol;
 class ISymbolGenerator;
 
-class ISymbolManager {
+class EDB_EXPORT ISymbolManager : public QObject {
+	Q_OBJECT
+
 public:
-	virtual ~ISymbolManager() = default;
+	~ISymbolManager() override = default;
 
 public:
-	virtual const std::vector<std::shared_ptr<Symbol>> symbols() const                 = 0;
-	virtual const std::shared_ptr<Symbol> find(const QString &name) const              = 0;
-	virtual const std::shared_ptr<Symbol> find(edb::address_t address) const           = 0;
-	virtual const std::shared_ptr<Symbol> findNearSymbol(edb::address_t address) const = 0;
-	virtual void addSymbol(const std::shared_ptr<Symbol> &symbol)                      = 0;
-	virtual void clear()                                                               = 0;
-	virtual void loadSymbolFile(const QString &filename, edb::address_t base)          = 0;
-	virtual void setSymbolGenerator(ISymbolGenerator *generator)                       = 0;
-	virtual void setLabel(edb::address_t address, const QString &label)                = 0;
-	virtual QString findAddressName(edb::address_t address, bool prefixed = true)      = 0;
-	virtual QHash<edb::address_t, QString> labels() const                              = 0;
-	virtual QStringList files() const                                                  = 0;
+	virtual const std::vector<std::shared_ptr<Symbol>> symbols() const                                         = 0;
+	virtual const std::vector<std::shared_ptr<Symbol>> symbols(edb::address_t start, edb::address_t end) const = 0;
+	virtual const std::vector<std::shared_ptr<Symbol>> search(const QString &query, std::size_t limit) const   = 0;
+	virtual const std::shared_ptr<Symbol> find(const QString &name) const                                      = 0;
+	virtual const std::shared_ptr<Symbol> find(edb::address_t address) const                                   = 0;
+	virtual const std::shared_ptr<Symbol> findNearSymbol(edb::address_t address) const                         = 0;
+	virtual void addSymbol(const std::shared_ptr<Symbol> &symbol)                                              = 0;
+	virtual void clear()                                                                                       = 0;
+	virtual void loadSymbolFile(const QString &filename, edb::address_t base)                                  = 0;
+	virtual void waitForSymbolFile(const QString &filename)                                                    = 0;
+	virtual void setSymbolGenerator(ISymbolGenerator *generator)                                               = 0;
+	virtual void setLabel(edb::address_t address, const QString &label)                                        = 0;
+	virtual QString findAddressName(edb::address_t address, bool prefixed = true)                              = 0;
+	virtual QHash<edb::address_t, QString> labels() const                                                      = 0;
+	virtual QStringList files() const                                                                          = 0;
+
+Q_SIGNALS:
+	// emitted when the symbols of a module which was loaded in the background
+	// become available
+	void symbolsChanged();
 };
 
 #endif
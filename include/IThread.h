@@ -20,11 +20,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define ITHREAD_H_20150529_
 
 #include "OSTypes.h"
+#include "State.h"
 #include "Status.h"
 #include "Types.h"
 
-class State;
-
 class IThread {
 public:
 	virtual ~IThread() = default;
@@ -40,6 +39,21 @@ public:
 	virtual void getState(State *state)       = 0;
 	virtual void setState(const State &state) = 0;
 
+public:
+	// for callers which only need one or two registers. A platform which can
+	// read them without fetching the whole state should override these
+	virtual edb::address_t stackPointer() {
+		State state;
+		getState(&state);
+		return state.stackPointer();
+	}
+
+	virtual edb::reg_t debugRegister(size_t n) {
+		State state;
+		getState(&state);
+		return state.debugRegister(n);
+	}
+
 public:
 	virtual Status step()                          = 0;
 	virtual Status step(edb::EventStatus status)   = 0;
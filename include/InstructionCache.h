@@ -0,0 +1,100 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INSTRUCTION_CACHE_H_20201016_
+#define INSTRUCTION_CACHE_H_20201016_
+
+#include "API.h"
+#include "IDebugger.h"
+#include "IProcess.h"
+#include "Instruction.h"
+#include "Types.h"
+#include <QHash>
+#include <cstddef>
+#include <cstdint>
+
+// Remembers what the instructions the GUI has already decoded look like, so
+// that things like scrolling the disassembly view upwards, which re-decodes
+// the same instructions over and over, don't have to run the decoder again.
+// Entries are keyed by address, and only used if the bytes at that address
+// are still the ones which were decoded, so they never go stale; invalidate()
+// and clear() only exist to give the memory back early. Not thread safe.
+class EDB_EXPORT InstructionCache {
+public:
+	static constexpr int MaxEntries = 0x40000;
+
+public:
+	enum class Flow : uint8_t {
+		None,
+		Jump,
+		ConditionalJump,
+		Call,
+		Return,
+		Interrupt,
+		Syscall,
+	};
+
+	struct Entry {
+		bool valid           = false;
+		uint8_t size         = 1; // 1 for bytes which don't decode, like edb::Instruction::byteSize
+		Flow flow            = Flow::None;
+		uint8_t operandCount = 0;
+
+		// bit N is set if operand N is of that kind
+		uint8_t memoryOperands    = 0;
+		uint8_t immediateOperands = 0;
+
+		// the destination of a jump or call with an immediate operand
+		bool hasTarget        = false;
+		edb::address_t target = 0;
+	};
+
+public:
+	InstructionCache()                         = default;
+	InstructionCache(const InstructionCache &) = delete;
+	InstructionCache &operator=(const InstructionCache &) = delete;
+
+public:
+	Entry lookup(edb::address_t address, const uint8_t *first, const uint8_t *last);
+	void invalidate(edb::address_t address, std::size_t size);
+	void clear();
+
+public:
+	IProcess::CacheStatistics statistics() const { return statistics_; }
+
+private:
+	struct Record {
+		Entry entry;
+
+		// the bytes which were decoded. For bytes which didn't decode, that
+		// is everything we were given, since more of them may have made a
+		// valid instruction
+		uint8_t length = 0;
+		uint8_t bytes[edb::Instruction::MaxSize];
+	};
+
+private:
+	static Record decode(edb::address_t address, const uint8_t *first, const uint8_t *last);
+
+private:
+	QHash<edb::address_t, Record> records_;
+	IDebugger::CpuMode mode_ = IDebugger::CpuMode::Unknown;
+	IProcess::CacheStatistics statistics_;
+};
+
+#endif
@@ -0,0 +1,106 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INSTRUCTION_INDEX_H_20201016_
+#define INSTRUCTION_INDEX_H_20201016_
+
+#include "API.h"
+#include "Types.h"
+#include <QByteArray>
+#include <QFuture>
+#include <QHash>
+#include <QVector>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+class IRegion;
+
+// Knows where every instruction in a region starts, so that the disassembly
+// view can step backwards through code without having to guess. The index for
+// a region is built in the background the first time that it is asked for:
+// the region is copied a chunk at a time from the event loop, then a linear
+// sweep runs on the thread pool, restarting at every function the analyzer
+// knows about. It is patched up in place when edb writes to the region, and
+// dropped when the region is unmapped or a lookup finds that the code changed
+// under it. Writable regions aren't indexed. Until it is ready, lookups return
+// nothing and callers have to fall back on heuristics. Not thread safe, it is
+// meant to be used from the GUI thread.
+class EDB_EXPORT InstructionIndex {
+public:
+	// bigger regions aren't worth keeping a copy of while they are indexed
+	static constexpr std::size_t MaxRegionSize = 0x10000000;
+
+public:
+	// one bit per byte of the region, set if an instruction starts there
+	struct Boundaries {
+		edb::address_t base;
+		std::size_t size;
+		std::vector<uint64_t> bits;
+
+		explicit Boundaries(edb::address_t base, std::size_t size);
+		bool test(std::size_t offset) const { return (bits[offset / 64] >> (offset % 64)) & 1; }
+		void set(std::size_t offset) { bits[offset / 64] |= (uint64_t(1) << (offset % 64)); }
+		void reset(std::size_t offset) { bits[offset / 64] &= ~(uint64_t(1) << (offset % 64)); }
+		std::optional<std::size_t> previous(std::size_t offset) const;
+	};
+
+	// returns <size> bytes from <offset> into the region being indexed
+	using ReadFunction = std::function<QByteArray(std::size_t offset, std::size_t size)>;
+
+public:
+	InstructionIndex()                         = default;
+	InstructionIndex(const InstructionIndex &) = delete;
+	InstructionIndex &operator=(const InstructionIndex &) = delete;
+
+public:
+	std::optional<edb::address_t> previousInstruction(const std::shared_ptr<IRegion> &region, edb::address_t address);
+	std::optional<edb::address_t> instructionStart(const std::shared_ptr<IRegion> &region, edb::address_t address);
+	void invalidate(edb::address_t address, std::size_t size);
+	void remove(edb::address_t base);
+	void clear();
+
+public:
+	static std::shared_ptr<Boundaries> sweep(const QByteArray &bytes, edb::address_t base, const QVector<edb::address_t> &entryPoints);
+	static void resweep(Boundaries *boundaries, std::size_t first, std::size_t last, const ReadFunction &read);
+
+private:
+	struct Entry {
+		uint64_t id      = 0;
+		std::size_t size = 0;
+		std::size_t read = 0;
+		QByteArray bytes;
+		QVector<edb::address_t> entryPoints;
+		QFuture<std::shared_ptr<Boundaries>> future;
+		std::shared_ptr<Boundaries> boundaries;
+	};
+
+private:
+	Boundaries *boundaries(const std::shared_ptr<IRegion> &region);
+	void readMore(edb::address_t base, uint64_t id);
+	std::optional<edb::address_t> checked(edb::address_t base, edb::address_t start, edb::address_t address);
+
+private:
+	QHash<edb::address_t, Entry> regions_;
+	uint64_t nextId_ = 0;
+};
+
+#endif
@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QAbstractItemModel>
 #include <QList>
 #include <memory>
+#include <vector>
 
 class IRegion;
 
@@ -48,8 +49,26 @@ public:
 	void clear();
 	void sync();
 
+Q_SIGNALS:
+	// emitted by sync() when the set of regions changed, <added> and <removed>
+	// are relative to the regions that were known before the sync
+	void regionsChanged(const QList<std::shared_ptr<IRegion>> &added, const QList<std::shared_ptr<IRegion>> &removed);
+
+private:
+	// a flat copy of the region bounds, sorted by start address so that
+	// lookups can be done with a binary search
+	struct Span {
+		edb::address_t start;
+		edb::address_t end;
+		int index;
+	};
+
+private:
+	void rebuildIndex();
+
 private:
 	QList<std::shared_ptr<IRegion>> regions_;
+	std::vector<Span> spans_;
 };
 
 #endif
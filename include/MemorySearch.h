@@ -0,0 +1,71 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MEMORY_SEARCH_H_20201016_
+#define MEMORY_SEARCH_H_20201016_
+
+#include "API.h"
+#include "BytePattern.h"
+#include "Types.h"
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+class IRegion;
+
+// Searches the debuggee's memory for a byte pattern. Regions are read in
+// fixed size chunks, which overlap by just enough that no match is missed, and
+// the chunks are scanned in parallel by the global thread pool. Memory is only
+// ever read from the calling thread, which must be the one that owns the
+// debugger core.
+class EDB_EXPORT MemorySearch {
+public:
+	static constexpr std::size_t DefaultChunkSize = 0x100000;
+
+public:
+	// receives each batch of matches, in ascending address order
+	using ResultHandler = std::function<void(const QVector<edb::address_t> &matches)>;
+
+	// receives the overall progress as a percentage, returning false cancels the search
+	using ProgressHandler = std::function<bool(int percent)>;
+
+public:
+	explicit MemorySearch(const QByteArray &needle);
+	explicit MemorySearch(BytePattern pattern);
+	MemorySearch(const MemorySearch &) = delete;
+	MemorySearch &operator=(const MemorySearch &) = delete;
+
+public:
+	void setChunkSize(std::size_t size);
+	void setSkipInaccessible(bool skip);
+
+public:
+	bool run(const QList<std::shared_ptr<IRegion>> &regions, const ResultHandler &onResults, const ProgressHandler &onProgress = ProgressHandler()) const;
+	QVector<std::size_t> scan(const uint8_t *data, std::size_t size, std::size_t limit) const;
+
+private:
+	BytePattern pattern_;
+	std::size_t chunkSize_ = DefaultChunkSize;
+	bool skipInaccessible_ = true;
+};
+
+#endif
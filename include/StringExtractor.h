@@ -0,0 +1,84 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STRING_EXTRACTOR_H_20201016_
+#define STRING_EXTRACTOR_H_20201016_
+
+#include "API.h"
+#include "Types.h"
+#include <QString>
+#include <QVector>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+class IRegion;
+
+// Finds runs of printable ASCII and ASCII-as-UTF-16 characters in the
+// debuggee's memory. Memory is read a chunk at a time, and each chunk is
+// classified in a single pass, 16 bytes at a time where the CPU allows it.
+class EDB_EXPORT StringExtractor {
+public:
+	static constexpr int DefaultMaxLength         = 256;
+	static constexpr std::size_t DefaultChunkSize = 0x10000;
+
+public:
+	enum class Encoding {
+		Ascii,
+		Utf16
+	};
+
+	struct Match {
+		edb::address_t address;
+		int length; // in characters, not bytes
+		Encoding encoding;
+	};
+
+public:
+	// receives each string found, along with its escaped text
+	using ResultHandler = std::function<void(const Match &match, const QString &text)>;
+
+	// receives the progress through the region as a percentage, returning false cancels the search
+	using ProgressHandler = std::function<bool(int percent)>;
+
+public:
+	explicit StringExtractor(int minLength, int maxLength = DefaultMaxLength);
+	StringExtractor(const StringExtractor &) = delete;
+	StringExtractor &operator=(const StringExtractor &) = delete;
+
+public:
+	void setSearchUtf16(bool search);
+
+public:
+	bool run(const std::shared_ptr<IRegion> &region, const ResultHandler &onResult, const ProgressHandler &onProgress = ProgressHandler()) const;
+	bool stringAt(edb::address_t address, Match *match, QString *text) const;
+	std::size_t extract(const uint8_t *data, std::size_t size, std::size_t limit, edb::address_t base, QVector<Match> *matches) const;
+
+public:
+	static std::size_t asciiLength(const uint8_t *data, std::size_t size);
+	static std::size_t utf16Length(const uint8_t *data, std::size_t count);
+	static QString toString(const uint8_t *data, int length, Encoding encoding);
+
+private:
+	int minLength_;
+	int maxLength_;
+	bool searchUtf16_ = true;
+};
+
+#endif
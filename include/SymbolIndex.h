@@ -0,0 +1,98 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SYMBOL_INDEX_H_20201016_
+#define SYMBOL_INDEX_H_20201016_
+
+#include "API.h"
+#include <QString>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// An index of symbol names for searching them as the user types. Names are
+// compared without regard to case, and are identified by the order in which
+// they were added. Matches are ranked: the name itself, then names starting
+// with the query, then names containing it, then names which merely look
+// like it (sharing enough of its trigrams, so typos are forgiven).
+//
+// Prefix searches use the names in sorted order, substring and fuzzy ones a
+// list of the names containing each trigram (3 byte sequence) of UTF-8.
+class EDB_EXPORT SymbolIndex {
+public:
+	enum class Match {
+		Exact,
+		Prefix,
+		Substring,
+		Fuzzy,
+	};
+
+	struct Result {
+		uint32_t id;
+		Match match;
+	};
+
+	// returns false for the ids which a search should skip
+	using Filter = std::function<bool(uint32_t id)>;
+
+public:
+	SymbolIndex()                    = default;
+	SymbolIndex(const SymbolIndex &) = delete;
+	SymbolIndex &operator=(const SymbolIndex &) = delete;
+
+public:
+	uint32_t add(const QString &name);
+	void build();
+	void clear();
+	std::size_t size() const { return offsets_.size(); }
+
+public:
+	// NOTE: this uses hits_ as scratch space, so it must not be called from
+	// more than one thread at a time even though it is const. edb only
+	// searches from the GUI thread
+	std::vector<Result> search(const QString &query, std::size_t limit, const Filter &filter = Filter()) const;
+
+private:
+	const char *name(uint32_t id) const { return names_.data() + offsets_[id]; }
+	uint32_t length(uint32_t id) const { return lengths_[id]; }
+	std::vector<uint32_t> substringCandidates(const std::string &query) const;
+	const uint32_t *postings(uint32_t trigram, std::size_t *count) const;
+
+private:
+	// the lower case UTF-8 names, back to back
+	std::string names_;
+	std::vector<uint32_t> offsets_;
+	std::vector<uint32_t> lengths_;
+
+	// the ids ordered by name
+	std::vector<uint32_t> sorted_;
+
+	// for each trigram in trigrams_, the ids of the names containing it are
+	// postings_[starts_[i]] up to postings_[starts_[i + 1]]
+	std::vector<uint32_t> trigrams_;
+	std::vector<uint32_t> starts_;
+	std::vector<uint32_t> postings_;
+	std::vector<uint16_t> trigramCounts_; // how many distinct trigrams each name has
+
+	// scratch space for counting trigram hits in fuzzy searches
+	mutable std::vector<uint8_t> hits_;
+};
+
+#endif
@@ -0,0 +1,126 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SYMBOL_STORE_H_20201016_
+#define SYMBOL_STORE_H_20201016_
+
+#include "API.h"
+#include "Types.h"
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// A symbol file in a form which can be used straight from a memory mapping,
+// so that loading the symbols of even a huge library is just an mmap and
+// looking one up doesn't need anything to be built first.
+//
+// All of the integers are in host byte order. The magic is just characters,
+// so a file written on a machine with a different byte order is rejected by
+// the version field instead, which reads back byte swapped. The layout is:
+//
+//   Header
+//   uint64_t addresses[count]  the symbol addresses, sorted
+//   Entry entries[count]       everything else about the symbol at the same index
+//   uint32_t buckets[N]        a hash table of the names, (index + 1) or 0 if empty
+//   char strings[]             the names, UTF-8 and NUL terminated
+//
+// Every section starts on an 8 byte boundary.
+class EDB_EXPORT SymbolStore {
+public:
+	static constexpr uint32_t Version = 1;
+
+public:
+	// a symbol, as given to write()
+	struct Record {
+		edb::address_t address = 0;
+		uint32_t size          = 0;
+		char type              = 0;
+		QString name;
+	};
+
+private:
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t bucketCount; // always a power of 2
+		uint64_t count;
+		uint64_t addresses;
+		uint64_t entries;
+		uint64_t buckets;
+		uint64_t strings;
+		uint64_t stringsSize;
+		uint8_t md5[16]; // of the binary that the symbols are for
+		uint32_t binary; // the path of that binary, in the string pool
+		uint32_t reserved;
+		int64_t created; // seconds since the epoch
+	};
+
+	struct Entry {
+		uint32_t name;
+		uint32_t length;
+		uint32_t size;
+		uint8_t type;
+		uint8_t reserved[3];
+	};
+
+public:
+	SymbolStore(const SymbolStore &) = delete;
+	SymbolStore &operator=(const SymbolStore &) = delete;
+	~SymbolStore()                              = default;
+
+public:
+	static bool write(const QString &filename, const QString &binary, const QByteArray &md5, std::vector<Record> records);
+	static std::shared_ptr<SymbolStore> open(const QString &filename);
+	static uint64_t hash(const char *name, std::size_t length);
+
+public:
+	std::size_t size() const { return count_; }
+	uint64_t address(std::size_t index) const { return addresses_[index]; }
+	uint32_t symbolSize(std::size_t index) const { return entries_[index].size; }
+	char type(std::size_t index) const { return static_cast<char>(entries_[index].type); }
+	QString name(std::size_t index) const;
+
+public:
+	std::size_t upperBound(std::size_t first, std::size_t last, uint64_t address) const;
+	std::size_t lowerBound(std::size_t first, std::size_t last, uint64_t address) const;
+	std::optional<std::size_t> find(const QByteArray &name) const;
+
+public:
+	QByteArray md5() const;
+	QString binary() const;
+	QString filename() const { return file_.fileName(); }
+
+private:
+	SymbolStore() = default;
+
+private:
+	QFile file_;
+	const Header *header_      = nullptr;
+	const uint64_t *addresses_ = nullptr;
+	const Entry *entries_      = nullptr;
+	const uint32_t *buckets_   = nullptr;
+	const char *strings_       = nullptr;
+	std::size_t count_         = 0;
+};
+
+#endif
@@ -30,7 +30,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <memory>
 #include <optional>
 
+class AnnotationCache;
 class ArchProcessor;
+class BytePattern;
+class CompiledExpression;
 class Configuration;
 class IAnalyzer;
 class IBreakpoint;
@@ -38,6 +41,8 @@ class IDebugEventHandler;
 class IDebugEvent;
 class IDebugger;
 class IPlugin;
+class InstructionCache;
+class InstructionIndex;
 class IRegion;
 class ISymbolManager;
 class MemoryRegions;
@@ -64,6 +69,7 @@ namespace v2 {
 // ask the user for a value in an expression form
 EDB_EXPORT std::optional<edb::address_t> get_expression_from_user(const QString &title, const QString &prompt);
 EDB_EXPORT std::optional<edb::address_t> eval_expression(const QString &expression);
+EDB_EXPORT Result<CompiledExpression, ExpressionError> compile_expression(const QString &expression);
 EDB_EXPORT QString format_bytes(const void *buffer, size_t count);
 
 }
@@ -83,6 +89,15 @@ EDB_EXPORT MemoryRegions &memory_regions();
 // the current arch processor
 EDB_EXPORT ArchProcessor &arch_processor();
 
+// summaries of the instructions that the GUI has decoded
+EDB_EXPORT InstructionCache &instruction_cache();
+
+// where the instructions in each region start
+EDB_EXPORT InstructionIndex &instruction_index();
+
+// descriptions of addresses that the GUI shows next to them
+EDB_EXPORT AnnotationCache &annotation_cache();
+
 // widgets
 EDB_EXPORT QAbstractScrollArea *disassembly_widget();
 
@@ -172,7 +187,9 @@ int get_instruction_bytes(address_t address, uint8_t (&buffer)[N]) {
 
 EDB_EXPORT QString disassemble_address(address_t address);
 
-EDB_EXPORT std::unique_ptr<IBinary> get_binary_info(const std::shared_ptr<IRegion> &region);
+EDB_EXPORT std::shared_ptr<IBinary> get_binary_info(const std::shared_ptr<IRegion> &region);
+EDB_EXPORT void invalidate_binary_info(address_t address, std::size_t size);
+EDB_EXPORT void clear_binary_info();
 EDB_EXPORT const Prototype *get_function_info(const QString &function);
 
 EDB_EXPORT address_t locate_main_function();
@@ -194,8 +211,13 @@ EDB_EXPORT void register_binary_info(IBinary::create_func_ptr_t fptr);
 
 EDB_EXPORT bool overwrite_check(address_t address, size_t size);
 EDB_EXPORT bool modify_bytes(address_t address, size_t size, QByteArray &bytes, uint8_t fill);
+EDB_EXPORT void mark_modified(address_t address, size_t size);
+EDB_EXPORT void bytes_modified(address_t address, size_t size);
+EDB_EXPORT bool was_modified(address_t start, address_t end);
+EDB_EXPORT void clear_modified();
 
 EDB_EXPORT QByteArray get_file_md5(const QString &s);
+EDB_EXPORT QByteArray get_symbol_md5(const QString &s);
 EDB_EXPORT QByteArray get_md5(const void *p, size_t n);
 EDB_EXPORT QByteArray get_md5(const QVector<uint8_t> &bytes);
 
@@ -217,6 +239,10 @@ EDB_EXPORT size_t pointer_size();
 
 EDB_EXPORT QVector<uint8_t> read_pages(address_t address, size_t page_count);
 
+// search the debuggee's memory for a pattern such as "48 8B ?? ?? 00 00 E8"
+EDB_EXPORT QVector<address_t> find_pattern(const BytePattern &pattern, const QList<std::shared_ptr<IRegion>> &regions);
+EDB_EXPORT Result<QVector<address_t>, QString> find_pattern(const QString &pattern, const QList<std::shared_ptr<IRegion>> &regions);
+
 EDB_EXPORT CapstoneEDB::Formatter &formatter();
 
 EDB_EXPORT bool debuggeeIs32Bit();
@@ -47,36 +47,66 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QSettings>
 #include <QStack>
 #include <QToolBar>
+#include <QtConcurrent>
 #include <QtDebug>
 
+#include <algorithm>
 #include <cstring>
 #include <functional>
+#include <utility>
 
 namespace AnalyzerPlugin {
 
 namespace {
 
 constexpr int MinRefCount = 2;
+
+// how much of the region a single task scans for calls
+constexpr std::ptrdiff_t FuzzyChunkSize = 0x100000;
+
+// how many functions a single task walks, large enough that the overhead of
+// a task doesn't matter, small enough that the work spreads across threads
+constexpr int WalkBatchSize = 64;
+
+// what walking a single function found
+struct FunctionWalk {
+	edb::address_t address = 0;
+	Function function;
+
+	// every block reachable from the entry point, including the ones
+	// which are before it and so aren't part of the function
+	QVector<QPair<edb::address_t, BasicBlock>> blocks;
+
+	// calls and far jumps to functions we may not know about yet
+	QVector<edb::address_t> functions;
+
+	// jumps to functions that were already known
+	QVector<edb::address_t> references;
+};
+
 /**
- * @brief will_return
- * @param address
- * @return
+ * @brief no_return_functions
+ * @param region
+ * @return the addresses of every symbol in the region whose prototype says that it never returns
  */
-bool will_return(edb::address_t address) {
+QSet<edb::address_t> no_return_functions(const std::shared_ptr<IRegion> &region) {
+
+	QSet<edb::address_t> results;
 
-	const std::shared_ptr<Symbol> symbol = edb::v1::symbol_manager().find(address);
-	if (symbol) {
+	// calls to other modules go through stubs in this one, which have symbols of their own
+	const std::vector<std::shared_ptr<Symbol>> symbols = edb::v1::symbol_manager().symbols(region->start(), region->end());
+	for (const std::shared_ptr<Symbol> &symbol : symbols) {
 		const QString symname   = symbol->name_no_prefix;
 		const QString func_name = symname.mid(0, symname.indexOf("@"));
 
 		if (const edb::Prototype *const info = edb::v1::get_function_info(func_name)) {
 			if (info->noreturn) {
-				return false;
+				results.insert(symbol->address);
 			}
 		}
 	}
 
-	return true;
+	return results;
 }
 
 /**
@@ -94,18 +124,12 @@ bool is_entrypoint(const Symbol &sym) {
 
 /**
  * @brief is_thunk
- * @param address
+ * @param function
  * @return true if the first instruction of the function is a jmp
  */
-bool is_thunk(edb::address_t address) {
-
-	uint8_t buf[edb::Instruction::MaxSize];
-	if (const int buf_size = edb::v1::get_instruction_bytes(address, buf)) {
-		const edb::Instruction inst(buf, buf + buf_size, address);
-		return is_unconditional_jump(inst);
-	}
-
-	return false;
+bool is_thunk(const Function &function) {
+	const edb::Instruction inst = function.front().front().decode();
+	return is_unconditional_jump(inst);
 }
 
 /**
@@ -118,7 +142,7 @@ void set_function_types(IAnalyzer::FunctionMap *results) {
 
 	// give bonus if we have a symbol for the address
 	std::for_each(results->begin(), results->end(), [](Function &function) {
-		if (is_thunk(function.entryAddress())) {
+		if (is_thunk(function)) {
 			function.setType(Function::Thunk);
 		} else {
 			function.setType(Function::Standard);
@@ -126,13 +150,211 @@ void set_function_types(IAnalyzer::FunctionMap *results) {
 	});
 }
 
+#if defined(EDB_X86) || defined(EDB_X86_64)
+/**
+ * @brief count_call_targets
+ *
+ * Counts the targets of the "call rel32" instructions which start in
+ * [chunk, chunk_end) and land inside of the region. Like decoding at every
+ * offset would, this considers every E8 byte to be a call, but the target is
+ * just arithmetic, so there is no need to decode anything. memchr finds the
+ * candidates since the C library has a vectorized version of it.
+ *
+ * @param region
+ * @param first the start of the copy of the whole region
+ * @param last the end of the copy of the whole region
+ * @param chunk
+ * @param chunk_end
+ * @param is_32_bit
+ * @return
+ */
+QHash<edb::address_t, int> count_call_targets(const std::shared_ptr<IRegion> &region, const uint8_t *first, const uint8_t *last, const uint8_t *chunk, const uint8_t *chunk_end, bool is_32_bit) {
+
+	constexpr uint8_t CallRel32 = 0xe8;
+	constexpr int CallSize      = 5;
+
+	QHash<edb::address_t, int> results;
+
+	// the last 4 bytes of the chunk may be the start of a call
+	// whose displacement is in the next chunk
+	const uint8_t *const end = std::min(chunk_end, last - (CallSize - 1));
+
+	const uint8_t *p = chunk;
+	while (p < end) {
+		p = static_cast<const uint8_t *>(std::memchr(p, CallRel32, end - p));
+		if (!p) {
+			break;
+		}
+
+		int32_t displacement;
+		std::memcpy(&displacement, p + 1, sizeof(displacement));
+
+		// skip over ones which are: "call <label>; label:"
+		if (displacement != 0) {
+			const edb::address_t address = region->start() + static_cast<std::size_t>(p - first);
+
+			uint64_t target = address.toUint() + CallSize + static_cast<int64_t>(displacement);
+			if (is_32_bit) {
+				target &= 0xffffffff;
+			}
+
+			if (region->contains(target)) {
+				++results[target];
+			}
+		}
+
+		++p;
+	}
+
+	return results;
+}
+#endif
+
+/**
+ * @brief walk_function
+ *
+ * Follows the control flow of the function at <function_address>, decoding
+ * from the copy of the region that the analysis was started with. Only reads
+ * its parameters, so that many functions can be walked at the same time.
+ *
+ * @param region
+ * @param memory a copy of the whole region
+ * @param known the functions which are already known about
+ * @param no_return the functions which never return to their caller
+ * @param function_address
+ * @return
+ */
+FunctionWalk walk_function(const std::shared_ptr<IRegion> &region, const QVector<uint8_t> &memory, const QSet<edb::address_t> &known, const QSet<edb::address_t> &no_return, edb::address_t function_address) {
+
+	FunctionWalk walk;
+	walk.address = function_address;
+
+	const uint8_t *const first = memory.constData();
+	const uint8_t *const last  = first + memory.size();
+
+	QSet<edb::address_t> visited;
+	QStack<edb::address_t> blocks;
+	blocks.push(function_address);
+
+	// process are basic blocks that are known
+	while (!blocks.empty()) {
+
+		const edb::address_t block_address = blocks.pop();
+		edb::address_t address             = block_address;
+		BasicBlock block;
+
+		if (visited.contains(block_address)) {
+			continue;
+		}
+
+		visited.insert(block_address);
+
+		while (region->contains(address)) {
+
+			const std::size_t offset = address - region->start();
+			if (offset >= static_cast<std::size_t>(memory.size())) {
+				break;
+			}
+
+			const edb::Instruction inst(first + offset, last, address);
+			if (!inst.valid()) {
+				break;
+			}
+
+			block.push_back(InstructionRecord(inst));
+
+			if (is_call(inst)) {
+
+				// note the destination and move on
+				// we special case some simple things.
+				// also this is an opportunity to find call tables.
+				const edb::Operand op = inst.operand(0);
+				if (is_immediate(op)) {
+					const edb::address_t ea = op->imm;
+
+					// skip over ones which are: "call <label>; label:"
+					if (ea != address + inst.byteSize()) {
+						walk.functions.push_back(ea);
+
+						if (no_return.contains(ea)) {
+							break;
+						}
+
+						block.addReference(address, ea);
+					}
+				} else if (is_expression(op)) {
+					// looks like: "call [...]", if it is of the form, call [C + REG]
+					// then it may be a jump table using REG as an offset
+				} else if (is_register(op)) {
+					// looks like: "call <reg>", this is this may be a callback
+					// if we can use analysis to determine that it's a constant
+					// we can figure it out...
+					// eventually, we should figure out the parameters of the function
+					// to see if we can know what the target is
+				}
+
+			} else if (is_unconditional_jump(inst)) {
+
+				Q_ASSERT(inst.operandCount() >= 1);
+				const edb::Operand op = inst.operand(0);
+
+				// TODO(eteran): we need some heuristic for detecting when this is
+				//               a call/ret -> jmp optimization
+				if (is_immediate(op)) {
+					const edb::address_t ea = op->imm;
+
+					if (known.contains(ea)) {
+						walk.references.push_back(ea);
+					} else if ((ea - function_address) > 0x2000u) {
+						walk.functions.push_back(ea);
+					} else {
+						blocks.push(ea);
+					}
+
+					block.addReference(address, ea);
+				}
+				break;
+			} else if (is_conditional_jump(inst)) {
+
+				Q_ASSERT(inst.operandCount() == 1);
+				const edb::Operand op = inst.operand(0);
+
+				if (is_immediate(op)) {
+
+					const edb::address_t ea = op->imm;
+
+					blocks.push(ea);
+					blocks.push(address + inst.byteSize());
+
+					block.addReference(address, ea);
+				}
+				break;
+			} else if (is_terminator(inst)) {
+				break;
+			}
+
+			address += inst.byteSize();
+		}
+
+		if (!block.empty()) {
+			if (block_address >= function_address) {
+				walk.function.insert(block);
+			}
+
+			walk.blocks.push_back(qMakePair(block_address, block));
+		}
+	}
+
+	return walk;
+}
+
 /**
  * @brief module_entry_point
  * @param region
  * @return
  */
 edb::address_t module_entry_point(const std::shared_ptr<IRegion> &region) {
-	if (std::unique_ptr<IBinary> binary_info = edb::v1::get_binary_info(region)) {
+	if (std::shared_ptr<IBinary> binary_info = edb::v1::get_binary_info(region)) {
 		return binary_info->entryPoint();
 	}
 
@@ -379,7 +601,7 @@ void Analyzer::bonusSymbols(RegionData *data) {
 	Q_ASSERT(data);
 
 	// give bonus if we have a symbol for the address
-	const std::vector<std::shared_ptr<Symbol>> symbols = edb::v1::symbol_manager().symbols();
+	const std::vector<std::shared_ptr<Symbol>> symbols = edb::v1::symbol_manager().symbols(data->region->start(), data->region->end());
 
 	for (const std::shared_ptr<Symbol> &sym : symbols) {
 		const edb::address_t addr = sym->address;
@@ -430,139 +652,94 @@ void Analyzer::collectFunctions(Analyzer::RegionData *data) {
 	QHash<edb::address_t, BasicBlock> basic_blocks;
 	FunctionMap functions;
 
-	// push all known functions onto a stack
-	QStack<edb::address_t> known_functions;
+	// every function we have decided to walk, and how many more times
+	// something called or jumped to them
+	QSet<edb::address_t> known;
+	QHash<edb::address_t, int> references;
+
+	QVector<edb::address_t> round;
+
+	auto add_function = [&](edb::address_t function_address) {
+		if (known.contains(function_address)) {
+			++references[function_address];
+		} else {
+			known.insert(function_address);
+			round.push_back(function_address);
+		}
+	};
+
+	// start with all known functions
 	Q_FOREACH (const edb::address_t function, data->knownFunctions) {
-		known_functions.push(function);
+		add_function(function);
 	}
 
-	// push all fuzzy function too...
+	// and all fuzzy function too...
 	Q_FOREACH (const edb::address_t function, data->fuzzyFunctions) {
-		known_functions.push(function);
+		add_function(function);
 	}
 
-	// process all functions that are known
-	while (!known_functions.empty()) {
-		const edb::address_t function_address = known_functions.pop();
-
-		if (!functions.contains(function_address)) {
-
-			QStack<edb::address_t> blocks;
-			blocks.push(function_address);
-
-			Function func;
-
-			// process are basic blocks that are known
-			while (!blocks.empty()) {
-
-				const edb::address_t block_address = blocks.pop();
-				edb::address_t address             = block_address;
-				BasicBlock block;
-
-				if (!basic_blocks.contains(block_address)) {
-					while (data->region->contains(address)) {
-
-						uint8_t buffer[edb::Instruction::MaxSize];
-						const int buf_size = edb::v1::get_instruction_bytes(address, buffer);
-						if (buf_size == 0) {
-							break;
-						}
-
-						auto inst = std::make_shared<edb::Instruction>(buffer, buffer + buf_size, address);
-						if (!inst->valid()) {
-							break;
-						}
-
-						block.push_back(inst);
-
-						if (is_call(*inst)) {
-
-							// note the destination and move on
-							// we special case some simple things.
-							// also this is an opportunity to find call tables.
-							const edb::Operand op = inst->operand(0);
-							if (is_immediate(op)) {
-								const edb::address_t ea = op->imm;
-
-								// skip over ones which are: "call <label>; label:"
-								if (ea != address + inst->byteSize()) {
-									known_functions.push(ea);
-
-									if (!will_return(ea)) {
-										break;
-									}
-
-									block.addReference(address, ea);
-								}
-							} else if (is_expression(op)) {
-								// looks like: "call [...]", if it is of the form, call [C + REG]
-								// then it may be a jump table using REG as an offset
-							} else if (is_register(op)) {
-								// looks like: "call <reg>", this is this may be a callback
-								// if we can use analysis to determine that it's a constant
-								// we can figure it out...
-								// eventually, we should figure out the parameters of the function
-								// to see if we can know what the target is
-							}
-
-						} else if (is_unconditional_jump(*inst)) {
-
-							Q_ASSERT(inst->operandCount() >= 1);
-							const edb::Operand op = inst->operand(0);
-
-							// TODO(eteran): we need some heuristic for detecting when this is
-							//               a call/ret -> jmp optimization
-							if (is_immediate(op)) {
-								const edb::address_t ea = op->imm;
+	const QSet<edb::address_t> no_return = no_return_functions(data->region);
 
-								if (functions.contains(ea)) {
-									functions[ea].addReference();
-								} else if ((ea - function_address) > 0x2000u) {
-									known_functions.push(ea);
-								} else {
-									blocks.push(ea);
-								}
+	// functions don't depend on each other, so each round walks all of the
+	// functions found so far in parallel. The functions that they lead to are
+	// walked in the next round, once nothing is reading the set of known ones
+	while (!round.empty()) {
 
-								block.addReference(address, ea);
-							}
-							break;
-						} else if (is_conditional_jump(*inst)) {
+		const QVector<edb::address_t> current = std::exchange(round, {});
 
-							Q_ASSERT(inst->operandCount() == 1);
-							const edb::Operand op = inst->operand(0);
+		QList<QFuture<QVector<FunctionWalk>>> futures;
+		for (int i = 0; i < current.size(); i += WalkBatchSize) {
+			const QVector<edb::address_t> batch = current.mid(i, WalkBatchSize);
 
-							if (is_immediate(op)) {
+			futures.push_back(QtConcurrent::run([data, &known, &no_return, batch]() {
+				QVector<FunctionWalk> walks;
+				walks.reserve(batch.size());
+				for (const edb::address_t function_address : batch) {
+					walks.push_back(walk_function(data->region, data->memory, known, no_return, function_address));
+				}
+				return walks;
+			}));
+		}
 
-								const edb::address_t ea = op->imm;
+		// the walks read the set of known functions, so it can't grow until
+		// they are all done
+		for (QFuture<QVector<FunctionWalk>> &future : futures) {
+			future.waitForFinished();
+		}
 
-								blocks.push(ea);
-								blocks.push(address + inst->byteSize());
+		// merge in the order they were submitted, so that the results don't
+		// depend on the order in which the threads finished
+		for (const QFuture<QVector<FunctionWalk>> &future : futures) {
+			const QVector<FunctionWalk> walks = future.result();
+			for (const FunctionWalk &walk : walks) {
 
-								block.addReference(address, ea);
-							}
-							break;
-						} else if (is_terminator(*inst)) {
-							break;
-						}
-
-						address += inst->byteSize();
+				for (const QPair<edb::address_t, BasicBlock> &block : walk.blocks) {
+					if (!basic_blocks.contains(block.first)) {
+						basic_blocks.insert(block.first, block.second);
 					}
+				}
 
-					if (!block.empty()) {
-						basic_blocks.insert(block_address, block);
+				if (!walk.function.empty()) {
+					functions.insert(walk.address, walk.function);
+				}
 
-						if (block_address >= function_address) {
-							func.insert(block);
-						}
-					}
+				for (const edb::address_t ea : walk.references) {
+					++references[ea];
+				}
+
+				for (const edb::address_t ea : walk.functions) {
+					add_function(ea);
 				}
 			}
+		}
+	}
 
-			if (!func.empty()) {
-				functions.insert(function_address, func);
+	for (auto it = references.begin(); it != references.end(); ++it) {
+		auto function = functions.find(it.key());
+		if (function != functions.end()) {
+			for (int i = 0; i < it.value(); ++i) {
+				function->addReference();
 			}
-		} else {
-			functions[function_address].addReference();
 		}
 	}
 
@@ -579,17 +756,38 @@ void Analyzer::collectFuzzyFunctions(RegionData *data) {
 
 	data->fuzzyFunctions.clear();
 
-	if (data->fuzzy) {
+	if (data->fuzzy && !data->memory.isEmpty()) {
 
 		QHash<edb::address_t, int> fuzzy_functions;
 
-		uint8_t *const first = &data->memory[0];
-		uint8_t *const last  = &first[data->memory.size()];
+		const uint8_t *const first = data->memory.constData();
+		const uint8_t *const last  = first + data->memory.size();
+
+#if defined(EDB_X86) || defined(EDB_X86_64)
+		const bool is_32_bit = edb::v1::debuggeeIs32Bit();
 
-		uint8_t *p = first;
+		QList<QFuture<QHash<edb::address_t, int>>> futures;
+		for (std::ptrdiff_t offset = 0; offset < last - first; offset += FuzzyChunkSize) {
+			const uint8_t *const chunk     = first + offset;
+			const uint8_t *const chunk_end = chunk + std::min(FuzzyChunkSize, last - chunk);
+			futures.push_back(QtConcurrent::run([data, first, last, chunk, chunk_end, is_32_bit]() {
+				return count_call_targets(data->region, first, last, chunk, chunk_end, is_32_bit);
+			}));
+		}
+
+		for (const QFuture<QHash<edb::address_t, int>> &future : futures) {
+			const QHash<edb::address_t, int> counts = future.result();
+			for (auto it = counts.begin(); it != counts.end(); ++it) {
+				if (!data->knownFunctions.contains(it.key())) {
+					fuzzy_functions[it.key()] += it.value();
+				}
+			}
+		}
+#else
+		const uint8_t *p = first;
 
 		// fuzzy_functions, known_functions
-		for (edb::address_t addr = data->region->start(); addr != data->region->end(); ++addr) {
+		for (edb::address_t addr = data->region->start(); p != last; ++addr) {
 			if (auto inst = edb::Instruction(p, last, addr)) {
 				if (is_call(inst)) {
 
@@ -612,11 +810,19 @@ void Analyzer::collectFuzzyFunctions(RegionData *data) {
 			}
 			++p;
 		}
+#endif
 
-		// transfer results to data->fuzzy_functions
+		// transfer results to data->fuzzy_functions, only the popular targets
+		// are worth decoding to make sure that they look like code
 		for (auto it = fuzzy_functions.begin(); it != fuzzy_functions.end(); ++it) {
 			if (it.value() > MinRefCount) {
-				data->fuzzyFunctions.insert(it.key());
+				const std::size_t offset = it.key() - data->region->start();
+				if (offset < static_cast<std::size_t>(data->memory.size())) {
+					const edb::Instruction inst(first + offset, last, it.key(), edb::Instruction::Detail::FlowOnly);
+					if (inst.valid()) {
+						data->fuzzyFunctions.insert(it.key());
+					}
+				}
 			}
 		}
 	}
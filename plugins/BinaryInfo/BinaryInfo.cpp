@@ -29,7 +29,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QDebug>
 #include <QMenu>
 
-#include <fstream>
 #include <memory>
 
 namespace BinaryInfoPlugin {
@@ -62,6 +61,13 @@ void BinaryInfo::privateInit() {
 	edb::v1::symbol_manager().setSymbolGenerator(this);
 }
 
+/**
+ * @brief BinaryInfo::privateFini
+ */
+void BinaryInfo::privateFini() {
+	edb::v1::symbol_manager().setSymbolGenerator(nullptr);
+}
+
 /**
  * @brief BinaryInfo::optionsPage
  * @return
@@ -126,14 +132,7 @@ IPlugin::ArgumentStatus BinaryInfo::parseArguments(QStringList &args) {
  */
 bool BinaryInfo::generateSymbolFile(const QString &filename, const QString &symbol_file) {
 
-	std::ofstream file(qPrintable(symbol_file));
-	if (file) {
-		if (generate_symbols(filename, file)) {
-			return true;
-		}
-	}
-
-	return false;
+	return generate_symbol_store(filename, symbol_file);
 }
 
 }
@@ -39,6 +39,7 @@ public:
 
 private:
 	void privateInit() override;
+	void privateFini() override;
 	QWidget *optionsPage() override;
 
 public:
@@ -446,7 +446,7 @@ DialogHeader::DialogHeader(const std::shared_ptr<IRegion> &region, QWidget *pare
 	: QDialog(parent, f) {
 	ui.setupUi(this);
 
-	if (std::unique_ptr<IBinary> binary_info = edb::v1::get_binary_info(region)) {
+	if (std::shared_ptr<IBinary> binary_info = edb::v1::get_binary_info(region)) {
 
 		if (auto elf32 = dynamic_cast<ELF32 *>(binary_info.get())) {
 
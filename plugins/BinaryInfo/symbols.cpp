@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "symbols.h"
+#include "SymbolStore.h"
 #include "demangle.h"
 #include "edb.h"
 
@@ -383,6 +384,24 @@ void collect_symbols(const void *p, Size size, std::vector<typename M::symbol> &
 	}
 }
 
+//--------------------------------------------------------------------------
+// Name: unique_symbols
+// Desc: sorts the symbols, removing duplicates and adding any needed
+//       demangling
+//--------------------------------------------------------------------------
+template <class Symbol>
+void unique_symbols(std::vector<Symbol> &symbols) {
+	std::sort(symbols.begin(), symbols.end());
+	symbols.erase(std::unique(symbols.begin(), symbols.end()), symbols.end());
+
+	const auto demanglingEnabled = QSettings().value("BinaryInfo/demangling_enabled", true).toBool();
+	if (demanglingEnabled) {
+		for (Symbol &symbol : symbols) {
+			symbol.name = demangle(symbol.name);
+		}
+	}
+}
+
 //--------------------------------------------------------------------------
 // Name: output_symbols
 // Desc: outputs the symbols to OS ensuring uniqueness and adding any
@@ -390,22 +409,43 @@ void collect_symbols(const void *p, Size size, std::vector<typename M::symbol> &
 //--------------------------------------------------------------------------
 template <class Symbol>
 void output_symbols(std::vector<Symbol> &symbols, std::ostream &os) {
-	std::sort(symbols.begin(), symbols.end());
-	auto new_end                 = std::unique(symbols.begin(), symbols.end());
-	const auto demanglingEnabled = QSettings().value("BinaryInfo/demangling_enabled", true).toBool();
-	for (auto it = symbols.begin(); it != new_end; ++it) {
-		if (demanglingEnabled) {
-			it->name = demangle(it->name);
-		}
-		os << qPrintable(it->to_string()) << '\n';
+	unique_symbols(symbols);
+	for (const Symbol &symbol : symbols) {
+		os << qPrintable(symbol.to_string()) << '\n';
+	}
+}
+
+//--------------------------------------------------------------------------
+// Name: store_records
+// Desc: converts the symbols to what a symbol store is written from,
+//       ensuring uniqueness and adding any needed demangling
+//--------------------------------------------------------------------------
+template <class Symbol>
+std::vector<SymbolStore::Record> store_records(std::vector<Symbol> &symbols) {
+	unique_symbols(symbols);
+
+	std::vector<SymbolStore::Record> records;
+	records.reserve(symbols.size());
+
+	for (const Symbol &symbol : symbols) {
+		SymbolStore::Record record;
+		record.address = symbol.address;
+		record.size    = static_cast<uint32_t>(symbol.size);
+		record.type    = symbol.type;
+		record.name    = symbol.name.trimmed();
+		records.push_back(std::move(record));
 	}
+
+	return records;
 }
 
 //--------------------------------------------------------------------------
-// Name: generate_symbols_internal
-// Desc:
+// Name: with_symbols
+// Desc: collects the symbols of FILE, and those of DEBUGFILE if there is one,
+//       and passes them to OUTPUT
 //--------------------------------------------------------------------------
-bool generate_symbols_internal(QFile &file, std::shared_ptr<QFile> &debugFile, std::ostream &os) {
+template <class Output>
+bool with_symbols(QFile &file, const std::shared_ptr<QFile> &debugFile, Output output) {
 	if (auto file_ptr = reinterpret_cast<void *>(file.map(0, file.size(), QFile::NoOptions))) {
 		if (is_elf64(file_ptr)) {
 
@@ -430,8 +470,7 @@ bool generate_symbols_internal(QFile &file, std::shared_ptr<QFile> &debugFile, s
 				}
 			}
 
-			output_symbols(symbols, os);
-			return true;
+			return output(symbols);
 		} else if (is_elf32(file_ptr)) {
 
 			using symbol = typename elf32_model::symbol;
@@ -455,8 +494,7 @@ bool generate_symbols_internal(QFile &file, std::shared_ptr<QFile> &debugFile, s
 				}
 			}
 
-			output_symbols(symbols, os);
-			return true;
+			return output(symbols);
 		} else {
 			qDebug() << "unknown file type";
 		}
@@ -465,6 +503,25 @@ bool generate_symbols_internal(QFile &file, std::shared_ptr<QFile> &debugFile, s
 	return false;
 }
 
+//--------------------------------------------------------------------------
+// Name: debug_file
+// Desc: the separate debug info file for FILENAME, which may not exist
+//--------------------------------------------------------------------------
+std::shared_ptr<QFile> debug_file(const QString &filename) {
+
+	const QString debugInfoPath = QSettings().value("BinaryInfo/debug_info_path", "/usr/lib/debug").toString();
+
+	std::shared_ptr<QFile> debugFile;
+	if (!debugInfoPath.isEmpty()) {
+		debugFile = std::make_shared<QFile>(QString("%1/%2.debug").arg(debugInfoPath, filename));
+		if (!debugFile->exists()) { // systems such as Ubuntu don't have .debug suffix, try without it
+			debugFile = std::make_shared<QFile>(QString("%1/%2").arg(debugInfoPath, filename));
+		}
+	}
+
+	return debugFile;
+}
+
 }
 
 /**
@@ -478,20 +535,34 @@ bool generate_symbols(const QString &filename, std::ostream &os) {
 	QFile file(filename);
 	if (file.open(QIODevice::ReadOnly)) {
 		os << qPrintable(QDateTime::currentDateTimeUtc().toString(Qt::ISODate)) << " +0000" << '\n';
-		const QByteArray md5 = edb::v1::get_file_md5(filename);
+		const QByteArray md5 = edb::v1::get_symbol_md5(filename);
 		os << md5.toHex().data() << ' ' << qPrintable(QFileInfo(filename).absoluteFilePath()) << '\n';
 
-		const QString debugInfoPath = QSettings().value("BinaryInfo/debug_info_path", "/usr/lib/debug").toString();
+		return with_symbols(file, debug_file(filename), [&os](auto &symbols) {
+			output_symbols(symbols, os);
+			return true;
+		});
+	}
+
+	return false;
+}
 
-		std::shared_ptr<QFile> debugFile;
-		if (!debugInfoPath.isEmpty()) {
-			debugFile = std::make_shared<QFile>(QString("%1/%2.debug").arg(debugInfoPath, filename));
-			if (!debugFile->exists()) { // systems such as Ubuntu don't have .debug suffix, try without it
-				debugFile = std::make_shared<QFile>(QString("%1/%2").arg(debugInfoPath, filename));
-			}
-		}
+/**
+ * @brief generate_symbol_store
+ * @param filename
+ * @param symbol_file
+ * @return
+ */
+bool generate_symbol_store(const QString &filename, const QString &symbol_file) {
+
+	QFile file(filename);
+	if (file.open(QIODevice::ReadOnly)) {
+		const QByteArray md5 = edb::v1::get_symbol_md5(filename);
+		const QString binary = QFileInfo(filename).absoluteFilePath();
 
-		return generate_symbols_internal(file, debugFile, os);
+		return with_symbols(file, debug_file(filename), [&](auto &symbols) {
+			return SymbolStore::write(symbol_file, binary, md5, store_records(symbols));
+		});
 	}
 
 	return false;
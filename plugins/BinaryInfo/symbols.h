@@ -25,6 +25,7 @@ class QString;
 namespace BinaryInfoPlugin {
 
 bool generate_symbols(const QString &filename, std::ostream &os = std::cout);
+bool generate_symbol_store(const QString &filename, const QString &symbol_file);
 
 }
 
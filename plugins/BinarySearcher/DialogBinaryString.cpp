@@ -17,18 +17,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "DialogBinaryString.h"
+#include "BytePattern.h"
 #include "DialogResults.h"
 #include "IDebugger.h"
 #include "IRegion.h"
 #include "MemoryRegions.h"
+#include "MemorySearch.h"
 #include "edb.h"
-#include "util/Math.h"
 
+#include <QCoreApplication>
 #include <QListWidget>
 #include <QMessageBox>
 #include <QPushButton>
 #include <QVector>
-#include <cstring>
 
 namespace BinarySearcherPlugin {
 
@@ -56,6 +57,11 @@ DialogBinaryString::DialogBinaryString(QWidget *parent, Qt::WindowFlags f)
 	});
 
 	ui.buttonBox->addButton(buttonFind_, QDialogButtonBox::ActionRole);
+
+	connect(ui.chkPattern, &QCheckBox::toggled, this, [this](bool checked) {
+		ui.binaryString->setEnabled(!checked);
+		ui.txtPattern->setEnabled(checked);
+	});
 }
 
 /**
@@ -63,62 +69,60 @@ DialogBinaryString::DialogBinaryString(QWidget *parent, Qt::WindowFlags f)
  */
 void DialogBinaryString::doFind() {
 
-	const QByteArray b = ui.binaryString->value();
-
-	auto results = new DialogResults(this);
+	BytePattern pattern;
 
-	const int sz = b.size();
-	if (sz != 0) {
-		edb::v1::memory_regions().sync();
-		const QList<std::shared_ptr<IRegion>> regions = edb::v1::memory_regions().regions();
-		const size_t page_size                        = edb::v1::debugger_core->pageSize();
-
-		int i = 0;
-		for (const std::shared_ptr<IRegion> &region : regions) {
-			const size_t region_size = region->size();
-
-			// a short circut for speading things up
-			if (ui.chkSkipNoAccess->isChecked() && !region->accessible()) {
-				ui.progressBar->setValue(util::percentage(++i, regions.size()));
-				continue;
-			}
+	if (ui.chkPattern->isChecked()) {
+		const Result<BytePattern, QString> compiled = BytePattern::compile(ui.txtPattern->text());
+		if (!compiled) {
+			QMessageBox::critical(this, tr("Invalid Pattern"), compiled.error());
+			return;
+		}
 
-			const size_t page_count      = region_size / page_size;
-			const QVector<uint8_t> pages = edb::v1::read_pages(region->start(), page_count);
+		pattern = *compiled;
+	} else {
+		pattern = BytePattern::fromBytes(ui.binaryString->value());
+	}
 
-			if (!pages.isEmpty()) {
+	if (pattern.isEmpty()) {
+		return;
+	}
 
-				const uint8_t *p               = &pages[0];
-				const uint8_t *const pages_end = &pages[0] + region_size - sz;
+	auto results = new DialogResults(this);
 
-				while (p < pages_end) {
-					// compare values..
-					if (std::memcmp(p, b.constData(), sz) == 0) {
-						const edb::address_t addr  = p - &pages[0] + region->start();
-						const edb::address_t align = 1 << (ui.cmbAlignment->currentIndex() + 1);
+	edb::v1::memory_regions().sync();
+	const QList<std::shared_ptr<IRegion>> regions = edb::v1::memory_regions().regions();
 
-						if (!ui.chkAlignment->isChecked() || (addr % align) == 0) {
-							results->addResult(DialogResults::RegionType::Data, addr);
-						}
-					}
+	const bool aligned         = ui.chkAlignment->isChecked();
+	const edb::address_t align = 1 << (ui.cmbAlignment->currentIndex() + 1);
 
-					// update progress bar every 64KB
-					if ((uint64_t(p) & 0xFFFF) == 0) {
-						ui.progressBar->setValue(util::percentage(i, regions.size(), p - &pages[0], region_size));
-					}
+	MemorySearch search(pattern);
+	search.setSkipInaccessible(ui.chkSkipNoAccess->isChecked());
 
-					++p;
+	// results are shown as soon as we have some, the search can take a while
+	search.run(
+		regions,
+		[&](const QVector<edb::address_t> &matches) {
+			for (edb::address_t addr : matches) {
+				if (!aligned || (addr % align) == 0) {
+					results->addResult(DialogResults::RegionType::Data, addr);
 				}
 			}
-			++i;
-		}
 
-		if (results->resultCount() == 0) {
-			QMessageBox::information(nullptr, tr("No Results"), tr("No Results were found!"));
-			delete results;
-		} else {
-			results->show();
-		}
+			if (results->resultCount() != 0 && !results->isVisible()) {
+				results->show();
+			}
+		},
+		[this](int percent) {
+			ui.progressBar->setValue(percent);
+			// keep the UI painting, but don't let the user do things like
+			// resume the debuggee while we are still reading from it
+			QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+			return true;
+		});
+
+	if (results->resultCount() == 0) {
+		QMessageBox::information(nullptr, tr("No Results"), tr("No Results were found!"));
+		delete results;
 	}
 }
 
@@ -0,0 +1,159 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BREAKPOINT_INDEX_H_20201016_
+#define BREAKPOINT_INDEX_H_20201016_
+
+#include "IBreakpoint.h"
+#include "Types.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace DebuggerCorePlugin {
+
+// A flat array of breakpoints sorted by address. This lets us find every
+// breakpoint overlapping a range of memory in O(log n + k) instead of visiting
+// all of them, which matters a lot for reads when there are thousands set.
+// NOTE(eteran): the index does not own the breakpoints, the owner must keep
+// the index in sync with the lifetime of the breakpoints it contains.
+class BreakpointIndex {
+private:
+	using Entry = std::pair<edb::address_t, IBreakpoint *>;
+
+public:
+	// <maxBreakpointSize> is the largest number of bytes any breakpoint can
+	// occupy, breakpoints may change size when their type changes so we can't
+	// rely on the size they had when inserted
+	explicit BreakpointIndex(std::size_t maxBreakpointSize)
+		: maxBreakpointSize_(maxBreakpointSize) {
+	}
+
+public:
+	void insert(IBreakpoint *bp) {
+		const edb::address_t address = bp->address();
+
+		auto it = lowerBound(address);
+		if (it != entries_.end() && it->first == address) {
+			it->second = bp;
+		} else {
+			entries_.insert(it, Entry(address, bp));
+		}
+	}
+
+	void remove(edb::address_t address) {
+		auto it = lowerBound(address);
+		if (it != entries_.end() && it->first == address) {
+			entries_.erase(it);
+		}
+	}
+
+	void clear() {
+		entries_.clear();
+	}
+
+	std::size_t size() const {
+		return entries_.size();
+	}
+
+	bool empty() const {
+		return entries_.empty();
+	}
+
+public:
+	/**
+	 * calls <func> for every breakpoint which has at least one byte in
+	 * the range [address, address + len)
+	 *
+	 * @brief forEachOverlapping
+	 * @param address
+	 * @param len
+	 * @param func
+	 */
+	template <class F>
+	void forEachOverlapping(edb::address_t address, std::size_t len, F func) const {
+
+		if (len == 0 || entries_.empty()) {
+			return;
+		}
+
+		// a breakpoint starting shortly before <address> may still extend into the range
+		const std::size_t lookBehind = maxBreakpointSize_ - 1;
+		const edb::address_t first   = (address >= lookBehind) ? address - lookBehind : edb::address_t(0);
+
+		for (auto it = lowerBound(first); it != entries_.end(); ++it) {
+			const edb::address_t bpAddr = it->first;
+			if (bpAddr >= address && bpAddr - address >= len) {
+				break;
+			}
+
+			if (bpAddr + it->second->size() > address) {
+				func(it->second);
+			}
+		}
+	}
+
+	/**
+	 * replaces any bytes in <buf> which belong to a breakpoint with the
+	 * original bytes the breakpoint was written over. <buf> is expected to
+	 * hold <len> bytes read from <address>
+	 *
+	 * @brief restoreOriginalBytes
+	 * @param address
+	 * @param buf
+	 * @param len
+	 */
+	void restoreOriginalBytes(edb::address_t address, void *buf, std::size_t len) const {
+
+		auto ptr = static_cast<uint8_t *>(buf);
+
+		forEachOverlapping(address, len, [address, ptr, len](const IBreakpoint *bp) {
+			const uint8_t *bpBytes      = bp->originalBytes();
+			const edb::address_t bpAddr = bp->address();
+			// show the original bytes in the buffer..
+			for (size_t i = 0; i < bp->size(); ++i) {
+				if (bpAddr + i >= address && bpAddr + i < address + len) {
+					ptr[bpAddr + i - address] = bpBytes[i];
+				}
+			}
+		});
+	}
+
+private:
+	std::vector<Entry>::iterator lowerBound(edb::address_t address) {
+		return std::lower_bound(entries_.begin(), entries_.end(), address, [](const Entry &entry, edb::address_t value) {
+			return entry.first < value;
+		});
+	}
+
+	std::vector<Entry>::const_iterator lowerBound(edb::address_t address) const {
+		return std::lower_bound(entries_.begin(), entries_.end(), address, [](const Entry &entry, edb::address_t value) {
+			return entry.first < value;
+		});
+	}
+
+private:
+	std::vector<Entry> entries_;
+	std::size_t maxBreakpointSize_;
+};
+
+}
+
+#endif
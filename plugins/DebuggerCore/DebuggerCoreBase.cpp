@@ -24,6 +24,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace DebuggerCorePlugin {
 
+/**
+ * @brief DebuggerCoreBase::DebuggerCoreBase
+ */
+DebuggerCoreBase::DebuggerCoreBase()
+	: breakpointIndex_(Breakpoint::MaxSize) {
+}
+
 /**
  * removes all breakpoints
  *
@@ -31,6 +38,7 @@ namespace DebuggerCorePlugin {
  */
 void DebuggerCoreBase::clearBreakpoints() {
 	if (attached()) {
+		breakpointIndex_.clear();
 		breakpoints_.clear();
 	}
 }
@@ -50,8 +58,21 @@ std::shared_ptr<IBreakpoint> DebuggerCoreBase::addBreakpoint(edb::address_t addr
 				return bp;
 			}
 
+			// the middle of another breakpoint, such as the jump to a
+			// trampoline, can't take a trap without corrupting it
+			bool covered = false;
+			breakpointIndex_.forEachOverlapping(address, 1, [&covered](const IBreakpoint *bp) {
+				covered = covered || bp->enabled();
+			});
+
+			if (covered) {
+				qDebug() << "Failed to create breakpoint, it overlaps another one";
+				return nullptr;
+			}
+
 			auto bp               = std::make_shared<Breakpoint>(address);
 			breakpoints_[address] = bp;
+			breakpointIndex_.insert(bp.get());
 			return bp;
 		}
 
@@ -96,6 +117,10 @@ std::shared_ptr<IBreakpoint> DebuggerCoreBase::findTriggeredBreakpoint(edb::addr
 				return bp;
 			}
 		}
+
+		if (const std::optional<edb::address_t> site = Breakpoint::trampolineSite(address)) {
+			return findBreakpoint(*site);
+		}
 	}
 	return nullptr;
 }
@@ -114,6 +139,7 @@ void DebuggerCoreBase::removeBreakpoint(edb::address_t address) {
 	if (attached()) {
 		auto it = breakpoints_.find(address);
 		if (it != breakpoints_.end()) {
+			breakpointIndex_.remove(address);
 			breakpoints_.erase(it);
 		}
 	}
@@ -163,6 +189,19 @@ bool DebuggerCoreBase::attached() const {
 	return process() != nullptr;
 }
 
+/**
+ * replaces the bytes of any breakpoints found in <buf> (which holds <len>
+ * bytes read from <address>) with the original bytes they were written over
+ *
+ * @brief DebuggerCoreBase::restoreOriginalBytes
+ * @param address
+ * @param buf
+ * @param len
+ */
+void DebuggerCoreBase::restoreOriginalBytes(edb::address_t address, void *buf, std::size_t len) const {
+	breakpointIndex_.restoreOriginalBytes(address, buf, len);
+}
+
 /**
  * @brief DebuggerCoreBase::supportedBreakpointTypes
  * @return
@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef DEBUGGER_CORE_BASE_H_20090529_
 #define DEBUGGER_CORE_BASE_H_20090529_
 
+#include "BreakpointIndex.h"
 #include "IDebugger.h"
 
 class Status;
@@ -27,6 +28,7 @@ namespace DebuggerCorePlugin {
 
 class DebuggerCoreBase : public QObject, public IDebugger {
 public:
+	DebuggerCoreBase();
 	~DebuggerCoreBase() override = default;
 
 public:
@@ -51,9 +53,13 @@ public:
 
 protected:
 	bool attached() const;
+	void restoreOriginalBytes(edb::address_t address, void *buf, std::size_t len) const;
 
 protected:
 	BreakpointList breakpoints_;
+
+private:
+	BreakpointIndex breakpointIndex_;
 };
 
 }
@@ -94,7 +94,7 @@ Breakpoint::~Breakpoint() {
 bool Breakpoint::enable() {
 	if (!enabled()) {
 		if (IProcess *process = edb::v1::debugger_core->process()) {
-			std::vector<quint8> prev(4);
+			std::vector<quint8> prev(MaxSize);
 			prev.resize(process->readBytes(address(), &prev[0], prev.size()));
 			if (prev.size()) {
 				originalBytes_ = prev;
@@ -187,4 +187,9 @@ std::vector<size_t> Breakpoint::possibleRewindSizes() {
 	return {0}; // Even BKPT stops before the instruction, let alone UDF
 }
 
+std::optional<edb::address_t> Breakpoint::trampolineSite(edb::address_t address) {
+	Q_UNUSED(address)
+	return {}; // conditions are never evaluated in-process on ARM
+}
+
 }
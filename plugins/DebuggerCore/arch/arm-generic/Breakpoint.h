@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "IBreakpoint.h"
 #include "Util.h"
 #include <array>
+#include <optional>
 #include <vector>
 
 namespace DebuggerCorePlugin {
@@ -42,6 +43,9 @@ public:
 
 	using Type = util::AbstractEnumData<IBreakpoint::TypeId, TypeId>;
 
+	// the size of the largest breakpoint instruction we support
+	static constexpr size_t MaxSize = 4;
+
 public:
 	explicit Breakpoint(edb::address_t address);
 	~Breakpoint() override;
@@ -58,6 +62,7 @@ public:
 
 	static std::vector<BreakpointType> supportedTypes();
 	static std::vector<size_t> possibleRewindSizes();
+	static std::optional<edb::address_t> trampolineSite(edb::address_t address);
 
 public:
 	bool enable() override;
@@ -20,6 +20,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "Configuration.h"
 #include "IDebugger.h"
 #include "IProcess.h"
+#include "IRegion.h"
+#include "MemoryRegions.h"
+#include "Trampoline.h"
 #include "edb.h"
 #include <cassert>
 
@@ -37,6 +40,27 @@ const std::vector<uint8_t> BreakpointInstructionOUTSB = {0x6e};
 const std::vector<uint8_t> BreakpointInstructionOUTSD = {0x6f};
 const std::vector<uint8_t> BreakpointInstructionUD2   = {0x0f, 0x0b};
 const std::vector<uint8_t> BreakpointInstructionUD0   = {0x0f, 0xff};
+
+/**
+ * @brief trampoline_arena
+ * @return the space shared by the trampolines of every breakpoint
+ */
+TrampolineArena &trampoline_arena() {
+	static TrampolineArena arena;
+
+	// breakpoints whose trampolines were unmapped jump into nothing, so they
+	// have to be placed again
+	static const QMetaObject::Connection connection = QObject::connect(&edb::v1::memory_regions(), &MemoryRegions::regionsChanged, [](const QList<std::shared_ptr<IRegion>> &, const QList<std::shared_ptr<IRegion>> &removed) {
+		for (edb::address_t site : arena.removeRegions(removed)) {
+			if (auto breakpoint = std::dynamic_pointer_cast<Breakpoint>(edb::v1::debugger_core->findBreakpoint(site))) {
+				breakpoint->trampolineUnmapped();
+			}
+		}
+	});
+
+	Q_UNUSED(connection)
+	return arena;
+}
 }
 
 /**
@@ -69,6 +93,7 @@ auto Breakpoint::supportedTypes() -> std::vector<BreakpointType> {
 		BreakpointType{Type{TypeId::OUTSD}, tr("OUTSD")},
 		BreakpointType{Type{TypeId::UD2}, tr("UD2 (2-byte)")},
 		BreakpointType{Type{TypeId::UD0}, tr("UD0 (2-byte)")},
+		BreakpointType{Type{TypeId::Trampoline}, tr("Conditions Evaluated In-Process (x86-64)")},
 	};
 	return types;
 }
@@ -79,6 +104,7 @@ auto Breakpoint::supportedTypes() -> std::vector<BreakpointType> {
  */
 void Breakpoint::setType(TypeId type) {
 	disable();
+	releaseTrampoline();
 	type_ = type;
 	if (!enable()) {
 		throw BreakpointCreationError();
@@ -104,6 +130,7 @@ void Breakpoint::setType(IBreakpoint::TypeId type) {
  */
 Breakpoint::~Breakpoint() {
 	this->disable();
+	releaseTrampoline();
 }
 
 /**
@@ -113,7 +140,13 @@ Breakpoint::~Breakpoint() {
 bool Breakpoint::enable() {
 	if (!enabled()) {
 		if (IProcess *process = edb::v1::debugger_core->process()) {
-			std::vector<uint8_t> prev(2);
+
+			if (TypeId{type_} == TypeId::Trampoline && enableTrampoline(process)) {
+				enabled_ = true;
+				return true;
+			}
+
+			std::vector<uint8_t> prev(MaxTrapSize);
 			if (process->readBytes(address(), &prev[0], prev.size())) {
 				originalBytes_                      = prev;
 				const std::vector<uint8_t> *bpBytes = nullptr;
@@ -121,6 +154,7 @@ bool Breakpoint::enable() {
 				switch (TypeId{type_}) {
 				case TypeId::Automatic:
 				case TypeId::INT3:
+				case TypeId::Trampoline: // when the condition can't be evaluated in-process
 					bpBytes = &BreakpointInstructionINT3;
 					break;
 				case TypeId::INT1:
@@ -171,6 +205,124 @@ bool Breakpoint::enable() {
 	return false;
 }
 
+/**
+ * patches the site with a jump to a trampoline which only traps when the
+ * breakpoint's condition holds. The trampoline is kept for as long as the
+ * condition and the displaced code stay the same.
+ *
+ * @brief Breakpoint::enableTrampoline
+ * @param process
+ * @return false if the breakpoint should use a trap instruction instead
+ */
+bool Breakpoint::enableTrampoline(IProcess *process) {
+
+	if (condition.isEmpty() || !edb::v1::debuggeeIs64Bit()) {
+		return false;
+	}
+
+	uint8_t code[MaxSize];
+	const size_t size   = process->readBytes(address(), code, sizeof(code));
+	const size_t length = Trampoline::displacedLength(code, size, address());
+	if (length == 0) {
+		return false;
+	}
+
+	// the jump can't cover other breakpoints
+	for (size_t i = 1; i < length; ++i) {
+		if (edb::v1::debugger_core->findBreakpoint(address() + i)) {
+			return false;
+		}
+	}
+
+	const std::vector<uint8_t> displaced(code, code + length);
+
+	if (trampoline_ && (trampolineCondition_ != condition || originalBytes_ != displaced)) {
+		releaseTrampoline();
+	}
+
+	if (!trampoline_) {
+		const std::optional<Trampoline> trampoline = Trampoline::assemble(condition, displaced, address() + length);
+		if (!trampoline) {
+			return false;
+		}
+
+		const std::vector<uint8_t> &bytes = trampoline->code();
+
+		const edb::address_t where = trampoline_arena().allocate(process->pid(), edb::v1::memory_regions().regions(), address(), bytes.size());
+		if (!where) {
+			return false;
+		}
+
+		if (process->writeBytes(where, bytes.data(), bytes.size()) != bytes.size()) {
+			trampoline_arena().release(process, where, bytes.size());
+			return false;
+		}
+
+		edb::v1::bytes_modified(where, bytes.size());
+
+		trampoline_          = where;
+		trampolineSize_      = bytes.size();
+		trampolineTrap_      = where + trampoline->trapOffset();
+		trampolineCondition_ = condition;
+		trampoline_arena().addTrap(trampolineTrap_, address());
+	}
+
+	// jmp trampoline, with anything left of the displaced instruction turned
+	// into traps
+	std::vector<uint8_t> jump(length, 0xcc);
+	const auto rel = static_cast<uint32_t>((trampoline_ - (address() + Trampoline::JumpSize)).toUint());
+	jump[0]        = 0xe9;
+	for (size_t i = 0; i < 4; ++i) {
+		jump[1 + i] = static_cast<uint8_t>(rel >> (i * 8));
+	}
+
+	if (process->writeBytes(address(), jump.data(), jump.size()) != jump.size()) {
+		return false;
+	}
+
+	originalBytes_ = displaced;
+	return true;
+}
+
+/**
+ * @brief Breakpoint::releaseTrampoline
+ */
+void Breakpoint::releaseTrampoline() {
+	if (trampoline_) {
+		trampoline_arena().removeTrap(trampolineTrap_);
+		trampoline_arena().release(edb::v1::debugger_core->process(), trampoline_, trampolineSize_);
+
+		trampolineCondition_.clear();
+		trampoline_     = 0;
+		trampolineTrap_ = 0;
+		trampolineSize_ = 0;
+	}
+}
+
+/**
+ * called once the memory holding the trampoline is gone. If the site is still
+ * mapped, the jump there is replaced with whatever enable() comes up with now,
+ * otherwise the breakpoint is left disabled
+ *
+ * @brief Breakpoint::trampolineUnmapped
+ */
+void Breakpoint::trampolineUnmapped() {
+
+	// there is nothing left to release
+	trampolineCondition_.clear();
+	trampoline_     = 0;
+	trampolineTrap_ = 0;
+	trampolineSize_ = 0;
+
+	if (enabled()) {
+		if (edb::v1::memory_regions().findRegion(address()) && disable()) {
+			enable();
+		} else {
+			enabled_ = false;
+		}
+	}
+}
+
 /**
  * @brief Breakpoint::disable
  * @return
@@ -218,4 +370,14 @@ std::vector<size_t> Breakpoint::possibleRewindSizes() {
 	return {1, 0, 2}; // e.g. int3/int1, cli/sti/hlt/etc., int 0x1/int 0x3
 }
 
+/**
+ * @brief Breakpoint::trampolineSite
+ * @param address
+ * @return the address of the breakpoint whose trampoline trapped, if the
+ * instruction pointer <address> is just past one of their trap instructions
+ */
+std::optional<edb::address_t> Breakpoint::trampolineSite(edb::address_t address) {
+	return trampoline_arena().siteForTrap(address);
+}
+
 }
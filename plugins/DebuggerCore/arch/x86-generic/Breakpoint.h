@@ -23,8 +23,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "Util.h"
 #include <QCoreApplication>
 #include <array>
+#include <optional>
 #include <vector>
 
+class IProcess;
+
 namespace DebuggerCorePlugin {
 
 class Breakpoint final : public IBreakpoint {
@@ -43,12 +46,20 @@ public:
 		OUTSD,
 		UD2,
 		UD0,
+		Trampoline,
 
 		TYPE_COUNT
 	};
 
 	using Type = util::AbstractEnumData<IBreakpoint::TypeId, TypeId>;
 
+	// the size of the largest breakpoint instruction we support
+	static constexpr size_t MaxTrapSize = 2;
+
+	// the most bytes a breakpoint can occupy, the jump to a trampoline
+	// displaces the whole instruction it is written over
+	static constexpr size_t MaxSize = 15;
+
 public:
 	explicit Breakpoint(edb::address_t address);
 	~Breakpoint() override;
@@ -65,6 +76,7 @@ public:
 
 	static std::vector<BreakpointType> supportedTypes();
 	static std::vector<size_t> possibleRewindSizes();
+	static std::optional<edb::address_t> trampolineSite(edb::address_t address);
 
 public:
 	bool enable() override;
@@ -74,6 +86,11 @@ public:
 	void setInternal(bool value) override;
 	void setType(IBreakpoint::TypeId type) override;
 	void setType(TypeId type);
+	void trampolineUnmapped();
+
+private:
+	bool enableTrampoline(IProcess *process);
+	void releaseTrampoline();
 
 private:
 	std::vector<uint8_t> originalBytes_;
@@ -83,6 +100,12 @@ private:
 	bool oneTime_      = false;
 	bool internal_     = false;
 	Type type_;
+
+	// the trampoline evaluating the condition when this is a Trampoline type
+	QString trampolineCondition_;
+	edb::address_t trampoline_     = 0;
+	edb::address_t trampolineTrap_ = 0;
+	size_t trampolineSize_         = 0;
 };
 
 }
@@ -0,0 +1,794 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Trampoline.h"
+#include "IDebugger.h"
+#include "IProcess.h"
+#include "IRegion.h"
+#include "ISymbolManager.h"
+#include "IThread.h"
+#include "Instruction.h"
+#include "MemoryRegions.h"
+#include "Symbol.h"
+#include "edb.h"
+
+#include <QStringList>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "libELF/elf_model.h"
+
+namespace DebuggerCorePlugin {
+
+namespace {
+
+// the stack the trampoline uses starts below the red zone, and holds
+// rcx, rax and then rflags (from lowest address to highest)
+constexpr uint8_t RedZoneSize         = 128;
+constexpr uint8_t SavedRcxOffset      = 0;
+constexpr uint8_t SavedRaxOffset      = 8;
+constexpr uint32_t StackPointerOffset = 24 + RedZoneSize;
+
+// gaps left between the code in a region and the trampolines we put after it
+constexpr std::size_t CaveGuardSize = 16;
+constexpr std::size_t CaveAlignment = 16;
+
+enum RegisterIndex : uint8_t {
+	Rax = 0,
+	Rcx = 1,
+	Rsp = 4,
+};
+
+// the x86 condition codes we compare with, all comparisons are unsigned
+enum ConditionCode : uint8_t {
+	CC_B  = 0x2,
+	CC_AE = 0x3,
+	CC_E  = 0x4,
+	CC_NE = 0x5,
+	CC_BE = 0x6,
+	CC_A  = 0x7,
+};
+
+struct Operand {
+	enum Kind {
+		Immediate,
+		Register,
+	};
+
+	Kind kind         = Immediate;
+	uint64_t value    = 0;
+	uint8_t reg       = 0;
+	bool zeroExtend32 = false;
+};
+
+struct Comparison {
+	Operand lhs;
+	Operand rhs;
+	uint8_t cc; // the condition code which is set when the comparison holds
+};
+
+/**
+ * @brief register_index
+ * @param name
+ * @param zeroExtend32 set to true if name is the 32-bit form of the register
+ * @return the encoding of the named general purpose register, or -1
+ */
+int register_index(const QString &name, bool *zeroExtend32) {
+
+	static const char *const Registers64[] = {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"};
+	static const char *const Registers32[] = {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi", "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"};
+
+	const QString lower = name.toLower();
+	for (int i = 0; i < 16; ++i) {
+		if (lower == QLatin1String(Registers64[i])) {
+			*zeroExtend32 = false;
+			return i;
+		}
+
+		if (lower == QLatin1String(Registers32[i])) {
+			*zeroExtend32 = true;
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * @brief tokenize
+ * @param condition
+ * @param tokens
+ * @return false if the condition contains anything we have no token for
+ */
+bool tokenize(const QString &condition, QStringList *tokens) {
+
+	static const char *const Operators[] = {"==", "!=", "<=", ">=", "&&", "||", "<", ">"};
+
+	int i = 0;
+	while (i < condition.size()) {
+		const QChar ch = condition[i];
+
+		if (ch.isSpace()) {
+			++i;
+			continue;
+		}
+
+		if (ch.isLetterOrNumber() || ch == QLatin1Char('_')) {
+			// names may contain a "!" to support module!symbol notation
+			int j = i;
+			while (j < condition.size() && (condition[j].isLetterOrNumber() || condition[j] == QLatin1Char('_') || condition[j] == QLatin1Char('!') || condition[j] == QLatin1Char('.') || condition[j] == QLatin1Char('@'))) {
+				++j;
+			}
+
+			*tokens << condition.mid(i, j - i);
+			i = j;
+			continue;
+		}
+
+		bool found = false;
+		for (const char *op : Operators) {
+			const int length = static_cast<int>(std::strlen(op));
+			if (condition.midRef(i, length) == QLatin1String(op)) {
+				*tokens << QLatin1String(op);
+				i += length;
+				found = true;
+				break;
+			}
+		}
+
+		if (!found) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Parses the restricted form of the expression language which the
+ * trampoline can evaluate.
+ */
+class ConditionParser {
+public:
+	explicit ConditionParser(const QStringList &tokens)
+		: tokens_(tokens) {
+	}
+
+public:
+	bool parse(std::vector<Comparison> *comparisons, bool *disjunction) {
+
+		*disjunction = false;
+
+		Comparison comparison;
+		if (!parseComparison(&comparison)) {
+			return false;
+		}
+
+		comparisons->push_back(comparison);
+
+		while (position_ < tokens_.size()) {
+			const QString &join = tokens_[position_++];
+			if (join != QLatin1String("&&") && join != QLatin1String("||")) {
+				return false;
+			}
+
+			// we don't do precedence, so "&&" and "||" can't be mixed
+			const bool isOr = join == QLatin1String("||");
+			if (comparisons->size() > 1 && isOr != *disjunction) {
+				return false;
+			}
+
+			*disjunction = isOr;
+
+			if (!parseComparison(&comparison)) {
+				return false;
+			}
+
+			comparisons->push_back(comparison);
+		}
+
+		return true;
+	}
+
+private:
+	bool parseComparison(Comparison *comparison) {
+
+		if (!parseOperand(&comparison->lhs)) {
+			return false;
+		}
+
+		static const std::pair<const char *, uint8_t> Relations[] = {
+			{"==", CC_E},
+			{"!=", CC_NE},
+			{"<", CC_B},
+			{"<=", CC_BE},
+			{">", CC_A},
+			{">=", CC_AE},
+		};
+
+		if (position_ < tokens_.size()) {
+			for (const auto &relation : Relations) {
+				if (tokens_[position_] == QLatin1String(relation.first)) {
+					++position_;
+					comparison->cc = relation.second;
+					return parseOperand(&comparison->rhs);
+				}
+			}
+		}
+
+		// a lone operand is true when it is non-zero
+		comparison->rhs = Operand();
+		comparison->cc  = CC_NE;
+		return true;
+	}
+
+	bool parseOperand(Operand *operand) {
+
+		if (position_ >= tokens_.size()) {
+			return false;
+		}
+
+		const QString token = tokens_[position_++];
+
+		if (token[0].isDigit()) {
+			bool ok;
+			operand->kind  = Operand::Immediate;
+			operand->value = token.toULongLong(&ok, 0);
+			return ok;
+		}
+
+		bool zeroExtend32;
+		const int reg = register_index(token, &zeroExtend32);
+		if (reg >= 0) {
+			operand->kind         = Operand::Register;
+			operand->reg          = static_cast<uint8_t>(reg);
+			operand->zeroExtend32 = zeroExtend32;
+			return true;
+		}
+
+		if (const std::shared_ptr<Symbol> symbol = edb::v1::symbol_manager().find(token)) {
+			operand->kind  = Operand::Immediate;
+			operand->value = symbol->address.toUint();
+			return true;
+		}
+
+		return false;
+	}
+
+private:
+	const QStringList &tokens_;
+	int position_ = 0;
+};
+
+/**
+ * Emits the x86-64 machine code the trampoline is made of. Only rax and rcx
+ * are ever written, and they are saved on the stack first.
+ */
+class Emitter {
+public:
+	void bytes(std::initializer_list<uint8_t> list) {
+		code_.insert(code_.end(), list);
+	}
+
+	void imm32(uint32_t value) {
+		for (int i = 0; i < 4; ++i) {
+			code_.push_back(static_cast<uint8_t>(value >> (i * 8)));
+		}
+	}
+
+	void imm64(uint64_t value) {
+		for (int i = 0; i < 8; ++i) {
+			code_.push_back(static_cast<uint8_t>(value >> (i * 8)));
+		}
+	}
+
+	void prologue() {
+		bytes({0x48, 0x8d, 0x64, 0x24, static_cast<uint8_t>(-RedZoneSize)}); // lea rsp, [rsp - 128]
+		bytes({0x9c});                                                         // pushfq
+		bytes({0x50});                                                         // push rax
+		bytes({0x51});                                                         // push rcx
+	}
+
+	void epilogue() {
+		bytes({0x59});                   // pop rcx
+		bytes({0x58});                   // pop rax
+		bytes({0x9d});                   // popfq
+		bytes({0x48, 0x8d, 0xa4, 0x24}); // lea rsp, [rsp + 128]
+		imm32(RedZoneSize);
+	}
+
+	// loads the value the debuggee had in register <src> into <dst>
+	void loadRegister(uint8_t dst, uint8_t src) {
+		switch (src) {
+		case Rax:
+		case Rcx:
+			// mov dst, [rsp + offset]
+			bytes({0x48, 0x8b, static_cast<uint8_t>(0x44 | (dst << 3)), 0x24, src == Rax ? SavedRaxOffset : SavedRcxOffset});
+			break;
+		case Rsp:
+			// lea dst, [rsp + offset]
+			bytes({0x48, 0x8d, static_cast<uint8_t>(0x84 | (dst << 3)), 0x24});
+			imm32(StackPointerOffset);
+			break;
+		default:
+			// mov dst, src
+			bytes({static_cast<uint8_t>(0x48 | (src >= 8 ? 0x04 : 0x00)), 0x89, static_cast<uint8_t>(0xc0 | ((src & 7) << 3) | dst)});
+			break;
+		}
+	}
+
+	void load(uint8_t dst, const Operand &operand) {
+		switch (operand.kind) {
+		case Operand::Immediate:
+			// mov dst, imm64
+			bytes({0x48, static_cast<uint8_t>(0xb8 | dst)});
+			imm64(operand.value);
+			break;
+		case Operand::Register:
+			loadRegister(dst, operand.reg);
+			if (operand.zeroExtend32) {
+				// mov dst32, dst32
+				bytes({0x89, static_cast<uint8_t>(0xc0 | (dst << 3) | dst)});
+			}
+			break;
+		}
+	}
+
+	// emits a jcc rel32 with a placeholder target, returning where to patch it
+	std::size_t jcc(uint8_t cc) {
+		bytes({0x0f, static_cast<uint8_t>(0x80 | cc)});
+		imm32(0);
+		return code_.size();
+	}
+
+	std::size_t jmp() {
+		bytes({0xe9});
+		imm32(0);
+		return code_.size();
+	}
+
+	// points the jump which ends at <fixup> to the current position
+	void bind(std::size_t fixup) {
+		const uint32_t rel = static_cast<uint32_t>(code_.size() - fixup);
+		for (int i = 0; i < 4; ++i) {
+			code_[fixup - 4 + i] = static_cast<uint8_t>(rel >> (i * 8));
+		}
+	}
+
+	std::vector<uint8_t> &code() { return code_; }
+
+private:
+	std::vector<uint8_t> code_;
+};
+
+/**
+ * @brief relocatable
+ * @param inst
+ * @return true if inst behaves the same when executed at a different address
+ */
+bool relocatable(const edb::Instruction &inst) {
+
+	if (is_terminator(inst) || is_call(inst) || is_conditional_jump(inst) || is_interrupt(inst) || is_syscall(inst) || is_sysenter(inst)) {
+		return false;
+	}
+
+	switch (inst.operation()) {
+	case X86_INS_LOOP:
+	case X86_INS_LOOPE:
+	case X86_INS_LOOPNE:
+	case X86_INS_JCXZ:
+	case X86_INS_JECXZ:
+	case X86_INS_JRCXZ:
+		return false;
+	default:
+		break;
+	}
+
+	for (std::size_t i = 0; i < inst.operandCount(); ++i) {
+		const edb::Operand op = inst[i];
+		if (is_expression(op) && (op->mem.base == X86_REG_RIP || op->mem.base == X86_REG_EIP)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief image_end
+ * @param process
+ * @param filename
+ * @param address an address within one of the image's executable mappings
+ * @return the address just past the executable segment of the ELF image
+ * mapped from <filename> which contains <address>, or 0 if there is no such
+ * segment. The rest of the last page of the segment is mapped from the file,
+ * but isn't part of the segment so nothing uses it
+ */
+edb::address_t image_end(IProcess *process, const QString &filename, edb::address_t address) {
+
+	using elf_header = elf_model<64>::elf_header;
+	using elf_phdr   = elf_model<64>::elf_phdr;
+
+	// the headers are at the start of the image's lowest mapping
+	edb::address_t base = 0;
+	for (const std::shared_ptr<IRegion> &region : edb::v1::memory_regions().regions()) {
+		if (region->name() == filename && (!base || region->start() < base)) {
+			base = region->start();
+		}
+	}
+
+	elf_header header;
+	if (!base || process->readBytes(base, &header, sizeof(header)) != sizeof(header)) {
+		return 0;
+	}
+
+	if (std::memcmp(header.e_ident, ELFMAG, SELFMAG) != 0 || header.e_ident[EI_CLASS] != ELFCLASS64 || header.e_phentsize != sizeof(elf_phdr) || header.e_phnum == 0 || header.e_phnum == PN_XNUM) {
+		return 0;
+	}
+
+	std::vector<elf_phdr> phdrs(header.e_phnum);
+	const std::size_t phdrsSize = phdrs.size() * sizeof(elf_phdr);
+	if (process->readBytes(base + header.e_phoff, phdrs.data(), phdrsSize) != phdrsSize) {
+		return 0;
+	}
+
+	// the image may be loaded somewhere other than the addresses it was
+	// linked at, its lowest mapping is where its first segment ended up
+	const uint64_t pageMask = ~uint64_t(edb::v1::debugger_core->pageSize() - 1);
+	uint64_t linked         = std::numeric_limits<uint64_t>::max();
+	for (const elf_phdr &phdr : phdrs) {
+		if (phdr.p_type == PT_LOAD) {
+			linked = std::min<uint64_t>(linked, phdr.p_vaddr & pageMask);
+		}
+	}
+
+	const uint64_t bias = base.toUint() - linked;
+
+	for (const elf_phdr &phdr : phdrs) {
+		if (phdr.p_type != PT_LOAD || !(phdr.p_flags & PF_X)) {
+			continue;
+		}
+
+		const uint64_t start  = bias + phdr.p_vaddr;
+		const uint64_t end    = start + std::max(phdr.p_filesz, phdr.p_memsz);
+		const uint64_t mapped = (end + ~pageMask) & pageMask;
+		if (address >= start && address < mapped) {
+			return end;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief segment_end
+ * @param region
+ * @return the address just past the executable segment of the ELF image that
+ * ends in <region>, or 0 if it isn't part of one. Anonymous executable memory,
+ * such as a JIT's heap, may use all of itself so we never take space from that
+ */
+edb::address_t segment_end(const std::shared_ptr<IRegion> &region) {
+
+	IProcess *process = edb::v1::debugger_core ? edb::v1::debugger_core->process() : nullptr;
+	if (!process || !region->name().startsWith(QLatin1Char('/'))) {
+		return 0;
+	}
+
+	return image_end(process, region->name(), region->end() - 1);
+}
+
+/**
+ * @brief reachable
+ * @param from the address just past a rel32 jump
+ * @param to
+ * @return true if a rel32 jump can get from one address to the other
+ */
+bool reachable(edb::address_t from, edb::address_t to) {
+	const int64_t distance = static_cast<int64_t>(to.toUint() - from.toUint());
+	return distance >= std::numeric_limits<int32_t>::min() && distance <= std::numeric_limits<int32_t>::max();
+}
+
+}
+
+/**
+ * @brief Trampoline::displacedLength
+ * @param code the bytes at the breakpoint site
+ * @param size
+ * @param address the address of the breakpoint site
+ * @return the size of the instruction that the jump to a trampoline would
+ * overwrite, or 0 if it can't be moved into one. The jump must fit within the
+ * instruction at the site, if it spilled over into the next one then anything
+ * branching to that would run part of the jump's displacement as code
+ */
+std::size_t Trampoline::displacedLength(const uint8_t *code, std::size_t size, edb::address_t address) {
+
+	const edb::Instruction inst(code, code + size, address);
+	if (!inst || inst.byteSize() < JumpSize || !relocatable(inst)) {
+		return 0;
+	}
+
+	return inst.byteSize();
+}
+
+/**
+ * @brief Trampoline::assemble
+ * @param condition
+ * @param displaced the instruction the jump to the trampoline overwrites
+ * @param resume the address of the instruction following the displaced one
+ * @return the trampoline, or nothing if the condition is too complex for us
+ */
+std::optional<Trampoline> Trampoline::assemble(const QString &condition, const std::vector<uint8_t> &displaced, edb::address_t resume) {
+
+	QStringList tokens;
+	if (!tokenize(condition, &tokens) || tokens.isEmpty()) {
+		return {};
+	}
+
+	std::vector<Comparison> comparisons;
+	bool disjunction;
+
+	ConditionParser parser(tokens);
+	if (!parser.parse(&comparisons, &disjunction)) {
+		return {};
+	}
+
+	Emitter emitter;
+	emitter.prologue();
+
+	// with "&&" any false comparison skips the trap, with "||" any true
+	// comparison goes straight to it
+	std::vector<std::size_t> toTrap;
+	std::vector<std::size_t> toResume;
+
+	for (const Comparison &comparison : comparisons) {
+		emitter.load(Rax, comparison.lhs);
+		emitter.load(Rcx, comparison.rhs);
+		emitter.bytes({0x48, 0x39, 0xc8}); // cmp rax, rcx
+
+		if (disjunction) {
+			toTrap.push_back(emitter.jcc(comparison.cc));
+		} else {
+			toResume.push_back(emitter.jcc(comparison.cc ^ 1));
+		}
+	}
+
+	if (disjunction) {
+		toResume.push_back(emitter.jmp());
+	}
+
+	for (std::size_t fixup : toTrap) {
+		emitter.bind(fixup);
+	}
+
+	Trampoline trampoline;
+
+	// the registers are restored before trapping, so the debugger sees the
+	// same state it would have at the breakpoint site. If the trap is
+	// ignored, we carry on as if the condition was false.
+	emitter.epilogue();
+	emitter.bytes({0xcc}); // int3
+	trampoline.trapOffset_ = emitter.code().size();
+	const std::size_t skipEpilogue = emitter.jmp();
+
+	for (std::size_t fixup : toResume) {
+		emitter.bind(fixup);
+	}
+
+	emitter.epilogue();
+	emitter.bind(skipEpilogue);
+
+	trampoline.displacedOffset_ = emitter.code().size();
+	emitter.code().insert(emitter.code().end(), displaced.begin(), displaced.end());
+
+	// jmp [rip + 0], followed by the absolute address to go to
+	emitter.bytes({0xff, 0x25});
+	emitter.imm32(0);
+	emitter.imm64(resume.toUint());
+
+	trampoline.code_ = std::move(emitter.code());
+	return trampoline;
+}
+
+/**
+ * @brief TrampolineArena::TrampolineArena
+ */
+TrampolineArena::TrampolineArena()
+	: TrampolineArena(segment_end) {
+}
+
+/**
+ * @brief TrampolineArena::TrampolineArena
+ * @param segmentEnd finds where the cave of a region starts
+ */
+TrampolineArena::TrampolineArena(SegmentEnd segmentEnd)
+	: segmentEnd_(std::move(segmentEnd)) {
+}
+
+/**
+ * @brief TrampolineArena::findCave
+ * @param region
+ * @return the cave at the end of the region, which is empty unless the region
+ * holds the end of an executable segment of a mapped ELF image
+ */
+TrampolineArena::Cave *TrampolineArena::findCave(const std::shared_ptr<IRegion> &region) {
+
+	const edb::address_t start = region->start();
+	const edb::address_t end   = region->end();
+
+	auto it = caves_.find(start);
+	if (it == caves_.end()) {
+
+		// the cave is what is left of the segment's last page
+		Cave cave                       = {end, end};
+		const edb::address_t segmentEnd = segmentEnd_(region);
+		if (segmentEnd && segmentEnd >= start && segmentEnd + CaveGuardSize < end) {
+			cave.next = segmentEnd + CaveGuardSize;
+		}
+
+		it = caves_.emplace(start, cave).first;
+	}
+
+	return &it->second;
+}
+
+/**
+ * @brief TrampolineArena::allocate
+ * @param pid the process the trampoline is for
+ * @param regions the memory regions of that process
+ * @param site the address of the jump to the trampoline
+ * @param size
+ * @return the address of the space allocated, or 0 if there was none in reach
+ */
+edb::address_t TrampolineArena::allocate(edb::pid_t pid, const QList<std::shared_ptr<IRegion>> &regions, edb::address_t site, std::size_t size) {
+
+	if (pid != pid_) {
+		caves_.clear();
+		traps_.clear();
+		pid_ = pid;
+	}
+
+	// prefer the region holding the site itself, then the nearest ones
+	QList<std::shared_ptr<IRegion>> nearest = regions;
+	std::sort(nearest.begin(), nearest.end(), [site](const std::shared_ptr<IRegion> &a, const std::shared_ptr<IRegion> &b) {
+		const uint64_t distanceA = a->contains(site) ? 0 : std::min(site.toUint() - a->end().toUint(), a->start().toUint() - site.toUint());
+		const uint64_t distanceB = b->contains(site) ? 0 : std::min(site.toUint() - b->end().toUint(), b->start().toUint() - site.toUint());
+		return distanceA < distanceB;
+	});
+
+	for (const std::shared_ptr<IRegion> &region : nearest) {
+		if (!region->executable()) {
+			continue;
+		}
+
+		if (Cave *cave = findCave(region)) {
+			const edb::address_t address = (cave->next.toUint() + CaveAlignment - 1) & ~uint64_t(CaveAlignment - 1);
+			if (address + size > cave->end) {
+				continue;
+			}
+
+			if (!reachable(site + Trampoline::JumpSize, address)) {
+				continue;
+			}
+
+			cave->next = address + size;
+			return address;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief TrampolineArena::release
+ * @param process
+ * @param address
+ * @param size
+ */
+void TrampolineArena::release(IProcess *process, edb::address_t address, std::size_t size) {
+
+	if (!process || process->pid() != pid_) {
+		return;
+	}
+
+	// a thread may be part way through the trampoline, so leave it be. The
+	// space is only lost until we detach
+	for (const std::shared_ptr<IThread> &thread : process->threads()) {
+		const edb::address_t ip = thread->instructionPointer();
+		if (ip >= address && ip < address + size) {
+			return;
+		}
+	}
+
+	const std::vector<uint8_t> zeros(size);
+	if (process->writeBytes(address, zeros.data(), zeros.size()) == zeros.size()) {
+		edb::v1::bytes_modified(address, zeros.size());
+	}
+
+	// the space can only be reused if it was the last thing allocated
+	for (auto &entry : caves_) {
+		Cave &cave = entry.second;
+		if (cave.next == address + size) {
+			cave.next = address;
+			break;
+		}
+	}
+}
+
+/**
+ * forgets the caves of <regions>, which have been unmapped, along with the
+ * traps of the trampolines that were in them. Whatever gets mapped there
+ * next has its cave worked out again
+ *
+ * @brief TrampolineArena::removeRegions
+ * @param regions
+ * @return the sites of the breakpoints whose trampolines were in <regions>,
+ * which now jump into memory that isn't there any more
+ */
+std::vector<edb::address_t> TrampolineArena::removeRegions(const QList<std::shared_ptr<IRegion>> &regions) {
+
+	std::vector<edb::address_t> sites;
+
+	for (const std::shared_ptr<IRegion> &region : regions) {
+		caves_.erase(region->start());
+
+		for (auto it = traps_.begin(); it != traps_.end();) {
+			if (region->contains(it.key())) {
+				sites.push_back(it.value());
+				it = traps_.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+
+	return sites;
+}
+
+/**
+ * @brief TrampolineArena::addTrap
+ * @param trap the address just past the trap instruction of a trampoline
+ * @param site the address of the breakpoint which jumps to that trampoline
+ */
+void TrampolineArena::addTrap(edb::address_t trap, edb::address_t site) {
+	traps_.insert(trap, site);
+}
+
+/**
+ * @brief TrampolineArena::removeTrap
+ * @param trap
+ */
+void TrampolineArena::removeTrap(edb::address_t trap) {
+	traps_.remove(trap);
+}
+
+/**
+ * @brief TrampolineArena::siteForTrap
+ * @param trap
+ * @return the breakpoint site whose trampoline traps at this address
+ */
+std::optional<edb::address_t> TrampolineArena::siteForTrap(edb::address_t trap) const {
+	auto it = traps_.find(trap);
+	if (it != traps_.end()) {
+		return it.value();
+	}
+
+	return {};
+}
+
+}
@@ -0,0 +1,114 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef X86_TRAMPOLINE_H_20201016_
+#define X86_TRAMPOLINE_H_20201016_
+
+#include "OSTypes.h"
+#include "Types.h"
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
+class IProcess;
+class IRegion;
+
+namespace DebuggerCorePlugin {
+
+// Code which evaluates a breakpoint condition inside the debuggee, so that
+// hits where the condition is false never stop the process. The breakpoint
+// site is patched with a jump to the trampoline, which traps if the condition
+// holds and otherwise runs the instruction the jump displaced before jumping
+// back to the code that follows it. Only sites where the jump fits within a
+// single instruction can be patched this way.
+//
+// Only x86-64 is supported, and only conditions which are comparisons joined
+// entirely by "&&" or entirely by "||". Each side of a comparison is a number,
+// a symbol, or a 64 or 32-bit general purpose register. Memory is never read,
+// a bad pointer would fault in the trampoline instead of being reported as an
+// error in the condition, so those conditions are left to the debugger.
+class Trampoline {
+public:
+	// the size of the jump written over the breakpoint site
+	static constexpr std::size_t JumpSize = 5;
+
+public:
+	static std::optional<Trampoline> assemble(const QString &condition, const std::vector<uint8_t> &displaced, edb::address_t resume);
+	static std::size_t displacedLength(const uint8_t *code, std::size_t size, edb::address_t address);
+
+public:
+	const std::vector<uint8_t> &code() const { return code_; }
+	std::size_t trapOffset() const { return trapOffset_; }
+	std::size_t displacedOffset() const { return displacedOffset_; }
+
+private:
+	std::vector<uint8_t> code_;
+	std::size_t trapOffset_      = 0; // the offset just past the trap instruction
+	std::size_t displacedOffset_ = 0; // the offset of the copy of the displaced instruction
+};
+
+// Hands out space for trampolines from the unused ends of the pages holding
+// the executable segments of mapped ELF images, within reach of a rel32 jump
+// from the site. Once a region is unmapped, the space in it and the traps of
+// the trampolines there must be dropped with removeRegions.
+class TrampolineArena {
+public:
+	// returns the address just past the code in an executable region, where
+	// its cave starts, or 0 if there is no room after the code in it
+	using SegmentEnd = std::function<edb::address_t(const std::shared_ptr<IRegion> &region)>;
+
+public:
+	TrampolineArena();
+	explicit TrampolineArena(SegmentEnd segmentEnd);
+
+public:
+	edb::address_t allocate(edb::pid_t pid, const QList<std::shared_ptr<IRegion>> &regions, edb::address_t site, std::size_t size);
+	void release(IProcess *process, edb::address_t address, std::size_t size);
+	std::vector<edb::address_t> removeRegions(const QList<std::shared_ptr<IRegion>> &regions);
+
+public:
+	void addTrap(edb::address_t trap, edb::address_t site);
+	void removeTrap(edb::address_t trap);
+	std::optional<edb::address_t> siteForTrap(edb::address_t trap) const;
+
+private:
+	struct Cave {
+		edb::address_t next;
+		edb::address_t end;
+	};
+
+private:
+	Cave *findCave(const std::shared_ptr<IRegion> &region);
+
+private:
+	SegmentEnd segmentEnd_;
+	edb::pid_t pid_ = 0;
+	std::map<edb::address_t, Cave> caves_; // keyed by the start of their region
+	QHash<edb::address_t, edb::address_t> traps_;
+};
+
+}
+
+#endif
@@ -0,0 +1,339 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "DebugEventPump.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace DebuggerCorePlugin {
+
+namespace {
+
+using namespace std::chrono_literals;
+
+// how often the debuggee's threads are looked at while some other child of
+// ours has an event nobody collects
+constexpr auto ForeignPollInterval = 10ms;
+
+/**
+ * @brief wake_signal
+ * @return the signal used to get the pump thread out of waitid
+ */
+int wake_signal() {
+	return SIGRTMIN;
+}
+
+/**
+ * @brief wake_handler
+ */
+void wake_handler(int) {
+	// nothing to do, it only has to interrupt waitid
+}
+
+/**
+ * @brief has_event
+ * @param tid
+ * @return true if <tid> is a child of ours with an event waiting to be reaped
+ */
+bool has_event(edb::tid_t tid) {
+	siginfo_t info = {};
+	if (::waitid(P_PID, static_cast<id_t>(tid), &info, WEXITED | WSTOPPED | WNOWAIT | WNOHANG | __WALL) == -1) {
+		return false;
+	}
+
+	return info.si_pid != 0;
+}
+
+}
+
+/**
+ * @brief DebugEventPump::Shared::~Shared
+ */
+DebugEventPump::Shared::~Shared() {
+	if (eventFd != -1) {
+		::close(eventFd);
+	}
+}
+
+/**
+ * @brief DebugEventPump::DebugEventPump
+ */
+DebugEventPump::DebugEventPump()
+	: shared_(std::make_shared<Shared>()) {
+	shared_->eventFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+	// no SA_RESTART, so that the signal makes waitid fail with EINTR
+	struct sigaction action = {};
+	action.sa_handler       = wake_handler;
+	action.sa_flags         = 0;
+	sigemptyset(&action.sa_mask);
+
+	if (::sigaction(wake_signal(), &action, nullptr) == -1) {
+		::close(shared_->eventFd);
+		shared_->eventFd = -1;
+	}
+}
+
+/**
+ * @brief DebugEventPump::~DebugEventPump
+ */
+DebugEventPump::~DebugEventPump() {
+
+	std::unique_lock<std::mutex> lock(shared_->mutex);
+	shared_->quit = true;
+	shared_->cond.notify_all();
+
+	if (!thread_.joinable()) {
+		return;
+	}
+
+	// the notification only reaches the thread if it is waiting on us. If it
+	// is blocked in waitid, it takes a signal to get it out, and one sent just
+	// before it gets there is lost, so keep sending them until it is done
+	while (!shared_->stopped) {
+		::pthread_kill(thread_.native_handle(), wake_signal());
+		shared_->cond.wait_for(lock, ForeignPollInterval);
+	}
+
+	lock.unlock();
+	thread_.join();
+}
+
+/**
+ * @brief DebugEventPump::descriptor
+ * @return a descriptor which is readable while an event is waiting to be
+ * collected with wait(), or -1 if the pump couldn't be created
+ */
+int DebugEventPump::descriptor() const {
+	return shared_->eventFd;
+}
+
+/**
+ * tells the pump that there is a new debuggee to watch, starting the pump
+ * thread the first time it is called. Its threads have to be added first
+ *
+ * @brief DebugEventPump::start
+ */
+void DebugEventPump::start() {
+
+	if (shared_->eventFd == -1) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(shared_->mutex);
+		++shared_->sessions;
+		shared_->cond.notify_all();
+	}
+
+	if (!thread_.joinable()) {
+		thread_ = std::thread(run, shared_);
+	}
+}
+
+/**
+ * @brief DebugEventPump::addThread
+ * @param tid a thread of the debuggee
+ */
+void DebugEventPump::addThread(edb::tid_t tid) {
+	std::lock_guard<std::mutex> lock(shared_->mutex);
+	shared_->threads.insert(tid);
+}
+
+/**
+ * @brief DebugEventPump::removeThread
+ * @param tid a thread which is no longer part of the debuggee
+ */
+void DebugEventPump::removeThread(edb::tid_t tid) {
+	std::lock_guard<std::mutex> lock(shared_->mutex);
+	shared_->threads.erase(tid);
+}
+
+/**
+ * forgets the threads of the last debuggee
+ *
+ * @brief DebugEventPump::clear
+ */
+void DebugEventPump::clear() {
+	std::lock_guard<std::mutex> lock(shared_->mutex);
+	shared_->threads.clear();
+}
+
+/**
+ * waits up to <msecs> for the pump to find a thread with an event waiting.
+ * If this returns a tid, the caller must try to reap it and then call
+ * acknowledge() before the pump looks for another one
+ *
+ * @brief DebugEventPump::wait
+ * @param msecs
+ * @return the tid of the thread, or 0 if there is none
+ */
+edb::tid_t DebugEventPump::wait(std::chrono::milliseconds msecs) {
+
+	if (shared_->eventFd == -1) {
+		return 0;
+	}
+
+	struct pollfd pfd = {shared_->eventFd, POLLIN, 0};
+	if (::poll(&pfd, 1, static_cast<int>(msecs.count())) <= 0) {
+		return 0;
+	}
+
+	uint64_t count;
+	if (::read(shared_->eventFd, &count, sizeof(count)) == -1) {
+		return 0;
+	}
+
+	return shared_->ready.exchange(0, std::memory_order_acquire);
+}
+
+/**
+ * lets the pump look for the next event
+ *
+ * @brief DebugEventPump::acknowledge
+ */
+void DebugEventPump::acknowledge() {
+	std::lock_guard<std::mutex> lock(shared_->mutex);
+	shared_->acknowledged = true;
+	shared_->cond.notify_all();
+}
+
+/**
+ * @brief DebugEventPump::run
+ * @param shared
+ */
+void DebugEventPump::run(const std::shared_ptr<Shared> &shared) {
+
+	pump(shared);
+
+	std::lock_guard<std::mutex> lock(shared->mutex);
+	shared->stopped = true;
+	shared->cond.notify_all();
+}
+
+/**
+ * @brief DebugEventPump::pump
+ * @param shared
+ */
+void DebugEventPump::pump(const std::shared_ptr<Shared> &shared) {
+
+	uint64_t session   = 0;
+	edb::tid_t foreign = 0;
+
+	while (true) {
+
+		{
+			std::unique_lock<std::mutex> lock(shared->mutex);
+
+			// nothing to watch until a new debuggee is started
+			if (shared->threads.empty()) {
+				shared->cond.wait(lock, [&]() { return shared->quit || shared->sessions != session; });
+				session = shared->sessions;
+			}
+
+			if (shared->quit) {
+				return;
+			}
+		}
+
+		edb::tid_t ready = 0;
+
+		if (foreign != 0 && has_event(foreign)) {
+
+			// some other child of ours, such as one run by QProcess, has an
+			// event which nobody has collected. waitid(P_ALL) would report
+			// that one every time, so until it is gone, look at each of our
+			// own threads now and then instead
+			std::vector<edb::tid_t> threads;
+			{
+				std::lock_guard<std::mutex> lock(shared->mutex);
+				threads.assign(shared->threads.begin(), shared->threads.end());
+			}
+
+			auto it = std::find_if(threads.begin(), threads.end(), has_event);
+			if (it == threads.end()) {
+				std::unique_lock<std::mutex> lock(shared->mutex);
+				shared->cond.wait_for(lock, ForeignPollInterval, [&]() { return shared->quit; });
+				continue;
+			}
+
+			ready = *it;
+		} else {
+
+			foreign = 0;
+
+			// WNOWAIT leaves the event where it is, for the tracer to reap
+			siginfo_t info = {};
+			if (::waitid(P_ALL, 0, &info, WEXITED | WSTOPPED | WNOWAIT | __WALL) == -1) {
+				if (errno == EINTR) {
+					continue;
+				}
+
+				// there is nothing left to wait for until a new debuggee is started
+				std::unique_lock<std::mutex> lock(shared->mutex);
+				shared->cond.wait(lock, [&]() { return shared->quit || shared->sessions != session; });
+				session = shared->sessions;
+				continue;
+			}
+
+			if (info.si_pid == 0) {
+				continue;
+			}
+
+			// this is also how a new thread of the debuggee shows up before
+			// its creation has been handled, which polling takes care of too
+			{
+				std::lock_guard<std::mutex> lock(shared->mutex);
+				if (shared->threads.find(info.si_pid) == shared->threads.end()) {
+					foreign = info.si_pid;
+					continue;
+				}
+			}
+
+			ready = info.si_pid;
+		}
+
+		std::unique_lock<std::mutex> lock(shared->mutex);
+		if (shared->quit) {
+			return;
+		}
+
+		shared->acknowledged = false;
+		shared->ready.store(ready, std::memory_order_release);
+
+		const uint64_t one = 1;
+		if (::write(shared->eventFd, &one, sizeof(one)) == -1) {
+			return;
+		}
+
+		shared->cond.wait(lock, [&]() { return shared->quit || shared->acknowledged; });
+		if (shared->quit) {
+			return;
+		}
+	}
+}
+
+}
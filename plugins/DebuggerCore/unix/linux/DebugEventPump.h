@@ -0,0 +1,81 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DEBUG_EVENT_PUMP_H_20201016_
+#define DEBUG_EVENT_PUMP_H_20201016_
+
+#include "OSTypes.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+namespace DebuggerCorePlugin {
+
+// Watches for debug events on a thread of its own, so that the tracer doesn't
+// have to poll for them. Only the tracer may reap an event (ptrace requests have
+// to come from the thread which attached), so the pump just finds out which of
+// the debuggee's threads has an event waiting and hands its tid over, waking the
+// tracer through an eventfd.
+class DebugEventPump {
+public:
+	DebugEventPump();
+	~DebugEventPump();
+	DebugEventPump(const DebugEventPump &) = delete;
+	DebugEventPump &operator=(const DebugEventPump &) = delete;
+
+public:
+	int descriptor() const;
+	void start();
+	void addThread(edb::tid_t tid);
+	void removeThread(edb::tid_t tid);
+	void clear();
+	edb::tid_t wait(std::chrono::milliseconds msecs);
+	void acknowledge();
+
+private:
+	struct Shared {
+		~Shared();
+
+		int eventFd = -1;
+		std::atomic<edb::tid_t> ready{0};
+
+		std::mutex mutex;
+		std::condition_variable cond;
+		std::unordered_set<edb::tid_t> threads;
+		uint64_t sessions = 0;
+		bool acknowledged = false;
+		bool quit         = false;
+		bool stopped      = false;
+	};
+
+	static void run(const std::shared_ptr<Shared> &shared);
+	static void pump(const std::shared_ptr<Shared> &shared);
+
+private:
+	std::shared_ptr<Shared> shared_;
+	std::thread thread_;
+};
+
+}
+
+#endif
@@ -187,11 +187,13 @@ DebuggerCore::DebuggerCore()
 	Posix::initialize();
 
 	feature::detect_proc_access(&procMemReadBroken_, &procMemWriteBroken_);
+	feature::detect_process_vm_access(&processVmReadBroken_);
 
 	if (procMemReadBroken_ || procMemWriteBroken_) {
 
 		qDebug() << "Detect that read /proc/<pid>/mem works  = " << !procMemReadBroken_;
 		qDebug() << "Detect that write /proc/<pid>/mem works = " << !procMemWriteBroken_;
+		qDebug() << "Detect that process_vm_readv works      = " << !processVmReadBroken_;
 
 		QSettings settings;
 		const bool warn = settings.value("DebuggerCore/warn_on_broken_proc_mem.enabled", true).toBool();
@@ -307,6 +309,26 @@ long DebuggerCore::ptraceTraceme() {
 	return ptrace(PTRACE_TRACEME, 0, 0, 0);
 }
 
+/**
+ * @brief DebuggerCore::invalidateMemoryCache
+ */
+void DebuggerCore::invalidateMemoryCache() {
+	if (process_) {
+		static_cast<PlatformProcess *>(process_.get())->invalidateCache();
+	}
+}
+
+/**
+ * @brief DebuggerCore::invalidateThreadState
+ * @param tid
+ */
+void DebuggerCore::invalidateThreadState(edb::tid_t tid) {
+	auto it = threads_.find(tid);
+	if (it != threads_.end()) {
+		(*it)->invalidateState();
+	}
+}
+
 /**
  * @brief DebuggerCore::ptraceContinue
  * @param tid
@@ -319,6 +341,8 @@ Status DebuggerCore::ptraceContinue(edb::tid_t tid, long status) {
 	//               in the first place if we aren't stopped on this TID :-(
 	if (util::contains(waitedThreads_, tid)) {
 		Q_ASSERT(tid != 0);
+		invalidateMemoryCache();
+		invalidateThreadState(tid);
 		if (ptrace(PTRACE_CONT, tid, 0, status) == -1) {
 			const char *const strError = strerror(errno);
 			qWarning() << "Unable to continue thread" << tid << ": PTRACE_CONT failed:" << strError;
@@ -342,6 +366,8 @@ Status DebuggerCore::ptraceStep(edb::tid_t tid, long status) {
 	//               in the first place if we aren't stopped on this TID :-(
 	if (util::contains(waitedThreads_, tid)) {
 		Q_ASSERT(tid != 0);
+		invalidateMemoryCache();
+		invalidateThreadState(tid);
 		if (ptrace(PTRACE_SINGLESTEP, tid, 0, status) == -1) {
 			const char *const strError = strerror(errno);
 			qWarning() << "Unable to step thread" << tid << ": PTRACE_SINGLESTEP failed:" << strError;
@@ -431,6 +457,7 @@ void DebuggerCore::handleThreadExit(edb::tid_t tid, int status) {
 
 	threads_.remove(tid);
 	waitedThreads_.erase(tid);
+	eventPump_.removeThread(tid);
 }
 
 /**
@@ -451,6 +478,7 @@ std::shared_ptr<IDebugEvent> DebuggerCore::handleThreadCreate(edb::tid_t tid, in
 		auto new_thread = std::make_shared<PlatformThread>(this, process_, new_tid);
 
 		threads_.insert(new_tid, new_thread);
+		eventPump_.addThread(new_tid);
 
 		int thread_status = 0;
 		if (!util::contains(waitedThreads_, new_tid)) {
@@ -558,6 +586,9 @@ std::shared_ptr<IDebugEvent> DebuggerCore::handleEvent(edb::tid_t tid, int statu
 
 	stopThreads();
 
+	// anything we knew about the debuggee's memory is now potentially stale
+	invalidateMemoryCache();
+
 	// Some breakpoint types result in SIGILL or SIGSEGV. We'll transform the
 	// event into breakpoint event if such a breakpoint has triggered.
 	if (it != threads_.end() && WIFSTOPPED(status)) {
@@ -649,18 +680,60 @@ Status DebuggerCore::stopThreads() {
  */
 std::shared_ptr<IDebugEvent> DebuggerCore::waitDebugEvent(std::chrono::milliseconds msecs) {
 
+	// without an eventfd there is no pump, so look for events the old way
+	if (eventPump_.descriptor() == -1) {
+		if (process_) {
+			if (!Posix::wait_for_sigchld(msecs)) {
+				for (auto &thread : process_->threads()) {
+					int status;
+					const edb::tid_t tid = Posix::waitpid(thread->tid(), &status, __WALL | WNOHANG);
+					if (tid > 0) {
+						return handleEvent(tid, status);
+					}
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	const edb::tid_t ready = eventPump_.wait(msecs);
+	if (ready <= 0) {
+		return nullptr;
+	}
+
+	std::shared_ptr<IDebugEvent> e;
+
 	if (process_) {
-		if (!Posix::wait_for_sigchld(msecs)) {
+		int status;
+		if (threads_.contains(ready)) {
+			// if this fails, we got to it first, while stopping the other threads
+			if (Posix::waitpid(ready, &status, __WALL | WNOHANG) > 0) {
+				e = handleEvent(ready, status);
+			}
+		} else {
+			// most likely a thread which has just gone, so the event we're
+			// after belongs to one of the threads we do know
+			eventPump_.removeThread(ready);
 			for (auto &thread : process_->threads()) {
-				int status;
 				const edb::tid_t tid = Posix::waitpid(thread->tid(), &status, __WALL | WNOHANG);
 				if (tid > 0) {
-					return handleEvent(tid, status);
+					e = handleEvent(tid, status);
+					break;
 				}
 			}
 		}
 	}
-	return nullptr;
+
+	eventPump_.acknowledge();
+	return e;
+}
+
+/**
+ * @brief DebuggerCore::debugEventDescriptor
+ * @return
+ */
+int DebuggerCore::debugEventDescriptor() const {
+	return eventPump_.descriptor();
 }
 
 /**
@@ -681,6 +754,7 @@ int DebuggerCore::attachThread(edb::tid_t tid) {
 
 			threads_.insert(tid, newThread);
 			waitedThreads_.insert(tid);
+			eventPump_.addThread(tid);
 
 			const long options = ptraceOptions();
 
@@ -744,6 +818,7 @@ Status DebuggerCore::attach(edb::pid_t pid) {
 	if (!threads_.empty()) {
 		activeThread_ = pid;
 		detectCpuMode();
+		eventPump_.start();
 		return Status::Ok;
 	}
 
@@ -982,9 +1057,11 @@ Status DebuggerCore::open(const QString &path, const QString &cwd, const QList<Q
 			newThread->status_ = status;
 
 			threads_.insert(pid, newThread);
+			eventPump_.addThread(pid);
 
 			activeThread_ = pid;
 			detectCpuMode();
+			eventPump_.start();
 
 			return Status::Ok;
 		}
@@ -1005,6 +1082,7 @@ DebuggerCore::MeansOfCapture DebuggerCore::lastMeansOfCapture() const {
 void DebuggerCore::reset() {
 	threads_.clear();
 	waitedThreads_.clear();
+	eventPump_.clear();
 	activeThread_ = 0;
 }
 
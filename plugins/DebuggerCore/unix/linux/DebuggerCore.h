@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef DEBUGGER_CORE_H_20090529_
 #define DEBUGGER_CORE_H_20090529_
 
+#include "DebugEventPump.h"
 #include "DebuggerCoreBase.h"
 #include <QHash>
 #include <QObject>
@@ -56,6 +57,7 @@ public:
 	bool hasExtension(uint64_t ext) const override;
 	size_t pageSize() const override;
 	std::shared_ptr<IDebugEvent> waitDebugEvent(std::chrono::milliseconds msecs) override;
+	int debugEventDescriptor() const override;
 	std::size_t pointerSize() const override;
 	uint8_t nopFillByte() const override;
 	void kill() override;
@@ -103,6 +105,8 @@ private:
 	std::shared_ptr<IDebugEvent> handleThreadCreate(edb::tid_t tid, int status);
 	void detectCpuMode();
 	void handleThreadExit(edb::tid_t tid, int status);
+	void invalidateMemoryCache();
+	void invalidateThreadState(edb::tid_t tid);
 	void reset();
 
 private:
@@ -117,9 +121,11 @@ private:
 	edb::tid_t activeThread_;
 	std::shared_ptr<IProcess> process_;
 	threads_type threads_;
-	bool procMemReadBroken_  = true;
-	bool procMemWriteBroken_ = true;
-	std::size_t pointerSize_ = sizeof(void *);
+	DebugEventPump eventPump_;
+	bool procMemReadBroken_   = true;
+	bool procMemWriteBroken_  = true;
+	bool processVmReadBroken_ = true;
+	std::size_t pointerSize_  = sizeof(void *);
 #if defined(EDB_X86) || defined(EDB_X86_64)
 	const bool osIs64Bit_;
 	const edb::seg_reg_t userCodeSegment32_;
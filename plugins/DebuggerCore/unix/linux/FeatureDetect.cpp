@@ -25,6 +25,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <string>
 #include <sys/ptrace.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
@@ -82,17 +83,13 @@ void kill_child(int pid) {
 	}
 }
 
-}
-
 /**
- * detects whether or not reads/writes through /proc/<pid>/mem work correctly
+ * forks a child which is traced by us and waits for it to stop
  *
- * @brief detect_proc_access
- * @param read_broken
- * @param write_broken
- * @return
+ * @brief spawn_traced_child
+ * @return the pid of the stopped child, or -1 on failure
  */
-bool detect_proc_access(bool *read_broken, bool *write_broken) {
+pid_t spawn_traced_child() {
 
 	switch (pid_t pid = fork()) {
 	case 0:
@@ -111,70 +108,127 @@ bool detect_proc_access(bool *read_broken, bool *write_broken) {
 
 	case -1:
 		perror("fork");
-		return false;
+		return -1;
 
 	default: {
 		int status;
 		if (waitpid(pid, &status, __WALL) == -1) {
 			perror("parent: waitpid failed");
 			kill_child(pid);
-			return false;
+			return -1;
 		}
 
 		if (!WIFSTOPPED(status) || WSTOPSIG(status) != SIGCONT) {
 			std::cerr << "unexpected status returned by waitpid: 0x" << std::hex << status << "\n";
 			kill_child(pid);
-			return false;
+			return -1;
 		}
 
-		File file("/proc/" + std::to_string(pid) + "/mem");
-		if (!file) {
-			perror("failed to open memory file");
-			kill_child(pid);
-			return false;
-		}
+		return pid;
+	}
+	}
+}
 
-		const auto pageAlignMask = ~(sysconf(_SC_PAGESIZE) - 1);
-		const auto addr          = reinterpret_cast<uintptr_t>(&edb::v1::debugger_ui) & pageAlignMask;
-		file.seekp(addr);
-		if (!file) {
-			perror("failed to seek to address to read");
-			kill_child(pid);
-			return false;
-		}
+}
 
-		int buf = 0x12345678;
-		{
-			file.read(&buf, sizeof(buf));
-			if (!file) {
-				*read_broken  = true;
-				*write_broken = true;
-				kill_child(pid);
-				return false;
-			}
-		}
+/**
+ * detects whether or not reads/writes through /proc/<pid>/mem work correctly
+ *
+ * @brief detect_proc_access
+ * @param read_broken
+ * @param write_broken
+ * @return
+ */
+bool detect_proc_access(bool *read_broken, bool *write_broken) {
 
-		file.seekp(addr);
+	const pid_t pid = spawn_traced_child();
+	if (pid == -1) {
+		return false;
+	}
+
+	File file("/proc/" + std::to_string(pid) + "/mem");
+	if (!file) {
+		perror("failed to open memory file");
+		kill_child(pid);
+		return false;
+	}
+
+	const auto pageAlignMask = ~(sysconf(_SC_PAGESIZE) - 1);
+	const auto addr          = reinterpret_cast<uintptr_t>(&edb::v1::debugger_ui) & pageAlignMask;
+	file.seekp(addr);
+	if (!file) {
+		perror("failed to seek to address to read");
+		kill_child(pid);
+		return false;
+	}
+
+	int buf = 0x12345678;
+	{
+		file.read(&buf, sizeof(buf));
 		if (!file) {
-			perror("failed to seek to address to write");
+			*read_broken  = true;
+			*write_broken = true;
 			kill_child(pid);
 			return false;
 		}
+	}
 
-		{
-			file.write(&buf, sizeof(buf));
-			if (!file) {
-				*read_broken  = false;
-				*write_broken = true;
-			} else {
-				*read_broken  = false;
-				*write_broken = false;
-			}
-		}
+	file.seekp(addr);
+	if (!file) {
+		perror("failed to seek to address to write");
 		kill_child(pid);
-		return true;
+		return false;
 	}
+
+	{
+		file.write(&buf, sizeof(buf));
+		if (!file) {
+			*read_broken  = false;
+			*write_broken = true;
+		} else {
+			*read_broken  = false;
+			*write_broken = false;
+		}
 	}
+	kill_child(pid);
+	return true;
+}
+
+/**
+ * detects whether or not process_vm_readv can be used to read debuggee memory.
+ * It may be missing on older kernels, or forbidden by a seccomp policy even
+ * when ptrace itself is allowed
+ *
+ * @brief detect_process_vm_access
+ * @param read_broken
+ * @return
+ */
+bool detect_process_vm_access(bool *read_broken) {
+
+	const pid_t pid = spawn_traced_child();
+	if (pid == -1) {
+		return false;
+	}
+
+	// the child is a copy of us, so this address is mapped in it as well
+	const auto pageAlignMask = ~(sysconf(_SC_PAGESIZE) - 1);
+	const auto addr          = reinterpret_cast<uintptr_t>(&edb::v1::debugger_ui) & pageAlignMask;
+
+	int buf = 0;
+
+	struct iovec local_iov;
+	local_iov.iov_base = &buf;
+	local_iov.iov_len  = sizeof(buf);
+
+	struct iovec remote_iov;
+	remote_iov.iov_base = reinterpret_cast<void *>(addr);
+	remote_iov.iov_len  = sizeof(buf);
+
+	const ssize_t n = process_vm_readv(pid, &local_iov, 1, &remote_iov, 1, 0);
+	*read_broken    = (n != sizeof(buf)) || (buf != *reinterpret_cast<const int *>(addr));
+
+	kill_child(pid);
+	return true;
 }
 
 }
@@ -23,6 +23,7 @@ namespace DebuggerCorePlugin {
 namespace feature {
 
 bool detect_proc_access(bool *read_broken, bool *write_broken);
+bool detect_process_vm_access(bool *read_broken);
 
 }
 }
@@ -42,14 +42,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QFileInfo>
 #include <QTextStream>
 
-#include <fstream>
-
 #include <elf.h>
 #include <linux/limits.h>
 #include <pwd.h>
 #include <sys/mman.h>
 #include <sys/ptrace.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 namespace DebuggerCorePlugin {
@@ -58,11 +57,15 @@ namespace {
 // Used as size of ptrace word
 constexpr size_t WordSize = sizeof(long);
 
-template <class T>
-void hash_combine(std::size_t &seed, const T &v) {
-	std::hash<T> hasher;
-	seed ^= hasher(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-}
+// The kernel refuses process_vm_readv requests with more iovecs than this (UIO_MAXIOV)
+constexpr size_t MaxIovecs = 1024;
+
+// Reads larger than this bypass the page cache, they are typically scans
+// which would just evict everything that is actually being looked at
+constexpr size_t MaxCachedReadSize = 0x10000;
+
+// Upper bound on the number of pages we keep cached during a single stop
+constexpr int MaxCachedPages = 4096;
 
 /**
  * @brief set_ok
@@ -262,6 +265,256 @@ PlatformProcess::PlatformProcess(DebuggerCore *core, edb::pid_t pid)
 			}
 		}
 	}
+
+	if (readOnlyMemFile_) {
+		memoryAccess_ = MemoryAccess::ProcMemFile;
+	} else if (!core_->processVmReadBroken_) {
+		memoryAccess_ = MemoryAccess::ProcessVm;
+	} else {
+		memoryAccess_ = MemoryAccess::Ptrace;
+	}
+}
+
+/**
+ * reads <len> bytes into <buf> starting at <address> from the memory file.
+ *
+ * @brief PlatformProcess::memFileReadBytes
+ * @param address
+ * @param buf
+ * @param len
+ * @return the number of bytes read
+ */
+std::size_t PlatformProcess::memFileReadBytes(edb::address_t address, char *buf, std::size_t len) const {
+
+	Q_ASSERT(readOnlyMemFile_);
+
+	if (address > UINT64_MAX / 2) {
+		// pread64 takes a signed offset, so these have to go through a seek
+		seek_addr(*readOnlyMemFile_, address);
+		const quint64 read = readOnlyMemFile_->read(buf, len);
+		if (read == quint64(-1)) {
+			return 0;
+		}
+		return read;
+	}
+
+	const int fd     = readOnlyMemFile_->handle();
+	std::size_t read = 0;
+	while (read < len) {
+		const ssize_t n = ::pread64(fd, buf + read, len - read, static_cast<off64_t>(address + read));
+		if (n <= 0) {
+			break;
+		}
+		read += n;
+	}
+
+	return read;
+}
+
+/**
+ * reads <len> bytes into <buf> starting at <address> using process_vm_readv.
+ * The remote range is split into one iovec per page so that a read which runs
+ * into an unmapped page still returns everything before it.
+ *
+ * @brief PlatformProcess::processVmReadBytes
+ * @param address
+ * @param buf
+ * @param len
+ * @return the number of bytes read
+ */
+std::size_t PlatformProcess::processVmReadBytes(edb::address_t address, char *buf, std::size_t len) const {
+
+	if (EDB_IS_32_BIT && address > 0xffffffffULL) {
+		// we can't express such addresses in a native pointer
+		return 0;
+	}
+
+	const std::size_t page_size = core_->pageSize();
+	struct iovec remote_iov[MaxIovecs];
+
+	std::size_t read = 0;
+	while (read < len) {
+
+		std::size_t count     = 0;
+		std::size_t batch_len = 0;
+		while (count < MaxIovecs && read + batch_len < len) {
+			const edb::address_t remote_address = address + (read + batch_len);
+			const std::size_t to_page_end       = page_size - (remote_address & (page_size - 1));
+			const std::size_t n                 = std::min(to_page_end, len - read - batch_len);
+
+			remote_iov[count].iov_base = reinterpret_cast<void *>(remote_address.toUint());
+			remote_iov[count].iov_len  = n;
+			batch_len += n;
+			++count;
+		}
+
+		struct iovec local_iov;
+		local_iov.iov_base = buf + read;
+		local_iov.iov_len  = batch_len;
+
+		const ssize_t n = ::process_vm_readv(pid_, &local_iov, 1, remote_iov, count, 0);
+		if (n <= 0) {
+			break;
+		}
+
+		read += n;
+
+		// a short read means we ran into a page we can't read, so we're done
+		if (static_cast<std::size_t>(n) != batch_len) {
+			break;
+		}
+	}
+
+	return read;
+}
+
+/**
+ * reads <len> bytes into <buf> starting at <address> using PTRACE_PEEKTEXT.
+ * Only aligned words are requested, so a word never straddles a page boundary.
+ *
+ * @brief PlatformProcess::ptraceReadBytes
+ * @param address
+ * @param buf
+ * @param len
+ * @return the number of bytes read
+ */
+std::size_t PlatformProcess::ptraceReadBytes(edb::address_t address, char *buf, std::size_t len) const {
+
+	std::size_t read = 0;
+	while (read < len) {
+		const edb::address_t word_address = address + read;
+		const std::size_t offset          = word_address & (WordSize - 1);
+
+		bool ok;
+		const long value = ptracePeek(word_address - offset, &ok);
+		if (!ok) {
+			break;
+		}
+
+		// We aren't interested in `value` as in number, it's just a buffer, so no endianness magic.
+		const std::size_t n = std::min(WordSize - offset, len - read);
+		std::memcpy(buf + read, reinterpret_cast<const char *>(&value) + offset, n);
+		read += n;
+	}
+
+	return read;
+}
+
+/**
+ * reads <len> bytes into <buf> starting at <address> using the memory access
+ * method selected at attach time. Breakpoints are NOT hidden by this function.
+ *
+ * @brief PlatformProcess::rawReadBytes
+ * @param address
+ * @param buf
+ * @param len
+ * @return the number of bytes read
+ */
+std::size_t PlatformProcess::rawReadBytes(edb::address_t address, char *buf, std::size_t len) const {
+	switch (memoryAccess_) {
+	case MemoryAccess::ProcMemFile:
+		return memFileReadBytes(address, buf, len);
+	case MemoryAccess::ProcessVm:
+		if (const std::size_t read = processVmReadBytes(address, buf, len)) {
+			return read;
+		}
+		// process_vm_readv honors page protections while ptrace does not,
+		// so this may still succeed for things like PROT_NONE pages
+		return ptraceReadBytes(address, buf, len);
+	case MemoryAccess::Ptrace:
+		return ptraceReadBytes(address, buf, len);
+	}
+
+	return 0;
+}
+
+/**
+ * returns the contents of the page starting at <page>, reading it from the
+ * debuggee if it isn't already cached. The result is empty if the page
+ * could not be read.
+ *
+ * @brief PlatformProcess::cachedPage
+ * @param page - must be page aligned
+ * @return
+ */
+QByteArray PlatformProcess::cachedPage(edb::address_t page) const {
+
+	auto it = pageCache_.find(page);
+	if (it != pageCache_.end()) {
+		++cacheStatistics_.hits;
+		return it.value();
+	}
+
+	++cacheStatistics_.misses;
+
+	if (pageCache_.size() >= MaxCachedPages) {
+		pageCache_.clear();
+	}
+
+	QByteArray data(static_cast<int>(core_->pageSize()), Qt::Uninitialized);
+	data.resize(static_cast<int>(rawReadBytes(page, data.data(), data.size())));
+
+	pageCache_.insert(page, data);
+	return data;
+}
+
+/**
+ * reads <len> bytes into <buf> starting at <address>, going through the page
+ * cache for small reads. Breakpoints are NOT hidden by this function.
+ *
+ * @brief PlatformProcess::cachedReadBytes
+ * @param address
+ * @param buf
+ * @param len
+ * @return the number of bytes read
+ */
+std::size_t PlatformProcess::cachedReadBytes(edb::address_t address, char *buf, std::size_t len) const {
+
+	if (len > MaxCachedReadSize) {
+		return rawReadBytes(address, buf, len);
+	}
+
+	const std::size_t page_size = core_->pageSize();
+
+	std::size_t read = 0;
+	while (read < len) {
+		const edb::address_t current = address + read;
+		const std::size_t offset     = current & (page_size - 1);
+		const QByteArray page        = cachedPage(current - offset);
+
+		if (offset >= static_cast<std::size_t>(page.size())) {
+			break;
+		}
+
+		const std::size_t n = std::min(page.size() - offset, len - read);
+		std::memcpy(buf + read, page.constData() + offset, n);
+		read += n;
+
+		// a partially readable page means that nothing after it is readable either
+		if (static_cast<std::size_t>(page.size()) != page_size) {
+			break;
+		}
+	}
+
+	return read;
+}
+
+/**
+ * discards all cached debuggee memory, must be called whenever the
+ * debuggee's memory may have changed
+ *
+ * @brief PlatformProcess::invalidateCache
+ */
+void PlatformProcess::invalidateCache() {
+	pageCache_.clear();
+}
+
+/**
+ * @brief PlatformProcess::cacheStatistics
+ * @return the number of page cache hits and misses since we attached
+ */
+IProcess::CacheStatistics PlatformProcess::cacheStatistics() const {
+	return cacheStatistics_;
 }
 
 /**
@@ -296,58 +549,16 @@ std::size_t PlatformProcess::readBytes(edb::address_t address, void *buf, std::s
 				return 1;
 			}
 
-			if (readOnlyMemFile_) {
-				seek_addr(*readOnlyMemFile_, address);
-				read = readOnlyMemFile_->read(ptr, 1);
-				if (read == 1) {
-					return 1;
-				}
-				return 0;
-			} else {
-				bool ok;
-				uint8_t x = ptraceReadByte(address, &ok);
-				if (ok) {
-					*ptr = x;
-					return 1;
-				}
-				return 0;
-			}
+			return cachedReadBytes(address, ptr, 1);
 		}
 
-		if (readOnlyMemFile_) {
-			seek_addr(*readOnlyMemFile_, address);
-			read = readOnlyMemFile_->read(ptr, len);
-			if (read == 0 || read == quint64(-1)) {
-				return 0;
-			}
-		} else {
-			for (std::size_t index = 0; index < len; ++index) {
-
-				// read a byte, if we failed, we are done
-				bool ok;
-				const uint8_t x = ptraceReadByte(address + index, &ok);
-				if (!ok) {
-					break;
-				}
-
-				// store it
-				reinterpret_cast<char *>(buf)[index] = x;
-
-				++read;
-			}
+		read = cachedReadBytes(address, ptr, len);
+		if (read == 0) {
+			return 0;
 		}
 
 		// replace any breakpoints
-		Q_FOREACH (const std::shared_ptr<IBreakpoint> &bp, core_->breakpoints_) {
-			auto bpBytes                = bp->originalBytes();
-			const edb::address_t bpAddr = bp->address();
-			// show the original bytes in the buffer..
-			for (size_t i = 0; i < bp->size(); ++i) {
-				if (bpAddr + i >= address && bpAddr + i < address + read) {
-					ptr[bpAddr + i - address] = bpBytes[i];
-				}
-			}
-		}
+		core_->restoreOriginalBytes(address, ptr, read);
 	}
 
 	return read;
@@ -406,6 +617,8 @@ std::size_t PlatformProcess::writeBytes(edb::address_t address, const void *buf,
 	Q_ASSERT(core_->process_.get() == this);
 
 	if (len != 0) {
+		invalidateCache();
+
 		if (readWriteMemFile_) {
 			seek_addr(*readWriteMemFile_, address);
 			written = readWriteMemFile_->write(reinterpret_cast<const char *>(buf), len);
@@ -562,85 +775,47 @@ edb::address_t PlatformProcess::dataAddress() const {
  */
 QList<std::shared_ptr<IRegion>> PlatformProcess::regions() const {
 
-	static QList<std::shared_ptr<IRegion>> regions;
-	const QString map_file(QString("/proc/%1/maps").arg(pid_));
-
-	// hash the region file to see if it changed or not
-	{
-		static size_t totalHash = 0;
-
-		std::ifstream mf(map_file.toStdString());
-		size_t newHash = 0;
-		std::string line;
-
-		while (std::getline(mf, line)) {
-			hash_combine(newHash, line);
-		}
-
-		if (totalHash == newHash) {
-			return regions;
-		}
-
-		totalHash = newHash;
-		regions.clear();
+	QFile file(QString("/proc/%1/maps").arg(pid_));
+	if (!file.open(QIODevice::ReadOnly)) {
+		return regions_;
 	}
 
-	// it changed, so let's process it
-	QFile file(map_file);
-	if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-
-		QTextStream in(&file);
-		QString line = in.readLine();
-
-		while (!line.isNull()) {
-			if (std::shared_ptr<IRegion> region = process_map_line(line)) {
-				regions.push_back(region);
-			}
-			line = in.readLine();
-		}
+	// NOTE(eteran): procfs reports a size of 0, but readAll handles that fine
+	const QByteArray maps = file.readAll();
+	if (maps == mapsSnapshot_) {
+		return regions_;
 	}
 
-	return regions;
-}
-
-/**
- * @brief PlatformProcess::ptraceReadByte
- * @param address
- * @param ok
- * @return
- */
-uint8_t PlatformProcess::ptraceReadByte(edb::address_t address, bool *ok) const {
-	// TODO(eteran): assert that we are paused
-
-	Q_ASSERT(ok);
-	Q_ASSERT(core_->process_.get() == this);
-
-	*ok = false;
+	// it changed, so let's process it. Lines which are identical to the
+	// previous snapshot describe the same mapping, so we can reuse the
+	// region objects we already made for them
+	QList<std::shared_ptr<IRegion>> regions;
+	QHash<QByteArray, std::shared_ptr<IRegion>> regionsByLine;
 
-	// if this spot is unreadable, then just return 0xff, otherwise
-	// continue as normal.
+	const QList<QByteArray> lines = maps.split('\n');
+	regions.reserve(lines.size());
+	regionsByLine.reserve(lines.size());
 
-	// core_->page_size() - 1 will always be 0xf* because pagesizes
-	// are always 0x10*, so the masking works
-	// range of nBytesToNextPage is [1..n] where n=pagesize, and we have to adjust
-	// if nByteToNextPage < wordsize
-	const size_t nBytesToNextPage = core_->pageSize() - (address & (core_->pageSize() - 1));
-
-	// Avoid crossing page boundary, since next page may be unreadable
-	const size_t addressShift = nBytesToNextPage < WordSize ? WordSize - nBytesToNextPage : 0;
-	address -= addressShift;
+	for (const QByteArray &line : lines) {
+		if (line.isEmpty()) {
+			continue;
+		}
 
-	const long value = ptracePeek(address, ok);
+		std::shared_ptr<IRegion> region = regionsByLine_.value(line);
+		if (!region) {
+			region = process_map_line(QString::fromLocal8Bit(line));
+		}
 
-	if (*ok) {
-		uint8_t result;
-		// We aren't interested in `value` as in number, it's just a buffer, so no endianness magic.
-		// Just have to compensate for `addressShift` when reading it.
-		std::memcpy(&result, reinterpret_cast<const char *>(&value) + addressShift, sizeof(result));
-		return result;
+		if (region) {
+			regions.push_back(region);
+			regionsByLine.insert(line, region);
+		}
 	}
 
-	return 0xff;
+	mapsSnapshot_  = maps;
+	regions_       = regions;
+	regionsByLine_ = regionsByLine;
+	return regions_;
 }
 
 /**
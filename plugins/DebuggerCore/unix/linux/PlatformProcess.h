@@ -22,8 +22,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "IProcess.h"
 #include "Status.h"
 
+#include <QByteArray>
 #include <QCoreApplication>
 #include <QFile>
+#include <QHash>
 
 namespace DebuggerCorePlugin {
 
@@ -63,6 +65,7 @@ public:
 public:
 	edb::address_t debugPointer() const override;
 	edb::address_t calculateMain() const override;
+	CacheStatistics cacheStatistics() const override;
 
 public:
 	Status pause() override;
@@ -77,20 +80,48 @@ public:
 	std::size_t readPages(edb::address_t address, void *buf, size_t count) const override;
 	QMap<edb::address_t, Patch> patches() const override;
 
+public:
+	void invalidateCache();
+
+private:
+	// the mechanism used to read debuggee memory, picked at attach time
+	// in order of preference based on what the feature detection found to work
+	enum class MemoryAccess {
+		ProcMemFile, // pread64 on /proc/<pid>/mem
+		ProcessVm,   // process_vm_readv, one remote iovec per page
+		Ptrace,      // PTRACE_PEEKTEXT, one word at a time
+	};
+
 private:
 	bool ptracePoke(edb::address_t address, long value);
 	long ptracePeek(edb::address_t address, bool *ok) const;
-	uint8_t ptraceReadByte(edb::address_t address, bool *ok) const;
 	void ptraceWriteByte(edb::address_t address, uint8_t value, bool *ok);
+	std::size_t ptraceReadBytes(edb::address_t address, char *buf, std::size_t len) const;
+	std::size_t memFileReadBytes(edb::address_t address, char *buf, std::size_t len) const;
+	std::size_t processVmReadBytes(edb::address_t address, char *buf, std::size_t len) const;
+	std::size_t rawReadBytes(edb::address_t address, char *buf, std::size_t len) const;
+	std::size_t cachedReadBytes(edb::address_t address, char *buf, std::size_t len) const;
+	QByteArray cachedPage(edb::address_t page) const;
 
 private:
 	DebuggerCore *core_ = nullptr;
 	edb::pid_t pid_;
+	MemoryAccess memoryAccess_ = MemoryAccess::Ptrace;
 	std::shared_ptr<QFile> readOnlyMemFile_;
 	std::shared_ptr<QFile> readWriteMemFile_;
 	QMap<edb::address_t, Patch> patches_;
 	QString input_;
 	QString output_;
+
+	// the debuggee's memory can't change while it is stopped unless we write
+	// to it, so pages are cached until the next resume, step or write
+	mutable QHash<edb::address_t, QByteArray> pageCache_;
+	mutable CacheStatistics cacheStatistics_;
+
+	// the last contents of /proc/<pid>/maps we parsed, and what it parsed to
+	mutable QByteArray mapsSnapshot_;
+	mutable QList<std::shared_ptr<IRegion>> regions_;
+	mutable QHash<QByteArray, std::shared_ptr<IRegion>> regionsByLine_;
 };
 
 }
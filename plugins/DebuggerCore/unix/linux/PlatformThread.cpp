@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "DebuggerCore.h"
 #include "IProcess.h"
 #include "PlatformCommon.h"
+#include "PlatformState.h"
 #include "util/Container.h"
 
 #include <QDebug>
@@ -43,6 +44,11 @@ PlatformThread::PlatformThread(DebuggerCore *core, std::shared_ptr<IProcess> &pr
 	assert(core);
 }
 
+/**
+ * @brief PlatformThread::~PlatformThread
+ */
+PlatformThread::~PlatformThread() = default;
+
 /**
  * @brief PlatformThread::tid
  * @return
@@ -140,6 +146,37 @@ Status PlatformThread::resume(edb::EventStatus status) {
 	return core_->ptraceContinue(tid_, code);
 }
 
+/**
+ * reads only the general purpose registers, if we don't have them already
+ *
+ * @brief PlatformThread::stackPointer
+ * @return
+ */
+edb::address_t PlatformThread::stackPointer() {
+	return cachedState(GeneralRegisters)->stackPointer();
+}
+
+/**
+ * reads only the debug registers, if we don't have them already
+ *
+ * @brief PlatformThread::debugRegister
+ * @param n
+ * @return
+ */
+edb::reg_t PlatformThread::debugRegister(size_t n) {
+	return cachedState(DebugRegisters)->debugRegister(n);
+}
+
+/**
+ * forgets everything we know about this thread's registers, this must be
+ * called whenever it runs
+ *
+ * @brief PlatformThread::invalidateState
+ */
+void PlatformThread::invalidateState() {
+	cachedRegisters_ = 0;
+}
+
 /**
  * @brief PlatformThread::isPaused
  * @return true if this thread is currently in the debugger's wait list
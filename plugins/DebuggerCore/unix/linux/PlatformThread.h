@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "IBreakpoint.h"
 #include "IThread.h"
 #include <QCoreApplication>
+#include <cstdint>
 #include <memory>
 
 class IProcess;
@@ -37,7 +38,7 @@ class PlatformThread final : public IThread {
 
 public:
 	PlatformThread(DebuggerCore *core, std::shared_ptr<IProcess> &process, edb::tid_t tid);
-	~PlatformThread() override             = default;
+	~PlatformThread() override;
 	PlatformThread(const PlatformThread &) = delete;
 	PlatformThread &operator=(const PlatformThread &) = delete;
 
@@ -51,6 +52,8 @@ public:
 public:
 	void getState(State *state) override;
 	void setState(const State &state) override;
+	edb::address_t stackPointer() override;
+	edb::reg_t debugRegister(size_t n) override;
 
 public:
 	Status step() override;
@@ -61,6 +64,21 @@ public:
 public:
 	bool isPaused() const override;
 
+public:
+	void invalidateState();
+
+private:
+	// the registers are read from the thread one class at a time, and only
+	// when something asks for them. They are kept until the thread next runs
+	enum RegisterClass : uint8_t {
+		GeneralRegisters  = 0x01,
+		ExtendedRegisters = 0x02, // x87/SSE/AVX on x86, VFP on ARM
+		DebugRegisters    = 0x04,
+		AllRegisters      = GeneralRegisters | ExtendedRegisters | DebugRegisters,
+	};
+
+	const PlatformState *cachedState(uint8_t classes);
+
 private:
 	void fillSegmentBases(PlatformState *state);
 	bool fillStateFromPrStatus(PlatformState *state);
@@ -78,6 +96,8 @@ private:
 	std::shared_ptr<IProcess> process_;
 	edb::tid_t tid_;
 	int status_ = 0;
+	std::unique_ptr<PlatformState> stateCache_;
+	uint8_t cachedRegisters_ = 0;
 
 #if defined(EDB_ARM32) || defined(EDB_ARM64)
 private:
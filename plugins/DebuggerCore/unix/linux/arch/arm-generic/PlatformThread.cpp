@@ -120,18 +120,47 @@ bool PlatformThread::fillStateFromVFPRegs(PlatformState *state) {
 }
 
 /**
- * @brief PlatformThread::getState
- * @param state
+ * reads the registers in <classes> which we haven't already read since the
+ * thread last ran
+ *
+ * @brief PlatformThread::cachedState
+ * @param classes
+ * @return
  */
-void PlatformThread::getState(State *state) {
+const PlatformState *PlatformThread::cachedState(uint8_t classes) {
 	// TODO: assert that we are paused
 
-	core_->detectCpuMode();
+	if (!stateCache_) {
+		stateCache_ = std::make_unique<PlatformState>();
+	}
+
+	PlatformState *const state_impl = stateCache_.get();
 
-	if (auto state_impl = static_cast<PlatformState *>(state->impl_.get())) {
+	if ((classes & GeneralRegisters) && !(cachedRegisters_ & GeneralRegisters)) {
+
+		// the mode can only change while the thread is running
+		core_->detectCpuMode();
 
 		fillStateFromSimpleRegs(state_impl);
+		cachedRegisters_ |= GeneralRegisters;
+	}
+
+	if ((classes & ExtendedRegisters) && !(cachedRegisters_ & ExtendedRegisters)) {
 		fillStateFromVFPRegs(state_impl);
+		cachedRegisters_ |= ExtendedRegisters;
+	}
+
+	return state_impl;
+}
+
+/**
+ * @brief PlatformThread::getState
+ * @param state
+ */
+void PlatformThread::getState(State *state) {
+
+	if (auto state_impl = static_cast<PlatformState *>(state->impl_.get())) {
+		*state_impl = *cachedState(AllRegisters);
 	}
 }
 
@@ -156,6 +185,9 @@ void PlatformThread::setState(const State &state) {
 		if (ptrace(PTRACE_SETVFPREGS, tid_, 0, &fpr) == -1) {
 			perror("PTRACE_SETVFPREGS failed");
 		}
+
+		// the kernel may adjust what we wrote, so read it back when it's next needed
+		invalidateState();
 	}
 }
 
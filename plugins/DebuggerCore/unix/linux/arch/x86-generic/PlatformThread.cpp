@@ -157,19 +157,33 @@ bool PlatformThread::fillStateFromSimpleRegs(PlatformState *state) {
 }
 
 /**
- * @brief PlatformThread::getState
- * @param state
+ * reads the registers in <classes> which we haven't already read since the
+ * thread last ran
+ *
+ * @brief PlatformThread::cachedState
+ * @param classes
+ * @return
  */
-void PlatformThread::getState(State *state) {
+const PlatformState *PlatformThread::cachedState(uint8_t classes) {
 	// TODO: assert that we are paused
 
-	core_->detectCpuMode();
+	if (!stateCache_) {
+		stateCache_ = std::make_unique<PlatformState>();
+	}
 
-	if (auto state_impl = static_cast<PlatformState *>(state->impl_.get())) {
+	PlatformState *const state_impl = stateCache_.get();
+
+	if ((classes & GeneralRegisters) && !(cachedRegisters_ & GeneralRegisters)) {
+
+		// the mode can only change while the thread is running
+		core_->detectCpuMode();
 
 		// State must be cleared before filling to zero all presence flags, otherwise something
 		// may remain not updated. Also, this way we'll mark all the unfilled values.
-		state_impl->clear();
+		// The debug registers live alongside the GPRs, but are read separately
+		const auto dbgRegs = state_impl->x86.dbgRegs;
+		state_impl->x86.clear();
+		state_impl->x86.dbgRegs = dbgRegs;
 
 		if (EDB_IS_64_BIT) {
 			// 64-bit GETREGS call always returns 64-bit state, so use it
@@ -180,6 +194,14 @@ void PlatformThread::getState(State *state) {
 			// failing that, try to just get what we can
 		}
 
+		cachedRegisters_ |= GeneralRegisters;
+	}
+
+	if ((classes & ExtendedRegisters) && !(cachedRegisters_ & ExtendedRegisters)) {
+
+		state_impl->x87.clear();
+		state_impl->avx.clear();
+
 		// First try to get full XSTATE
 		X86XState xstate;
 		struct iovec iov = {&xstate, sizeof(xstate)};
@@ -215,10 +237,29 @@ void PlatformThread::getState(State *state) {
 			}
 		}
 
-		// debug registers
+		cachedRegisters_ |= ExtendedRegisters;
+	}
+
+	if ((classes & DebugRegisters) && !(cachedRegisters_ & DebugRegisters)) {
+
 		for (std::size_t i = 0; i < 8; ++i) {
 			state_impl->x86.dbgRegs[i] = getDebugRegister(i);
 		}
+
+		cachedRegisters_ |= DebugRegisters;
+	}
+
+	return state_impl;
+}
+
+/**
+ * @brief PlatformThread::getState
+ * @param state
+ */
+void PlatformThread::getState(State *state) {
+
+	if (auto state_impl = static_cast<PlatformState *>(state->impl_.get())) {
+		*state_impl = *cachedState(AllRegisters);
 	}
 }
 
@@ -253,9 +294,14 @@ void PlatformThread::setState(const State &state) {
 			ptrace(PTRACE_SETREGS, tid_, 0, &regs);
 		}
 
-		// debug registers
+		// debug registers, these are written one at a time so skip the ones
+		// which we know haven't changed
+		const bool dbgRegsCached = (cachedRegisters_ & DebugRegisters);
+
 		for (std::size_t i = 0; i < 8; ++i) {
-			setDebugRegister(i, state_impl->x86.dbgRegs[i]);
+			if (!dbgRegsCached || stateCache_->x86.dbgRegs[i] != state_impl->x86.dbgRegs[i]) {
+				setDebugRegister(i, state_impl->x86.dbgRegs[i]);
+			}
 		}
 
 		// hope for the best, adjust for reality
@@ -291,6 +337,9 @@ void PlatformThread::setState(const State &state) {
 				}
 			}
 		}
+
+		// the kernel may adjust what we wrote, so read it back when it's next needed
+		invalidateState();
 	}
 }
 
@@ -299,6 +348,11 @@ void PlatformThread::setState(const State &state) {
  * @return
  */
 edb::address_t PlatformThread::instructionPointer() const {
+
+	if (cachedRegisters_ & GeneralRegisters) {
+		return stateCache_->instructionPointer();
+	}
+
 #if defined(EDB_X86)
 	return ptrace(PTRACE_PEEKUSER, tid_, offsetof(UserRegsStructX86, eip), 0);
 #elif defined(EDB_X86_64)
@@ -96,8 +96,7 @@ DialogResults::DialogResults(QWidget *parent, Qt::WindowFlags f)
 
 							if (!bb.empty()) {
 
-								auto term  = bb.back();
-								auto &inst = *term;
+								edb::Instruction inst = bb.back().decode();
 
 								if (is_unconditional_jump(inst)) {
 
@@ -230,10 +230,11 @@ edb::EventStatus HardwareBreakpoints::handleEvent(const std::shared_ptr<IDebugEv
 		if (IProcess *process = edb::v1::debugger_core->process()) {
 			if (std::shared_ptr<IThread> thread = process->currentThread()) {
 				// check DR6 to see if it was a HW BP event
-				// if so, set the resume flag
-				State state;
-				thread->getState(&state);
-				if ((state.debugRegister(6) & 0x0f) != 0x00) {
+				// if so, set the resume flag. Only then do we need the rest
+				// of the state
+				if ((thread->debugRegister(6) & 0x0f) != 0x00) {
+					State state;
+					thread->getState(&state);
 					state.setFlags(state.flags() | (1 << 16));
 					thread->setState(state);
 				}
@@ -25,6 +25,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "MemoryRegions.h"
 #include "Module.h"
 #include "ResultViewModel.h"
+#include "StringExtractor.h"
 #include "Symbol.h"
 #include "edb.h"
 #include "util/Math.h"
@@ -46,6 +47,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QtDebug>
 #include <algorithm>
 #include <functional>
+#include <limits>
 
 namespace HeapAnalyzerPlugin {
 namespace {
@@ -392,27 +394,18 @@ void DialogHeap::collectBlocks(edb::address_t start_address, edb::address_t end_
 
 					// if this block is a container for an ascii string, display it...
 					// there is a lot of room for improvement here, but it's a start
-					QString asciiData;
-					QString utf16Data;
-					int asciisz;
-					int utf16sz;
-					if (edb::v1::get_ascii_string_at_address(
-							block_start(currentChunkAddress),
-							asciiData,
-							min_string_length,
-							currentChunk.chunkSize(),
-							asciisz)) {
-
-						data      = asciiData;
-						data_type = ResultViewModel::Result::Ascii;
-					} else if (edb::v1::get_utf16_string_at_address(
-								   block_start(currentChunkAddress),
-								   utf16Data,
-								   min_string_length,
-								   currentChunk.chunkSize(),
-								   utf16sz)) {
-						data      = utf16Data;
-						data_type = ResultViewModel::Result::Utf16;
+					const StringExtractor extractor(min_string_length, static_cast<int>(std::min<uint64_t>(currentChunk.chunkSize(), std::numeric_limits<int>::max())));
+
+					StringExtractor::Match match;
+					if (extractor.stringAt(block_start(currentChunkAddress), &match, &data)) {
+						switch (match.encoding) {
+						case StringExtractor::Encoding::Ascii:
+							data_type = ResultViewModel::Result::Ascii;
+							break;
+						case StringExtractor::Encoding::Utf16:
+							data_type = ResultViewModel::Result::Utf16;
+							break;
+						}
 					} else {
 
 						using std::memcmp;
@@ -22,8 +22,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "IRegion.h"
 #include "MemoryRegions.h"
 #include "ResultsModel.h"
+#include "StringExtractor.h"
 #include "edb.h"
-#include "util/Math.h"
 
 #include <QHeaderView>
 #include <QMessageBox>
@@ -74,13 +74,9 @@ void DialogStrings::showEvent(QShowEvent *) {
  */
 void DialogStrings::doFind() {
 
-	const int min_string_length = edb::v1::config().min_string_length;
-
 	const QItemSelectionModel *const selection_model = ui.tableView->selectionModel();
 	const QModelIndexList sel                        = selection_model->selectedRows();
 
-	QString str;
-
 	if (sel.size() == 0) {
 		QMessageBox::critical(
 			this,
@@ -91,39 +87,32 @@ void DialogStrings::doFind() {
 
 	auto resultsDialog = new DialogResults(this);
 
+	StringExtractor extractor(edb::v1::config().min_string_length);
+	extractor.setSearchUtf16(ui.search_unicode->isChecked());
+
 	for (const QModelIndex &selected_item : sel) {
 
 		const QModelIndex index = filterModel_->mapToSource(selected_item);
 
 		if (auto region = *reinterpret_cast<const std::shared_ptr<IRegion> *>(index.internalPointer())) {
 
-			edb::address_t start_address     = region->start();
-			const edb::address_t end_address = region->end();
-			const edb::address_t orig_start  = start_address;
-
 			// do the search for this region!
-			while (start_address < end_address) {
-
-				int string_length = 0;
-				bool ok           = edb::v1::get_ascii_string_at_address(start_address, str, min_string_length, 256, string_length);
-				if (ok) {
-					resultsDialog->addResult({start_address, str, ResultsModel::Result::Ascii});
-				} else if (ui.search_unicode->isChecked()) {
-					string_length = 0;
-					ok            = edb::v1::get_utf16_string_at_address(start_address, str, min_string_length, 256, string_length);
-					if (ok) {
-						resultsDialog->addResult({start_address, str, ResultsModel::Result::Utf16});
+			extractor.run(
+				region,
+				[resultsDialog](const StringExtractor::Match &match, const QString &str) {
+					switch (match.encoding) {
+					case StringExtractor::Encoding::Ascii:
+						resultsDialog->addResult({match.address, str, ResultsModel::Result::Ascii});
+						break;
+					case StringExtractor::Encoding::Utf16:
+						resultsDialog->addResult({match.address, str, ResultsModel::Result::Utf16});
+						break;
 					}
-				}
-
-				ui.progressBar->setValue(util::percentage((start_address - orig_start), region->size()));
-
-				if (ok) {
-					start_address += string_length;
-				} else {
-					++start_address;
-				}
-			}
+				},
+				[this](int percent) {
+					ui.progressBar->setValue(percent);
+					return true;
+				});
 		}
 	}
 
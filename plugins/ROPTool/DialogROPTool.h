@@ -19,7 +19,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef DIALOG_ROPTOOL_H_20100817_
 #define DIALOG_ROPTOOL_H_20100817_
 
-#include "Instruction.h"
 #include "Types.h"
 #include "ui_DialogROPTool.h"
 
@@ -27,8 +26,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QList>
 #include <QSet>
 #include <QSortFilterProxyModel>
-#include <memory>
-#include <vector>
 
 class QListWidgetItem;
 class QModelIndex;
@@ -40,6 +37,7 @@ namespace ROPToolPlugin {
 
 class ResultFilterProxy;
 class DialogResults;
+struct Gadget;
 
 class DialogROPTool : public QDialog {
 	Q_OBJECT
@@ -48,12 +46,9 @@ public:
 	explicit DialogROPTool(QWidget *parent = nullptr, Qt::WindowFlags f = Qt::WindowFlags());
 	~DialogROPTool() override = default;
 
-private:
-	using InstructionList = std::vector<std::shared_ptr<edb::Instruction>>;
-
 private:
 	void doFind();
-	void addGadget(DialogResults *results, const InstructionList &instructions);
+	void addGadget(DialogResults *results, const Gadget &gadget);
 
 private:
 	void showEvent(QShowEvent *event) override;
@@ -0,0 +1,376 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "GadgetDatabase.h"
+#include "edb.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtDebug>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace ROPToolPlugin {
+
+namespace {
+
+constexpr char Magic[8]   = {'E', 'D', 'B', 'G', 'A', 'D', 'G', 'T'};
+constexpr uint32_t Version = 1;
+
+enum GadgetFlags : uint32_t {
+	FlagPositionDependent = 0x01,
+};
+
+/**
+ * @brief format_key
+ * @return a string which identifies the formatter options that gadget text
+ * is rendered with, text rendered with other options is stored in another file
+ */
+QString format_key() {
+	const CapstoneEDB::Formatter::FormatOptions options = edb::v1::formatter().options();
+	return QString("%1%2%3%4")
+		.arg(options.syntax == CapstoneEDB::Formatter::SyntaxAtt ? 'a' : 'i')
+		.arg(options.capitalization == CapstoneEDB::Formatter::UpperCase ? 'u' : 'l')
+		.arg(options.tabBetweenMnemonicAndOperands ? 't' : 's')
+		.arg(options.simplifyRIPRelativeTargets ? 'r' : 'n');
+}
+
+}
+
+// NOTE(eteran): these are all multiples of 8 bytes in size, so every record in
+// the file is naturally aligned when the file is mapped
+struct GadgetDatabase::FileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t sectionCount;
+	uint32_t gadgetCount;
+	uint32_t reserved;
+	uint64_t stringsSize;
+};
+
+// a range of the module, relative to its base, which has been scanned
+struct GadgetDatabase::SectionRecord {
+	uint64_t start;
+	uint64_t end;
+	uint64_t base; // where the module was loaded when this range was scanned
+	uint32_t firstGadget;
+	uint32_t gadgetCount;
+};
+
+struct GadgetDatabase::GadgetRecord {
+	uint64_t offset;
+	uint32_t role;
+	uint32_t flags;
+	uint32_t textOffset;
+	uint32_t textSize;
+};
+
+/**
+ * @brief GadgetDatabase::GadgetDatabase
+ * @param module the path of the module's file
+ */
+GadgetDatabase::GadgetDatabase(const QString &module) {
+
+	const QByteArray md5 = edb::v1::get_file_md5(module);
+	if (md5.isEmpty()) {
+		return;
+	}
+
+	const QString directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+	if (directory.isEmpty()) {
+		return;
+	}
+
+	key_  = md5.toHex();
+	path_ = QString("%1/gadgets/%2-%3.gadgets").arg(directory, QString::fromLatin1(key_), format_key());
+	map();
+}
+
+/**
+ * @brief GadgetDatabase::~GadgetDatabase
+ */
+GadgetDatabase::~GadgetDatabase() {
+	unmap();
+}
+
+/**
+ * maps the database file into memory, if it exists and looks sane
+ *
+ * @brief GadgetDatabase::map
+ */
+void GadgetDatabase::map() {
+
+	unmap();
+
+	auto file = std::make_unique<QFile>(path_);
+	if (!file->open(QIODevice::ReadOnly)) {
+		return;
+	}
+
+	const qint64 size = file->size();
+	if (size < static_cast<qint64>(sizeof(FileHeader))) {
+		return;
+	}
+
+	const uchar *data = file->map(0, size);
+	if (!data) {
+		return;
+	}
+
+	auto hdr = reinterpret_cast<const FileHeader *>(data);
+
+	const uint64_t expected_size = sizeof(FileHeader) +
+								   uint64_t(hdr->sectionCount) * sizeof(SectionRecord) +
+								   uint64_t(hdr->gadgetCount) * sizeof(GadgetRecord) +
+								   hdr->stringsSize;
+
+	if (std::memcmp(hdr->magic, Magic, sizeof(Magic)) != 0 || hdr->version != Version || expected_size != static_cast<uint64_t>(size)) {
+		qDebug() << "[ROPTool] ignoring invalid gadget database" << path_;
+		return;
+	}
+
+	file_ = std::move(file);
+	data_ = data;
+	size_ = size;
+
+	// make sure that nothing in the file points outside of it
+	bool valid = true;
+
+	for (const SectionRecord *section = sections(); section != sections() + hdr->sectionCount; ++section) {
+		if (uint64_t(section->firstGadget) + section->gadgetCount > hdr->gadgetCount) {
+			valid = false;
+		}
+	}
+
+	for (const GadgetRecord *record = records(); record != records() + hdr->gadgetCount; ++record) {
+		if (uint64_t(record->textOffset) + record->textSize > hdr->stringsSize) {
+			valid = false;
+		}
+	}
+
+	if (!valid) {
+		qDebug() << "[ROPTool] ignoring corrupt gadget database" << path_;
+		unmap();
+	}
+}
+
+/**
+ * @brief GadgetDatabase::unmap
+ */
+void GadgetDatabase::unmap() {
+	file_.reset();
+	data_ = nullptr;
+	size_ = 0;
+}
+
+/**
+ * @brief GadgetDatabase::header
+ * @return
+ */
+const GadgetDatabase::FileHeader *GadgetDatabase::header() const {
+	return data_ ? reinterpret_cast<const FileHeader *>(data_) : nullptr;
+}
+
+/**
+ * @brief GadgetDatabase::sections
+ * @return
+ */
+const GadgetDatabase::SectionRecord *GadgetDatabase::sections() const {
+	return reinterpret_cast<const SectionRecord *>(data_ + sizeof(FileHeader));
+}
+
+/**
+ * @brief GadgetDatabase::records
+ * @return
+ */
+const GadgetDatabase::GadgetRecord *GadgetDatabase::records() const {
+	return reinterpret_cast<const GadgetRecord *>(sections() + header()->sectionCount);
+}
+
+/**
+ * turns a record back into a gadget for a module loaded at <moduleBase>.
+ * The text of a position dependent gadget is only correct for the base it was
+ * scanned at, so if the module moved, those get decoded again.
+ *
+ * @brief GadgetDatabase::makeGadget
+ * @param record
+ * @param section
+ * @param moduleBase
+ * @return
+ */
+Gadget GadgetDatabase::makeGadget(const GadgetRecord &record, const SectionRecord &section, edb::address_t moduleBase) const {
+
+	auto strings = reinterpret_cast<const char *>(records() + header()->gadgetCount);
+
+	Gadget gadget;
+	gadget.address           = moduleBase + record.offset;
+	gadget.role              = record.role;
+	gadget.positionDependent = (record.flags & FlagPositionDependent) != 0;
+
+	if (gadget.positionDependent && moduleBase != section.base) {
+		Gadget decoded;
+		if (GadgetScanner().decodeGadget(gadget.address, &decoded)) {
+			return decoded;
+		}
+	}
+
+	gadget.instructions = QString::fromUtf8(strings + record.textOffset, static_cast<int>(record.textSize));
+	return gadget;
+}
+
+/**
+ * returns the gadgets previously stored for the range [start, end) of the
+ * module loaded at <moduleBase>, or nothing if that range was never scanned
+ *
+ * @brief GadgetDatabase::gadgets
+ * @param moduleBase
+ * @param start
+ * @param end
+ * @return
+ */
+std::optional<QVector<Gadget>> GadgetDatabase::gadgets(edb::address_t moduleBase, edb::address_t start, edb::address_t end) const {
+
+	const FileHeader *const hdr = header();
+	if (!hdr) {
+		return {};
+	}
+
+	const SectionRecord *const first_section = sections();
+	const SectionRecord *const last_section  = first_section + hdr->sectionCount;
+
+	auto it = std::find_if(first_section, last_section, [&](const SectionRecord &section) {
+		return section.start == start - moduleBase && section.end == end - moduleBase;
+	});
+
+	if (it == last_section) {
+		return {};
+	}
+
+	QVector<Gadget> results;
+	results.reserve(static_cast<int>(it->gadgetCount));
+
+	const GadgetRecord *const first_record = records() + it->firstGadget;
+	for (const GadgetRecord *record = first_record; record != first_record + it->gadgetCount; ++record) {
+		results.push_back(makeGadget(*record, *it, moduleBase));
+	}
+
+	return results;
+}
+
+/**
+ * adds (or replaces) the gadgets for the range [start, end) of the module
+ * loaded at <moduleBase>
+ *
+ * @brief GadgetDatabase::store
+ * @param moduleBase
+ * @param start
+ * @param end
+ * @param gadgets
+ * @return true on success
+ */
+bool GadgetDatabase::store(edb::address_t moduleBase, edb::address_t start, edb::address_t end, const QVector<Gadget> &gadgets) {
+
+	if (!isValid()) {
+		return false;
+	}
+
+	std::vector<SectionRecord> new_sections;
+	std::vector<GadgetRecord> new_records;
+	QByteArray new_strings;
+
+	auto add_text = [&new_strings](const char *text, uint32_t size, GadgetRecord *record) {
+		record->textOffset = static_cast<uint32_t>(new_strings.size());
+		record->textSize   = size;
+		new_strings.append(text, static_cast<int>(size));
+	};
+
+	// carry over everything we already had, except the range being replaced
+	if (const FileHeader *const hdr = header()) {
+		auto strings = reinterpret_cast<const char *>(records() + hdr->gadgetCount);
+
+		for (const SectionRecord *section = sections(); section != sections() + hdr->sectionCount; ++section) {
+			if (section->start == start - moduleBase && section->end == end - moduleBase) {
+				continue;
+			}
+
+			SectionRecord new_section = *section;
+			new_section.firstGadget   = static_cast<uint32_t>(new_records.size());
+
+			const GadgetRecord *const first_record = records() + section->firstGadget;
+			for (const GadgetRecord *record = first_record; record != first_record + section->gadgetCount; ++record) {
+				GadgetRecord new_record = *record;
+				add_text(strings + record->textOffset, record->textSize, &new_record);
+				new_records.push_back(new_record);
+			}
+
+			new_sections.push_back(new_section);
+		}
+	}
+
+	SectionRecord section;
+	section.start       = start - moduleBase;
+	section.end         = end - moduleBase;
+	section.base        = moduleBase;
+	section.firstGadget = static_cast<uint32_t>(new_records.size());
+	section.gadgetCount = static_cast<uint32_t>(gadgets.size());
+	new_sections.push_back(section);
+
+	for (const Gadget &gadget : gadgets) {
+		const QByteArray text = gadget.instructions.toUtf8();
+
+		GadgetRecord record;
+		record.offset = gadget.address - moduleBase;
+		record.role   = gadget.role;
+		record.flags  = gadget.positionDependent ? FlagPositionDependent : 0;
+		add_text(text.constData(), static_cast<uint32_t>(text.size()), &record);
+		new_records.push_back(record);
+	}
+
+	FileHeader hdr;
+	std::memcpy(hdr.magic, Magic, sizeof(Magic));
+	hdr.version      = Version;
+	hdr.sectionCount = static_cast<uint32_t>(new_sections.size());
+	hdr.gadgetCount  = static_cast<uint32_t>(new_records.size());
+	hdr.reserved     = 0;
+	hdr.stringsSize  = static_cast<uint64_t>(new_strings.size());
+
+	QDir().mkpath(QFileInfo(path_).absolutePath());
+
+	QSaveFile file(path_);
+	if (!file.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+	file.write(reinterpret_cast<const char *>(new_sections.data()), static_cast<qint64>(new_sections.size() * sizeof(SectionRecord)));
+	file.write(reinterpret_cast<const char *>(new_records.data()), static_cast<qint64>(new_records.size() * sizeof(GadgetRecord)));
+	file.write(new_strings);
+
+	if (!file.commit()) {
+		return false;
+	}
+
+	map();
+	return true;
+}
+
+}
@@ -0,0 +1,78 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GADGET_DATABASE_H_20201016_
+#define GADGET_DATABASE_H_20201016_
+
+#include "GadgetScanner.h"
+#include "Types.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace ROPToolPlugin {
+
+// An on disk cache of the gadgets found in a module, so that we only have to
+// scan a given build of a library once. Files are named after the MD5 of the
+// module and the formatter options the gadgets' text was rendered with, and
+// gadgets are stored relative to the module's base address so that they can
+// be reused wherever the module gets loaded. The file is mapped into memory
+// and read in place.
+class GadgetDatabase {
+public:
+	explicit GadgetDatabase(const QString &module);
+	~GadgetDatabase();
+	GadgetDatabase(const GadgetDatabase &) = delete;
+	GadgetDatabase &operator=(const GadgetDatabase &) = delete;
+
+public:
+	bool isValid() const { return !key_.isEmpty(); }
+
+public:
+	std::optional<QVector<Gadget>> gadgets(edb::address_t moduleBase, edb::address_t start, edb::address_t end) const;
+	bool store(edb::address_t moduleBase, edb::address_t start, edb::address_t end, const QVector<Gadget> &gadgets);
+
+private:
+	struct FileHeader;
+	struct SectionRecord;
+	struct GadgetRecord;
+
+private:
+	void map();
+	void unmap();
+	const FileHeader *header() const;
+	const SectionRecord *sections() const;
+	const GadgetRecord *records() const;
+	Gadget makeGadget(const GadgetRecord &record, const SectionRecord &section, edb::address_t moduleBase) const;
+
+private:
+	QByteArray key_;
+	QString path_;
+	std::unique_ptr<QFile> file_;
+	const uchar *data_ = nullptr;
+	qint64 size_       = 0;
+};
+
+}
+
+#endif
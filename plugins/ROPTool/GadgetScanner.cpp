@@ -0,0 +1,638 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "GadgetScanner.h"
+#include "IDebugger.h"
+#include "IProcess.h"
+#include "IRegion.h"
+#include "edb.h"
+#include "util/Math.h"
+
+#include <QByteArray>
+#include <QFuture>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <deque>
+
+namespace ROPToolPlugin {
+
+namespace {
+
+/**
+ * @brief get_gadget_role
+ * @param inst
+ * @return
+ */
+uint32_t get_gadget_role(const edb::Instruction &inst) {
+	switch (inst.operation()) {
+	case X86_INS_ADD:
+	case X86_INS_ADC:
+	case X86_INS_SUB:
+	case X86_INS_SBB:
+	case X86_INS_IMUL:
+	case X86_INS_MUL:
+	case X86_INS_IDIV:
+	case X86_INS_DIV:
+	case X86_INS_INC:
+	case X86_INS_DEC:
+	case X86_INS_NEG:
+	case X86_INS_CMP:
+	case X86_INS_DAA:
+	case X86_INS_DAS:
+	case X86_INS_AAA:
+	case X86_INS_AAS:
+	case X86_INS_AAM:
+	case X86_INS_AAD:
+		// ALU ops
+		return 0x01;
+	case X86_INS_PUSH:
+	case X86_INS_PUSHAW:
+	case X86_INS_PUSHAL:
+	case X86_INS_POP:
+	case X86_INS_POPAW:
+	case X86_INS_POPAL:
+		// stack ops
+		return 0x02;
+	case X86_INS_AND:
+	case X86_INS_OR:
+	case X86_INS_XOR:
+	case X86_INS_NOT:
+	case X86_INS_SAR:
+	case X86_INS_SAL:
+	case X86_INS_SHR:
+	case X86_INS_SHL:
+	case X86_INS_SHRD:
+	case X86_INS_SHLD:
+	case X86_INS_ROR:
+	case X86_INS_ROL:
+	case X86_INS_RCR:
+	case X86_INS_RCL:
+	case X86_INS_BT:
+	case X86_INS_BTS:
+	case X86_INS_BTR:
+	case X86_INS_BTC:
+	case X86_INS_BSF:
+	case X86_INS_BSR:
+		// logic ops
+		return 0x04;
+	case X86_INS_MOV:
+	case X86_INS_MOVABS:
+	case X86_INS_CMOVA:
+	case X86_INS_CMOVAE:
+	case X86_INS_CMOVB:
+	case X86_INS_CMOVBE:
+	case X86_INS_CMOVE:
+	case X86_INS_CMOVG:
+	case X86_INS_CMOVGE:
+	case X86_INS_CMOVL:
+	case X86_INS_CMOVLE:
+	case X86_INS_CMOVNE:
+	case X86_INS_CMOVNO:
+	case X86_INS_CMOVNP:
+	case X86_INS_CMOVNS:
+	case X86_INS_CMOVO:
+	case X86_INS_CMOVP:
+	case X86_INS_CMOVS:
+	case X86_INS_XCHG:
+	case X86_INS_BSWAP:
+	case X86_INS_XADD:
+	case X86_INS_CMPXCHG:
+	case X86_INS_CWD:
+	case X86_INS_CDQ:
+	case X86_INS_CQO:
+	case X86_INS_CDQE:
+	case X86_INS_CBW:
+	case X86_INS_CWDE:
+	case X86_INS_MOVSX:
+	case X86_INS_MOVZX:
+	case X86_INS_MOVSXD:
+	case X86_INS_MOVBE:
+	case X86_INS_MOVSB:
+	case X86_INS_MOVSW:
+	case X86_INS_MOVSD:
+	case X86_INS_MOVSQ:
+	case X86_INS_CMPSB:
+	case X86_INS_CMPSW:
+	case X86_INS_CMPSD:
+	case X86_INS_CMPSQ:
+	case X86_INS_SCASB:
+	case X86_INS_SCASW:
+	case X86_INS_SCASD:
+	case X86_INS_SCASQ:
+	case X86_INS_LODSB:
+	case X86_INS_LODSW:
+	case X86_INS_LODSD:
+	case X86_INS_LODSQ:
+	case X86_INS_STOSB:
+	case X86_INS_STOSW:
+	case X86_INS_STOSD:
+	case X86_INS_STOSQ:
+	case X86_INS_CMPXCHG8B:
+	case X86_INS_CMPXCHG16B:
+		// data ops
+		return 0x08;
+	default:
+		// other ops
+		return 0x10;
+	}
+}
+
+// See issue #457, thanks mrexodia!
+/**
+ * @brief is_safe_64_nop_reg_op
+ * @param op
+ * @return
+ */
+bool is_safe_64_nop_reg_op(const edb::Operand &op) {
+
+	if (op->type != X86_OP_REG) {
+		return true; // a non-register is safe
+	}
+
+	if (edb::v1::debuggeeIs64Bit()) {
+		switch (op->reg) {
+		case X86_REG_EAX:
+		case X86_REG_EBX:
+		case X86_REG_ECX:
+		case X86_REG_EDX:
+		case X86_REG_EBP:
+		case X86_REG_ESP:
+		case X86_REG_ESI:
+		case X86_REG_EDI:
+			return false; // 32 bit register modifications clear the high part of the 64 bit register
+		default:
+			return true; // all other registers are safe
+		}
+	} else {
+		return true;
+	}
+}
+
+/**
+ * @brief is_effective_nop
+ * @param inst
+ * @return
+ */
+bool is_effective_nop(const edb::Instruction &inst) {
+
+	if (!inst) {
+		return false;
+	}
+
+	// trivially a nop
+	if (is_nop(inst)) {
+		return true;
+	}
+
+	switch (inst->id) {
+	case X86_INS_NOP:
+	case X86_INS_PAUSE:
+	case X86_INS_FNOP:
+		// nop
+		return true;
+	case X86_INS_MOV:
+	case X86_INS_CMOVA:
+	case X86_INS_CMOVAE:
+	case X86_INS_CMOVB:
+	case X86_INS_CMOVBE:
+	case X86_INS_CMOVE:
+	case X86_INS_CMOVNE:
+	case X86_INS_CMOVG:
+	case X86_INS_CMOVGE:
+	case X86_INS_CMOVL:
+	case X86_INS_CMOVLE:
+	case X86_INS_CMOVO:
+	case X86_INS_CMOVNO:
+	case X86_INS_CMOVP:
+	case X86_INS_CMOVNP:
+	case X86_INS_CMOVS:
+	case X86_INS_CMOVNS:
+	case X86_INS_MOVAPS:
+	case X86_INS_MOVAPD:
+	case X86_INS_MOVUPS:
+	case X86_INS_MOVUPD:
+	case X86_INS_XCHG:
+		// mov edi, edi
+		return inst[0]->type == X86_OP_REG && inst[1]->type == X86_OP_REG && inst[0]->reg == inst[1]->reg && is_safe_64_nop_reg_op(inst[0]);
+	case X86_INS_LEA: {
+		// lea eax, [eax + 0]
+		auto reg = inst[0]->reg;
+		auto mem = inst[1]->mem;
+		return inst[0]->type == X86_OP_REG && inst[1]->type == X86_OP_MEM && mem.disp == 0 &&
+			   ((mem.index == X86_REG_INVALID && mem.base == reg) ||
+				(mem.index == reg && mem.base == X86_REG_INVALID && mem.scale == 1)) &&
+			   is_safe_64_nop_reg_op(inst[0]);
+	}
+	case X86_INS_JMP:
+	case X86_INS_JA:
+	case X86_INS_JAE:
+	case X86_INS_JB:
+	case X86_INS_JBE:
+	case X86_INS_JE:
+	case X86_INS_JNE:
+	case X86_INS_JG:
+	case X86_INS_JGE:
+	case X86_INS_JL:
+	case X86_INS_JLE:
+	case X86_INS_JO:
+	case X86_INS_JNO:
+	case X86_INS_JP:
+	case X86_INS_JNP:
+	case X86_INS_JS:
+	case X86_INS_JNS:
+	case X86_INS_JECXZ:
+	case X86_INS_JRCXZ:
+	case X86_INS_JCXZ:
+		// jmp 0
+		return inst[0]->type == X86_OP_IMM && static_cast<edb::address_t>(inst[0]->imm) == inst.rva() + inst.byteSize();
+	case X86_INS_SHL:
+	case X86_INS_SHR:
+	case X86_INS_ROL:
+	case X86_INS_ROR:
+	case X86_INS_SAR:
+	case X86_INS_SAL:
+		// shl eax, 0
+		return inst[1]->type == X86_OP_IMM && inst[1]->imm == 0 && is_safe_64_nop_reg_op(inst[0]);
+	case X86_INS_SHLD:
+	case X86_INS_SHRD:
+		// shld eax, ebx, 0
+		return inst[2]->type == X86_OP_IMM && inst[2]->imm == 0 && is_safe_64_nop_reg_op(inst[0]) && is_safe_64_nop_reg_op(inst[1]);
+	default:
+		return false;
+	}
+}
+
+/**
+ * @brief is_position_dependent
+ * @param inst
+ * @return true if the way <inst> is displayed depends on its address
+ */
+bool is_position_dependent(const edb::Instruction &inst) {
+
+	for (std::size_t i = 0; i < inst.operandCount(); ++i) {
+		const edb::Operand op = inst[i];
+
+		if (is_immediate(op) && (is_jump(inst) || is_call(inst))) {
+			return true;
+		}
+
+		if (is_expression(op) && (op->mem.base == X86_REG_RIP || op->mem.base == X86_REG_EIP)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+}
+
+/**
+ * returns the offsets of every byte in <data> which may start an instruction
+ * that can end a gadget
+ *
+ * @brief GadgetScanner::findTerminators
+ * @param data
+ * @param size
+ * @return
+ */
+std::vector<std::size_t> GadgetScanner::findTerminators(const uint8_t *data, std::size_t size) {
+
+	std::vector<std::size_t> offsets;
+
+	for (std::size_t i = 0; i < size; ++i) {
+		switch (data[i]) {
+		case 0xc2: // ret imm16
+		case 0xc3: // ret
+			offsets.push_back(i);
+			break;
+		case 0xcd: // int 0x80
+			if (i + 1 < size && data[i + 1] == 0x80) {
+				offsets.push_back(i);
+			}
+			break;
+		case 0x0f: // syscall, sysenter
+			if (i + 1 < size && (data[i + 1] == 0x05 || data[i + 1] == 0x34)) {
+				offsets.push_back(i);
+			}
+			break;
+		case 0xff: // jmp reg
+			if (i + 1 < size && (data[i + 1] & 0xf8) == 0xe0) {
+				offsets.push_back(i);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	return offsets;
+}
+
+/**
+ * decodes the instructions at <first> and returns true if they form a gadget,
+ * in which case <instructions> holds them
+ *
+ * @brief GadgetScanner::matchGadget
+ * @param first
+ * @param last
+ * @param rva
+ * @param instructions
+ * @return
+ */
+bool GadgetScanner::matchGadget(const uint8_t *first, const uint8_t *last, edb::address_t rva, InstructionList *instructions) {
+
+	const uint8_t *p = first;
+
+	auto skip_nops = [&]() {
+		while (p < last) {
+			edb::Instruction inst(p, last, rva);
+			if (!is_effective_nop(inst)) {
+				break;
+			}
+
+			p += inst.byteSize();
+			rva += inst.byteSize();
+			instructions->push_back(std::move(inst));
+		}
+	};
+
+	// eat up any NOPs in front...
+	skip_nops();
+	if (p >= last) {
+		return false;
+	}
+
+	edb::Instruction inst1(p, last, rva);
+	if (!inst1.valid()) {
+		return false;
+	}
+
+	if (is_int(inst1) && is_immediate(inst1.operand(0)) && (inst1.operand(0)->imm & 0xff) == 0x80) {
+		instructions->push_back(std::move(inst1));
+		return true;
+	}
+
+	if (is_sysenter(inst1) || is_syscall(inst1)) {
+		instructions->push_back(std::move(inst1));
+		return true;
+	}
+
+	// a lone ret isn't interesting
+	if (is_ret(inst1)) {
+		return false;
+	}
+
+	p += inst1.byteSize();
+	rva += inst1.byteSize();
+	instructions->push_back(std::move(inst1));
+
+	// eat up any NOPs in between...
+	skip_nops();
+	if (p >= last) {
+		return false;
+	}
+
+	edb::Instruction inst2(p, last, rva);
+	if (is_ret(inst2)) {
+		instructions->push_back(std::move(inst2));
+		return true;
+	}
+
+	if (!inst2.valid() || inst2.operation() != X86_INS_POP) {
+		return false;
+	}
+
+	p += inst2.byteSize();
+	rva += inst2.byteSize();
+	if (p >= last) {
+		return false;
+	}
+
+	// pop reg; jmp reg
+	edb::Instruction inst3(p, last, rva);
+	if (inst3.valid() && is_jump(inst3)) {
+		if (inst2.operandCount() == 1 && is_register(inst2.operand(0))) {
+			if (inst3.operandCount() == 1 && is_register(inst3.operand(0))) {
+				if (inst2.operand(0)->reg == inst3.operand(0)->reg) {
+					instructions->push_back(std::move(inst2));
+					instructions->push_back(std::move(inst3));
+					return true;
+				}
+			}
+		}
+	}
+
+	// TODO(eteran): catch things like "add rsp, 8; jmp [rsp - 8]" and similar, it's rare,
+	// but could happen
+	return false;
+}
+
+/**
+ * @brief GadgetScanner::makeGadget
+ * @param instructions
+ * @return
+ */
+Gadget GadgetScanner::makeGadget(const InstructionList &instructions) {
+
+	Q_ASSERT(!instructions.empty());
+
+	auto it                       = instructions.begin();
+	const edb::Instruction &inst1 = *it++;
+
+	QString instruction_string = QString::fromStdString(edb::v1::formatter().toString(inst1));
+	for (; it != instructions.end(); ++it) {
+		instruction_string.append(QString("; %1").arg(QString::fromStdString(edb::v1::formatter().toString(*it))));
+	}
+
+	const bool position_dependent = std::any_of(instructions.begin(), instructions.end(), [](const edb::Instruction &inst) {
+		return is_position_dependent(inst);
+	});
+
+	// TODO(eteran): make this look for 1st non-NOP
+	return Gadget{inst1.rva(), instruction_string, get_gadget_role(inst1), position_dependent};
+}
+
+/**
+ * decodes the gadget which starts at <address> in the debuggee
+ *
+ * @brief GadgetScanner::decodeGadget
+ * @param address
+ * @param gadget
+ * @return true if there is a gadget at <address>
+ */
+bool GadgetScanner::decodeGadget(edb::address_t address, Gadget *gadget) const {
+
+	Q_ASSERT(gadget);
+
+	IProcess *process = edb::v1::debugger_core->process();
+	if (!process) {
+		return false;
+	}
+
+	uint8_t buffer[MaxGadgetSize];
+	const std::size_t n = process->readBytes(address, buffer, sizeof(buffer));
+	if (n == 0) {
+		return false;
+	}
+
+	InstructionList instructions;
+	if (!matchGadget(buffer, buffer + n, address, &instructions)) {
+		return false;
+	}
+
+	*gadget = makeGadget(instructions);
+	return true;
+}
+
+/**
+ * finds every gadget which starts in the first <limit> bytes of <data>, which
+ * holds <size> bytes of memory read from <base>. Bytes past <limit> are only
+ * used to finish decoding gadgets which start before it.
+ *
+ * @brief GadgetScanner::scan
+ * @param data
+ * @param size
+ * @param limit
+ * @param base
+ * @return
+ */
+QVector<Gadget> GadgetScanner::scan(const uint8_t *data, std::size_t size, std::size_t limit, edb::address_t base) const {
+
+	QVector<Gadget> gadgets;
+	InstructionList instructions;
+
+	// the first start address that we haven't tried yet, so that terminators
+	// which are close together don't cause the same address to be decoded twice
+	std::size_t next = 0;
+
+	for (std::size_t terminator : findTerminators(data, size)) {
+
+		const std::size_t first = std::max(next, terminator >= MaxGadgetSize - 1 ? terminator - (MaxGadgetSize - 1) : 0);
+		const std::size_t last  = std::min(terminator + 1, limit);
+
+		if (first >= limit) {
+			break;
+		}
+
+		for (std::size_t start = first; start < last; ++start) {
+			const uint8_t *const end = data + std::min(start + MaxGadgetSize, size);
+
+			instructions.clear();
+			if (matchGadget(data + start, end, base + start, &instructions)) {
+				gadgets.push_back(makeGadget(instructions));
+			}
+		}
+
+		next = std::max(next, last);
+	}
+
+	return gadgets;
+}
+
+/**
+ * reads <region> from the debuggee in large chunks and returns every gadget in
+ * it, in address order. The chunks are decoded on the thread pool while the
+ * next ones are being read.
+ *
+ * @brief GadgetScanner::scanRegion
+ * @param region
+ * @param progress
+ * @return
+ */
+QVector<Gadget> GadgetScanner::scanRegion(const std::shared_ptr<IRegion> &region, const std::function<void(int)> &progress) const {
+
+	QVector<Gadget> gadgets;
+
+	IProcess *process = edb::v1::debugger_core->process();
+	if (!process) {
+		return gadgets;
+	}
+
+	struct Pending {
+		QFuture<QVector<Gadget>> future;
+		edb::address_t done;
+	};
+
+	const std::size_t page_size = edb::v1::debugger_core->pageSize();
+	const edb::address_t end    = region->end();
+	edb::address_t address      = region->start();
+
+	// enough chunks to keep every core busy while we read the next one,
+	// but no more, so that memory use doesn't depend on the size of the region
+	const std::size_t max_pending = static_cast<std::size_t>(std::max(2, QThread::idealThreadCount() * 2));
+
+	std::deque<Pending> pending;
+
+	// chunks are collected in the order that they were submitted, which keeps
+	// the gadgets sorted by address
+	auto deliver = [&]() {
+		Pending &front = pending.front();
+		gadgets += front.future.result();
+
+		if (progress) {
+			progress(util::percentage(front.done, region->size()));
+		}
+
+		pending.pop_front();
+	};
+
+	while (address < end) {
+
+		const std::size_t remaining = end - address;
+		const std::size_t step      = std::min(ChunkSize, remaining);
+		const std::size_t want      = std::min(step + MaxGadgetSize - 1, remaining);
+
+		QByteArray chunk(static_cast<int>(want), Qt::Uninitialized);
+		const std::size_t n = process->readBytes(address, chunk.data(), want);
+
+		if (n != 0) {
+			chunk.resize(static_cast<int>(n));
+
+			const edb::address_t base = address;
+			const std::size_t limit   = std::min(step, n);
+
+			auto future = QtConcurrent::run([this, chunk, base, limit]() {
+				return scan(reinterpret_cast<const uint8_t *>(chunk.constData()), chunk.size(), limit, base);
+			});
+
+			pending.push_back(Pending{future, std::min<edb::address_t>(address + step, end) - region->start()});
+
+			if (pending.size() >= max_pending) {
+				deliver();
+			}
+		}
+
+		if (n < step) {
+			// we couldn't read all of it, so skip past the page that stopped us
+			const edb::address_t bad_address = address + n;
+			address                          = bad_address - (bad_address % page_size) + page_size;
+		} else {
+			address += step;
+		}
+	}
+
+	while (!pending.empty()) {
+		deliver();
+	}
+
+	return gadgets;
+}
+
+}
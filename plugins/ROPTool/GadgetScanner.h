@@ -0,0 +1,75 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GADGET_SCANNER_H_20201016_
+#define GADGET_SCANNER_H_20201016_
+
+#include "Instruction.h"
+#include "Types.h"
+
+#include <QString>
+#include <QVector>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class IRegion;
+
+namespace ROPToolPlugin {
+
+struct Gadget {
+	edb::address_t address = 0;
+	QString instructions;
+	uint32_t role = 0x00;
+
+	// true if the text of the instructions depends on where they are loaded,
+	// for example because they contain the target of a relative jump
+	bool positionDependent = false;
+};
+
+// Finds gadgets by first locating every byte which can start an instruction
+// that ends a gadget (ret, jmp reg, syscall, sysenter and int 0x80), then only
+// decoding the addresses in front of those which are close enough for a
+// gadget to reach them.
+class GadgetScanner {
+public:
+	// every kind of gadget we look for fits in this many bytes
+	static constexpr std::size_t MaxGadgetSize = 32;
+	static constexpr std::size_t ChunkSize     = 0x100000;
+
+public:
+	QVector<Gadget> scanRegion(const std::shared_ptr<IRegion> &region, const std::function<void(int)> &progress) const;
+	QVector<Gadget> scan(const uint8_t *data, std::size_t size, std::size_t limit, edb::address_t base) const;
+	bool decodeGadget(edb::address_t address, Gadget *gadget) const;
+
+public:
+	static std::vector<std::size_t> findTerminators(const uint8_t *data, std::size_t size);
+
+private:
+	using InstructionList = std::vector<edb::Instruction>;
+
+private:
+	static bool matchGadget(const uint8_t *first, const uint8_t *last, edb::address_t rva, InstructionList *instructions);
+	static Gadget makeGadget(const InstructionList &instructions);
+};
+
+}
+
+#endif
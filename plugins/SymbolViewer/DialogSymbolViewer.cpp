@@ -26,10 +26,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QMenu>
 #include <QPushButton>
-#include <QSortFilterProxyModel>
 #include <QStringListModel>
 
 namespace SymbolViewerPlugin {
+namespace {
+
+// with millions of symbols loaded, listing every match is more than anyone
+// will scroll through
+constexpr std::size_t MaxResults = 1000;
+
+}
 
 /**
  * @brief DialogSymbolViewer::DialogSymbolViewer
@@ -52,15 +58,13 @@ DialogSymbolViewer::DialogSymbolViewer(QWidget *parent, Qt::WindowFlags f)
 
 	ui.listView->setContextMenuPolicy(Qt::CustomContextMenu);
 
-	model_       = new QStringListModel(this);
-	filterModel_ = new QSortFilterProxyModel(this);
-
-	filterModel_->setFilterKeyColumn(0);
-	filterModel_->setSourceModel(model_);
-	ui.listView->setModel(filterModel_);
+	model_ = new QStringListModel(this);
+	ui.listView->setModel(model_);
 	ui.listView->setUniformItemSizes(true);
 
-	connect(ui.txtSearch, &QLineEdit::textChanged, filterModel_, &QSortFilterProxyModel::setFilterFixedString);
+	connect(ui.txtSearch, &QLineEdit::textChanged, this, [this]() {
+		doFind();
+	});
 }
 
 /**
@@ -156,11 +160,16 @@ void DialogSymbolViewer::mnuFollowInCPU() {
 
 /**
  * @brief DialogSymbolViewer::doFind
+ *
+ * lists the symbols matching the search text, best matches first, or all of
+ * them when there is no search text
  */
 void DialogSymbolViewer::doFind() {
 	QStringList results;
 
-	const std::vector<std::shared_ptr<Symbol>> symbols = edb::v1::symbol_manager().symbols();
+	const QString query = ui.txtSearch->text().trimmed();
+
+	const std::vector<std::shared_ptr<Symbol>> symbols = query.isEmpty() ? edb::v1::symbol_manager().symbols() : edb::v1::symbol_manager().search(query, MaxResults);
 	for (const std::shared_ptr<Symbol> &sym : symbols) {
 		results << QString("%1: %2").arg(edb::v1::format_pointer(sym->address), sym->name);
 	}
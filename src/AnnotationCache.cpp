@@ -0,0 +1,128 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "AnnotationCache.h"
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+namespace {
+
+// how long a single pass over the queue may take before it lets the event
+// loop run again, so that the GUI stays responsive even when a lot of new
+// addresses came into view at once
+constexpr qint64 ResolveBudget = 20;
+
+}
+
+//------------------------------------------------------------------------------
+// Name: AnnotationCache
+// Desc:
+//------------------------------------------------------------------------------
+AnnotationCache::AnnotationCache(QObject *parent)
+	: QObject(parent) {
+}
+
+//------------------------------------------------------------------------------
+// Name: find
+// Desc: returns the description of <address>, if it isn't known yet, <resolver>
+//       will be run for it later and a placeholder is returned for now
+//------------------------------------------------------------------------------
+QString AnnotationCache::find(Kind kind, edb::address_t address, const Resolver &resolver) {
+
+	const int index = static_cast<int>(kind);
+
+	auto it = entries_[index].find(address);
+	if (it != entries_[index].end()) {
+		return it.value();
+	}
+
+	if (!pending_[index].contains(address)) {
+		pending_[index].insert(address, resolver);
+
+		if (!scheduled_) {
+			scheduled_ = true;
+			QTimer::singleShot(0, this, &AnnotationCache::resolvePending);
+		}
+	}
+
+	// most things don't change from one stop to the next, so until we know
+	// better, the old description is the best guess
+	return previous_[index].value(address);
+}
+
+//------------------------------------------------------------------------------
+// Name: resolvePending
+// Desc: runs the resolvers of the queued addresses
+//------------------------------------------------------------------------------
+void AnnotationCache::resolvePending() {
+
+	scheduled_ = false;
+
+	QElapsedTimer timer;
+	timer.start();
+
+	for (int index = 0; index < KindCount; ++index) {
+
+		if (entries_[index].size() + pending_[index].size() > MaxEntries) {
+			entries_[index].clear();
+		}
+
+		for (auto it = pending_[index].begin(); it != pending_[index].end();) {
+			entries_[index].insert(it.key(), it.value()(it.key()));
+			it = pending_[index].erase(it);
+
+			if (timer.elapsed() > ResolveBudget) {
+				scheduled_ = true;
+				QTimer::singleShot(0, this, &AnnotationCache::resolvePending);
+				Q_EMIT updated();
+				return;
+			}
+		}
+	}
+
+	Q_EMIT updated();
+}
+
+//------------------------------------------------------------------------------
+// Name: invalidate
+// Desc: the debuggee may have changed, so everything has to be resolved again.
+//       the current descriptions are kept around as placeholders until then
+//------------------------------------------------------------------------------
+void AnnotationCache::invalidate() {
+	for (int index = 0; index < KindCount; ++index) {
+		// nothing may have been resolved since the last time, in which case
+		// the old placeholders are still the best we have
+		if (!entries_[index].isEmpty()) {
+			previous_[index] = std::move(entries_[index]);
+			entries_[index].clear();
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: clear
+// Desc: forgets everything, including the placeholders
+//------------------------------------------------------------------------------
+void AnnotationCache::clear() {
+	for (int index = 0; index < KindCount; ++index) {
+		entries_[index].clear();
+		previous_[index].clear();
+		pending_[index].clear();
+	}
+}
@@ -22,6 +22,27 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QString>
 #include <QTextStream>
 
+#include <cstring>
+
+/**
+ * @brief InstructionRecord::InstructionRecord
+ * @param inst
+ */
+InstructionRecord::InstructionRecord(const edb::Instruction &inst)
+	: address(inst.rva()), size(static_cast<uint8_t>(inst.byteSize())) {
+
+	Q_ASSERT(inst.byteSize() <= sizeof(bytes));
+	std::memcpy(bytes, inst.bytes(), size);
+}
+
+/**
+ * @brief InstructionRecord::decode
+ * @return the instruction these bytes decode to
+ */
+edb::Instruction InstructionRecord::decode() const {
+	return edb::Instruction(bytes, bytes + size, address.toUint());
+}
+
 /**
  * @brief BasicBlock::swap
  * @param other
@@ -36,7 +57,7 @@ void BasicBlock::swap(BasicBlock &other) {
  * @brief BasicBlock::push_back
  * @param inst
  */
-void BasicBlock::push_back(const instruction_pointer &inst) {
+void BasicBlock::push_back(const InstructionRecord &inst) {
 	instructions_.push_back(inst);
 }
 
@@ -182,8 +203,8 @@ BasicBlock::const_reference BasicBlock::back() const {
  */
 BasicBlock::size_type BasicBlock::byteSize() const {
 	size_type n = 0;
-	for (const instruction_pointer &inst : instructions_) {
-		n += inst->byteSize();
+	for (const InstructionRecord &inst : instructions_) {
+		n += inst.size;
 	}
 	return n;
 }
@@ -194,7 +215,7 @@ BasicBlock::size_type BasicBlock::byteSize() const {
  */
 edb::address_t BasicBlock::firstAddress() const {
 	Q_ASSERT(!empty());
-	return edb::address_t(front()->rva());
+	return front().address;
 }
 
 /**
@@ -203,7 +224,7 @@ edb::address_t BasicBlock::firstAddress() const {
  */
 edb::address_t BasicBlock::lastAddress() const {
 	Q_ASSERT(!empty());
-	return edb::address_t(back()->rva() + back()->byteSize());
+	return back().address + back().size;
 }
 
 /**
@@ -214,8 +235,9 @@ QString BasicBlock::toString() const {
 	QString text;
 	QTextStream ts(&text);
 
-	for (const instruction_pointer &inst : instructions_) {
-		ts << edb::address_t(inst->rva()).toPointerString() << ": " << edb::v1::formatter().toString(*inst).c_str() << "\n";
+	for (const InstructionRecord &record : instructions_) {
+		const edb::Instruction inst = record.decode();
+		ts << record.address.toPointerString() << ": " << edb::v1::formatter().toString(inst).c_str() << "\n";
 	}
 
 	return text;
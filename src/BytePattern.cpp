@@ -0,0 +1,322 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BytePattern.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <numeric>
+
+namespace {
+
+using ByteSet = std::array<bool, 256>;
+
+//------------------------------------------------------------------------------
+// Name: make_frequency_table
+// Desc: a rough idea of how often each byte value shows up in typical code and
+//       data, higher means more common. This only has to be good enough to
+//       steer the anchor away from things like 00, FF and REX prefixes.
+//------------------------------------------------------------------------------
+constexpr std::array<uint8_t, 256> make_frequency_table() {
+	std::array<uint8_t, 256> table = {};
+
+	for (std::size_t i = 0; i < table.size(); ++i) {
+		table[i] = 1;
+	}
+
+	for (std::size_t i = 'a'; i <= 'z'; ++i) {
+		table[i] = 4;
+	}
+
+	constexpr uint8_t common[] = {
+		0x01, 0x02, 0x03, 0x04, 0x08, 0x0f, 0x10, 0x20, 0x24, 0x44,
+		0x4c, 0x74, 0x75, 0x83, 0x85, 0x89, 0x8b, 0x90, 0xc0, 0xc3,
+		0xcc, 0xe8};
+
+	for (uint8_t value : common) {
+		table[value] = 8;
+	}
+
+	table[0x48] = 16;
+	table[0xff] = 32;
+	table[0x00] = 64;
+	return table;
+}
+
+constexpr std::array<uint8_t, 256> ByteFrequency = make_frequency_table();
+
+//------------------------------------------------------------------------------
+// Name: hex_value
+// Desc: returns the value of a hex digit, or -1 if <ch> isn't one
+//------------------------------------------------------------------------------
+int hex_value(QChar ch) {
+	const ushort c = ch.unicode();
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	}
+
+	if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	}
+
+	if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+
+	return -1;
+}
+
+//------------------------------------------------------------------------------
+// Name: is_nibble
+// Desc: returns true if <ch> can appear in a byte, either a hex digit or a
+//       wildcard
+//------------------------------------------------------------------------------
+bool is_nibble(QChar ch) {
+	return ch == QLatin1Char('?') || hex_value(ch) != -1;
+}
+
+}
+
+//------------------------------------------------------------------------------
+// Name: compile
+// Desc: parses <pattern> into a matcher, see BytePattern.h for the syntax
+//------------------------------------------------------------------------------
+Result<BytePattern, QString> BytePattern::compile(const QString &pattern) {
+
+	BytePattern result;
+
+	const int length = pattern.size();
+	int i            = 0;
+
+	auto skip_space = [&]() {
+		while (i < length && pattern[i].isSpace()) {
+			++i;
+		}
+	};
+
+	// adds every value matched by the byte at <i> to <set>
+	auto parse_byte = [&](ByteSet *set) -> bool {
+		if (i >= length || !is_nibble(pattern[i])) {
+			return false;
+		}
+
+		// a lone '?' is the same as "??"
+		if (pattern[i] == QLatin1Char('?') && (i + 1 >= length || !is_nibble(pattern[i + 1]))) {
+			set->fill(true);
+			++i;
+			return true;
+		}
+
+		if (i + 1 >= length || !is_nibble(pattern[i + 1])) {
+			return false;
+		}
+
+		const int hi = hex_value(pattern[i]);
+		const int lo = hex_value(pattern[i + 1]);
+		i += 2;
+
+		const int mask  = (hi != -1 ? 0xf0 : 0x00) | (lo != -1 ? 0x0f : 0x00);
+		const int value = (hi != -1 ? hi << 4 : 0x00) | (lo != -1 ? lo : 0x00);
+
+		for (int b = 0; b < 256; ++b) {
+			if ((b & mask) == value) {
+				(*set)[b] = true;
+			}
+		}
+
+		return true;
+	};
+
+	skip_space();
+	while (i < length) {
+
+		const int start = i;
+		ByteSet set     = {};
+
+		if (pattern[i] == QLatin1Char('(')) {
+			++i;
+
+			for (;;) {
+				skip_space();
+				if (!parse_byte(&set)) {
+					return make_unexpected(tr("Expected a byte at offset %1").arg(i));
+				}
+				skip_space();
+
+				if (i >= length || pattern[i] != QLatin1Char('|')) {
+					break;
+				}
+				++i;
+			}
+
+			if (i >= length || pattern[i] != QLatin1Char(')')) {
+				return make_unexpected(tr("Unterminated alternation starting at offset %1").arg(start));
+			}
+			++i;
+		} else if (!parse_byte(&set)) {
+			return make_unexpected(tr("Unexpected character '%1' at offset %2").arg(pattern[i]).arg(i));
+		}
+
+		for (bool allowed : set) {
+			result.table_.push_back(allowed ? 1 : 0);
+		}
+
+		++result.size_;
+		skip_space();
+	}
+
+	if (result.isEmpty()) {
+		return make_unexpected(tr("The pattern is empty"));
+	}
+
+	result.prepare();
+	return result;
+}
+
+//------------------------------------------------------------------------------
+// Name: fromBytes
+// Desc: creates a pattern which matches exactly <bytes>
+//------------------------------------------------------------------------------
+BytePattern BytePattern::fromBytes(const QByteArray &bytes) {
+
+	BytePattern result;
+	result.size_ = static_cast<std::size_t>(bytes.size());
+	result.table_.resize(result.size_ * 256);
+
+	for (std::size_t i = 0; i < result.size_; ++i) {
+		result.table_[i * 256 + static_cast<uint8_t>(bytes[static_cast<int>(i)])] = 1;
+	}
+
+	result.prepare();
+	return result;
+}
+
+//------------------------------------------------------------------------------
+// Name: prepare
+// Desc: picks the anchor and the order in which the other positions are
+//       checked, based on how likely each one is to match by chance
+//------------------------------------------------------------------------------
+void BytePattern::prepare() {
+
+	std::vector<uint32_t> scores(size_);
+	std::vector<int> counts(size_);
+
+	for (std::size_t i = 0; i < size_; ++i) {
+		for (int b = 0; b < 256; ++b) {
+			if (accepts(i, static_cast<uint8_t>(b))) {
+				scores[i] += ByteFrequency[b];
+				++counts[i];
+			}
+		}
+	}
+
+	order_.resize(size_);
+	std::iota(order_.begin(), order_.end(), 0);
+	std::stable_sort(order_.begin(), order_.end(), [&scores](std::size_t lhs, std::size_t rhs) {
+		return scores[lhs] < scores[rhs];
+	});
+
+	anchor_     = order_.empty() ? 0 : order_.front();
+	anchorByte_ = -1;
+
+	if (!order_.empty() && counts[anchor_] == 1) {
+		for (int b = 0; b < 256; ++b) {
+			if (accepts(anchor_, static_cast<uint8_t>(b))) {
+				anchorByte_ = b;
+				break;
+			}
+		}
+	}
+
+	// the anchor is already known to match when we verify, and positions
+	// which match anything never need to be checked at all
+	order_.erase(std::remove_if(order_.begin(), order_.end(), [this, &counts](std::size_t i) {
+					 return i == anchor_ || counts[i] == 256;
+				 }),
+				 order_.end());
+}
+
+//------------------------------------------------------------------------------
+// Name: matches
+// Desc: returns true if the size() bytes at <p> match the pattern
+//------------------------------------------------------------------------------
+bool BytePattern::matches(const uint8_t *p) const {
+
+	if (isEmpty() || !accepts(anchor_, p[anchor_])) {
+		return false;
+	}
+
+	for (std::size_t i : order_) {
+		if (!accepts(i, p[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: find
+// Desc: returns a pointer to the first match which lies entirely within
+//       [first, last), or <last> if there is none. When the anchor is a single
+//       value, memchr is used to skip ahead to candidates since the C library
+//       has a vectorized version of it on every platform we care about.
+//------------------------------------------------------------------------------
+const uint8_t *BytePattern::find(const uint8_t *first, const uint8_t *last) const {
+
+	if (isEmpty() || static_cast<std::size_t>(last - first) < size_) {
+		return last;
+	}
+
+	// the range of addresses the anchor byte can be at for a match to fit
+	const uint8_t *p         = first + anchor_;
+	const uint8_t *const end = last - size_ + 1 + anchor_;
+	const uint8_t *const row = &table_[anchor_ * 256];
+
+	while (p < end) {
+		if (anchorByte_ != -1) {
+			p = static_cast<const uint8_t *>(std::memchr(p, anchorByte_, end - p));
+			if (!p) {
+				break;
+			}
+		} else {
+			while (p < end && !row[*p]) {
+				++p;
+			}
+
+			if (p == end) {
+				break;
+			}
+		}
+
+		const uint8_t *const candidate = p - anchor_;
+
+		auto it = std::find_if(order_.begin(), order_.end(), [this, candidate](std::size_t i) {
+			return !accepts(i, candidate[i]);
+		});
+
+		if (it == order_.end()) {
+			return candidate;
+		}
+
+		++p;
+	}
+
+	return last;
+}
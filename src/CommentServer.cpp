@@ -17,10 +17,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "CommentServer.h"
+#include "AnnotationCache.h"
 #include "Configuration.h"
 #include "IDebugger.h"
 #include "IProcess.h"
 #include "Instruction.h"
+#include "MemoryRegions.h"
+#include "StringExtractor.h"
 #include "edb.h"
 
 namespace {
@@ -94,18 +97,45 @@ Result<QString, QString> CommentServer::resolveString(edb::address_t address) co
 	const int min_string_length   = edb::v1::config().min_string_length;
 	constexpr int MaxStringLength = 256;
 
-	int stringLen;
+	const StringExtractor extractor(min_string_length, MaxStringLength);
+
+	StringExtractor::Match match;
 	QString temp;
 
-	if (edb::v1::get_ascii_string_at_address(address, temp, min_string_length, MaxStringLength, stringLen)) {
-		return tr("ASCII \"%1\"").arg(temp);
-	} else if (edb::v1::get_utf16_string_at_address(address, temp, min_string_length, MaxStringLength, stringLen)) {
-		return tr("UTF16 \"%1\"").arg(temp);
+	if (extractor.stringAt(address, &match, &temp)) {
+		switch (match.encoding) {
+		case StringExtractor::Encoding::Ascii:
+			return tr("ASCII \"%1\"").arg(temp);
+		case StringExtractor::Encoding::Utf16:
+			return tr("UTF16 \"%1\"").arg(temp);
+		}
 	}
 
 	return make_unexpected(tr("Failed to resolve string"));
 }
 
+/**
+ * @brief CommentServer::resolvePointer
+ * @param address
+ * @return a description of what <address> points to, or an empty string
+ */
+QString CommentServer::resolvePointer(edb::address_t address) const {
+
+	// most values on the stack aren't pointers, don't bother reading
+	// anything for the ones which can't be
+	if (!edb::v1::memory_regions().findRegion(address)) {
+		return QString();
+	}
+
+	if (Result<QString, QString> ret = resolveFunctionCall(address)) {
+		return *ret;
+	} else if (Result<QString, QString> ret = resolveString(address)) {
+		return *ret;
+	}
+
+	return QString();
+}
+
 /**
  * @brief CommentServer::comment
  * @param address
@@ -124,13 +154,14 @@ QString CommentServer::comment(edb::address_t address, int size) const {
 				auto it = customComments_.find(value);
 				if (it != customComments_.end()) {
 					return it.value();
-				} else {
-					if (Result<QString, QString> ret = resolveFunctionCall(value)) {
-						return *ret;
-					} else if (Result<QString, QString> ret = resolveString(value)) {
-						return *ret;
-					}
 				}
+
+				// this is called for every row on every paint, so the
+				// description is looked up later and remembered until the
+				// next stop
+				return edb::v1::annotation_cache().find(AnnotationCache::Kind::Pointer, value, [this](edb::address_t pointer) {
+					return resolvePointer(pointer);
+				});
 			}
 		}
 	}
@@ -34,6 +34,7 @@ public:
 	void clear();
 
 private:
+	QString resolvePointer(edb::address_t address) const;
 	Result<QString, QString> resolveFunctionCall(edb::address_t address) const;
 	Result<QString, QString> resolveString(edb::address_t address) const;
 
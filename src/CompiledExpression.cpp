@@ -0,0 +1,389 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "CompiledExpression.h"
+#include "Register.h"
+#include "State.h"
+
+#include <QVarLengthArray>
+#include <algorithm>
+
+// NOTE(eteran): this uses the same parser as Expression<T>, so it accepts the
+// same language and reports the same errors, but emits code where
+// Expression<T> computes a value.
+class ExpressionCompiler {
+	friend class ExpressionParser<ExpressionCompiler>;
+
+public:
+	using Instruction = CompiledExpression::Instruction;
+	using Opcode      = CompiledExpression::Opcode;
+
+public:
+	ExpressionCompiler(const QString &expression, const CompiledExpression::VariableResolver &resolver)
+		: expression_(expression), resolver_(resolver) {
+	}
+
+public:
+	CompiledExpression compile() {
+		ExpressionParser<ExpressionCompiler> parser(expression_, this);
+		parser.parse();
+
+		CompiledExpression compiled;
+		compiled.program_    = std::move(program_);
+		compiled.variables_  = std::move(variables_);
+		compiled.stackDepth_ = maxDepth_;
+		return compiled;
+	}
+
+private:
+	// the code for each node has already been emitted by the time the parser
+	// hands it to us, so there is nothing to carry between them
+	struct value_type {};
+
+	void emit(Opcode opcode, uint64_t operand = 0) {
+		program_.push_back(Instruction{opcode, operand});
+
+		switch (opcode) {
+		case Opcode::Push:
+		case Opcode::Load:
+			maxDepth_ = std::max(maxDepth_, ++depth_);
+			break;
+		case Opcode::Deref:
+		case Opcode::Negate:
+		case Opcode::Complement:
+		case Opcode::Not:
+			break;
+		default:
+			--depth_;
+			break;
+		}
+	}
+
+	value_type number(quint64 value) {
+		emit(Opcode::Push, value);
+		return {};
+	}
+
+	value_type variable(const QString &name) {
+
+		ExpressionError error(ExpressionError::UnknownVariable);
+
+		const std::optional<CompiledExpression::Variable> variable = resolver_ ? resolver_(name, &error) : std::nullopt;
+		if (!variable) {
+			throw error;
+		}
+
+		// constants, such as symbols, are folded right into the program
+		if (variable->kind == CompiledExpression::Variable::Constant) {
+			emit(Opcode::Push, variable->value.toUint());
+		} else {
+			variables_.push_back(*variable);
+			emit(Opcode::Load, variables_.size() - 1);
+		}
+
+		return {};
+	}
+
+	value_type dereference(const value_type &) {
+		emit(Opcode::Deref);
+		return {};
+	}
+
+	value_type unary(ExpressionToken::Operator op, const value_type &) {
+		switch (op) {
+		case ExpressionToken::MINUS:
+			emit(Opcode::Negate);
+			break;
+		case ExpressionToken::CMP:
+			emit(Opcode::Complement);
+			break;
+		case ExpressionToken::NOT:
+			emit(Opcode::Not);
+			break;
+		default:
+			break;
+		}
+		return {};
+	}
+
+	value_type binary(ExpressionToken::Operator op, const value_type &, const value_type &) {
+		switch (op) {
+		case ExpressionToken::LOGICAL_AND:
+			emit(Opcode::LogicalAnd);
+			break;
+		case ExpressionToken::LOGICAL_OR:
+			emit(Opcode::LogicalOr);
+			break;
+		case ExpressionToken::AND:
+			emit(Opcode::And);
+			break;
+		case ExpressionToken::OR:
+			emit(Opcode::Or);
+			break;
+		case ExpressionToken::XOR:
+			emit(Opcode::Xor);
+			break;
+		case ExpressionToken::LT:
+			emit(Opcode::Less);
+			break;
+		case ExpressionToken::LE:
+			emit(Opcode::LessEqual);
+			break;
+		case ExpressionToken::GT:
+			emit(Opcode::Greater);
+			break;
+		case ExpressionToken::GE:
+			emit(Opcode::GreaterEqual);
+			break;
+		case ExpressionToken::EQ:
+			emit(Opcode::Equal);
+			break;
+		case ExpressionToken::NE:
+			emit(Opcode::NotEqual);
+			break;
+		case ExpressionToken::LSHFT:
+			emit(Opcode::ShiftLeft);
+			break;
+		case ExpressionToken::RSHFT:
+			emit(Opcode::ShiftRight);
+			break;
+		case ExpressionToken::PLUS:
+			emit(Opcode::Add);
+			break;
+		case ExpressionToken::MINUS:
+			emit(Opcode::Subtract);
+			break;
+		case ExpressionToken::MUL:
+			emit(Opcode::Multiply);
+			break;
+		case ExpressionToken::DIV:
+			emit(Opcode::Divide);
+			break;
+		case ExpressionToken::MOD:
+			emit(Opcode::Modulo);
+			break;
+		default:
+			break;
+		}
+		return {};
+	}
+
+private:
+	QString expression_;
+	const CompiledExpression::VariableResolver &resolver_;
+
+	std::vector<Instruction> program_;
+	std::vector<CompiledExpression::Variable> variables_;
+	std::size_t depth_    = 0;
+	std::size_t maxDepth_ = 0;
+};
+
+//------------------------------------------------------------------------------
+// Name: compile
+// Desc: parses the expression, resolving every name in it through resolver
+//------------------------------------------------------------------------------
+Result<CompiledExpression, ExpressionError> CompiledExpression::compile(const QString &expression, const VariableResolver &resolver) {
+	try {
+		ExpressionCompiler compiler(expression, resolver);
+		return compiler.compile();
+	} catch (const ExpressionError &e) {
+		return make_unexpected(e);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: evaluate
+// Desc: runs the program, taking register values from state and memory
+//       contents from reader
+//------------------------------------------------------------------------------
+Result<edb::address_t, ExpressionError> CompiledExpression::evaluate(const State &state, const MemoryReader &reader) const {
+
+	auto load = [&state](const Variable &variable, uint64_t *value, ExpressionError *error) {
+		switch (variable.kind) {
+		case Variable::GpRegister:
+			*value = state.gpRegister(variable.value.toUint()).valueAsInteger();
+			return true;
+		case Variable::InstructionPointer:
+			*value = state.instructionPointer().toUint();
+			return true;
+		case Variable::Flags:
+			*value = state.flags().toUint();
+			return true;
+		case Variable::NamedRegister: {
+			const Register reg = state.value(variable.name);
+			if (reg.bitSize() > 8 * sizeof(edb::address_t)) {
+				*error = ExpressionError(ExpressionError::VariableLargerThanAddress);
+				return false;
+			}
+			*value = reg.valueAsInteger();
+			return true;
+		}
+		default:
+			*value = variable.value.toUint();
+			return true;
+		}
+	};
+
+	return run(load, reader);
+}
+
+//------------------------------------------------------------------------------
+// Name: evaluate
+// Desc: runs the program, taking register values from registers and memory
+//       contents from reader
+//------------------------------------------------------------------------------
+Result<edb::address_t, ExpressionError> CompiledExpression::evaluate(const RegisterReader &registers, const MemoryReader &reader) const {
+
+	auto load = [&registers](const Variable &variable, uint64_t *value, ExpressionError *error) {
+		if (!registers) {
+			*error = ExpressionError(ExpressionError::UnknownVariable);
+			return false;
+		}
+
+		bool ok;
+		*value = registers(variable, &ok, error).toUint();
+		return ok;
+	};
+
+	return run(load, reader);
+}
+
+//------------------------------------------------------------------------------
+// Name: run
+// Desc: the interpreter itself, load reads the value of a variable
+//------------------------------------------------------------------------------
+template <class Load>
+Result<edb::address_t, ExpressionError> CompiledExpression::run(Load load, const MemoryReader &reader) const {
+
+	if (program_.empty()) {
+		return make_unexpected(ExpressionError(ExpressionError::Syntax));
+	}
+
+	QVarLengthArray<uint64_t, 32> stack(static_cast<int>(stackDepth_));
+	uint64_t *sp = stack.data();
+
+	for (const Instruction &inst : program_) {
+		switch (inst.opcode) {
+		case Opcode::Push:
+			*sp++ = inst.operand;
+			break;
+		case Opcode::Load: {
+			ExpressionError error;
+			if (!load(variables_[inst.operand], sp++, &error)) {
+				return make_unexpected(error);
+			}
+			break;
+		}
+		case Opcode::Deref: {
+			if (!reader) {
+				return make_unexpected(ExpressionError(ExpressionError::CannotReadMemory));
+			}
+
+			bool ok;
+			ExpressionError error;
+			const edb::address_t value = reader(sp[-1], &ok, &error);
+			if (!ok) {
+				return make_unexpected(error);
+			}
+			sp[-1] = value.toUint();
+			break;
+		}
+		case Opcode::Negate:
+			sp[-1] = 0 - sp[-1];
+			break;
+		case Opcode::Complement:
+			sp[-1] = ~sp[-1];
+			break;
+		case Opcode::Not:
+			sp[-1] = !sp[-1];
+			break;
+		default: {
+			const uint64_t rhs = *--sp;
+			uint64_t &lhs      = sp[-1];
+
+			switch (inst.opcode) {
+			case Opcode::And:
+				lhs &= rhs;
+				break;
+			case Opcode::Or:
+				lhs |= rhs;
+				break;
+			case Opcode::Xor:
+				lhs ^= rhs;
+				break;
+			case Opcode::LogicalAnd:
+				lhs = lhs && rhs;
+				break;
+			case Opcode::LogicalOr:
+				lhs = lhs || rhs;
+				break;
+			case Opcode::ShiftLeft:
+				lhs <<= rhs;
+				break;
+			case Opcode::ShiftRight:
+				lhs >>= rhs;
+				break;
+			case Opcode::Add:
+				lhs += rhs;
+				break;
+			case Opcode::Subtract:
+				lhs -= rhs;
+				break;
+			case Opcode::Multiply:
+				lhs *= rhs;
+				break;
+			case Opcode::Divide:
+				if (rhs == 0) {
+					return make_unexpected(ExpressionError(ExpressionError::DivideByZero));
+				}
+				lhs /= rhs;
+				break;
+			case Opcode::Modulo:
+				if (rhs == 0) {
+					return make_unexpected(ExpressionError(ExpressionError::DivideByZero));
+				}
+				lhs %= rhs;
+				break;
+			case Opcode::Less:
+				lhs = lhs < rhs;
+				break;
+			case Opcode::LessEqual:
+				lhs = lhs <= rhs;
+				break;
+			case Opcode::Greater:
+				lhs = lhs > rhs;
+				break;
+			case Opcode::GreaterEqual:
+				lhs = lhs >= rhs;
+				break;
+			case Opcode::Equal:
+				lhs = lhs == rhs;
+				break;
+			case Opcode::NotEqual:
+				lhs = lhs != rhs;
+				break;
+			default:
+				break;
+			}
+			break;
+		}
+		}
+	}
+
+	return edb::address_t(stack[0]);
+}
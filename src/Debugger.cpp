@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "Debugger.h"
+#include "AnnotationCache.h"
 #include "ArchProcessor.h"
 #include "CommentServer.h"
 #include "Configuration.h"
@@ -39,6 +40,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "IProcess.h"
 #include "IThread.h"
 #include "Instruction.h"
+#include "InstructionCache.h"
+#include "InstructionIndex.h"
 #include "MemoryRegions.h"
 #include "QHexView"
 #include "RecentFileManager.h"
@@ -76,6 +79,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QScreen>
 #include <QSettings>
 #include <QShortcut>
+#include <QSocketNotifier>
 #include <QStringListModel>
 #include <QTimer>
 #include <QToolButton>
@@ -170,6 +174,39 @@ bool is_instruction_ret(edb::address_t address) {
 	return false;
 }
 
+//--------------------------------------------------------------------------
+// Name: instruction_may_change_regions
+// Desc: returns true if executing the instruction at <address> could alter
+//       the memory map of the process. Only system calls can do that, but
+//       if we can't tell what is there, we have to assume that it might.
+//--------------------------------------------------------------------------
+bool instruction_may_change_regions(edb::address_t address) {
+#if defined(EDB_X86) || defined(EDB_X86_64)
+	uint8_t buffer[edb::Instruction::MaxSize];
+	if (const int size = edb::v1::get_instruction_bytes(address, buffer)) {
+		edb::Instruction inst(buffer, buffer + size, address);
+		return !inst || is_syscall(inst) || is_sysenter(inst) || is_interrupt(inst);
+	}
+#else
+	Q_UNUSED(address)
+#endif
+	return true;
+}
+
+//--------------------------------------------------------------------------
+// Name: thread_in_known_regions
+// Desc: returns true if both the instruction and stack pointers of <thread>
+//       are inside of regions we already know about. If the stack grew,
+//       the stack pointer will fall outside of them.
+//--------------------------------------------------------------------------
+bool thread_in_known_regions(IThread *thread) {
+
+	// this runs for every thread on every stop, so only ask for the two
+	// registers we need rather than the whole state
+	const MemoryRegions &regions = edb::v1::memory_regions();
+	return regions.findRegion(thread->stackPointer()) && regions.findRegion(thread->instructionPointer());
+}
+
 class RunUntilRet : public IDebugEventHandler {
 	Q_DECLARE_TR_FUNCTIONS(RunUntilRet)
 
@@ -472,6 +509,12 @@ Debugger::Debugger(QWidget *parent)
 	ui.action_Recent_Files->setMenu(recentFileManager_->createMenu());
 	connect(recentFileManager_, &RecentFileManager::fileSelected, this, &Debugger::openFile);
 
+	// symbols are loaded in the background, so names can show up at any time
+	connect(&edb::v1::symbol_manager(), &ISymbolManager::symbolsChanged, this, [this]() {
+		edb::v1::annotation_cache().invalidate();
+		refreshUi();
+	});
+
 	// make us the default event handler
 	edb::v1::add_debug_event_handler(this);
 
@@ -797,6 +840,9 @@ void Debugger::createDataTab() {
 
 	// NOTE(eteran): for issue #522, allow comments in data view when single word width
 	hexview->setCommentServer(commentServer_.get());
+	connect(&edb::v1::annotation_cache(), &AnnotationCache::updated, hexview.get(), [view = hexview.get()]() {
+		view->viewport()->update();
+	});
 
 	hexview->setData(new_data_view->stream.get());
 
@@ -1011,6 +1057,9 @@ void Debugger::setupStackView() {
 
 	// setup the comment server for the stack viewer
 	stackView_->setCommentServer(commentServer_.get());
+	connect(&edb::v1::annotation_cache(), &AnnotationCache::updated, stackView_.get(), [view = stackView_.get()]() {
+		view->viewport()->update();
+	});
 }
 
 //------------------------------------------------------------------------------
@@ -1335,7 +1384,9 @@ void Debugger::on_action_Configure_Debugger_triggered() {
 	// reload symbols in case they changed, or our symbol files changes
 	edb::v1::reload_symbols();
 
-	// re-read the memory region information
+	// re-read the memory region information, clearing it first so that every
+	// module is considered new and gets its symbols loaded again
+	edb::v1::memory_regions().clear();
 	edb::v1::memory_regions().sync();
 
 	// apply the selected fonts
@@ -1930,6 +1981,7 @@ void Debugger::cpuFill(uint8_t byte) {
 				QByteArray bytes(size, byte);
 
 				process->writeBytes(address, bytes.data(), size);
+				edb::v1::bytes_modified(address, size);
 
 				// do a refresh, not full update
 				refreshUi();
@@ -2032,9 +2084,9 @@ void Debugger::mnuCPUAddConditionalBreakpoint() {
 
 	const QString condition = QInputDialog::getText(this, tr("Set Breakpoint Condition"), tr("Expression:"), QLineEdit::Normal, QString(), &ok);
 	if (ok) {
-		if (std::shared_ptr<IBreakpoint> bp = edb::v1::create_breakpoint(address)) {
+		if (edb::v1::create_breakpoint(address)) {
 			if (!condition.isEmpty()) {
-				bp->condition = condition;
+				edb::v1::set_breakpoint_condition(address, condition);
 			}
 		}
 	}
@@ -2181,14 +2233,38 @@ void Debugger::mnuStackModify() {
 
 //------------------------------------------------------------------------------
 // Name: breakpoint_condition_true
-// Desc:
-//------------------------------------------------------------------------------
-bool Debugger::isBreakpointConditionTrue(const QString &condition) {
+// Desc: conditions are compiled the first time they are needed and then
+//       evaluated against the state of the thread which hit the breakpoint.
+//       If a condition can't be compiled yet (for example, it names a symbol
+//       which isn't loaded), that is remembered too and it is evaluated the
+//       slow way until the libraries change and we can try again.
+//------------------------------------------------------------------------------
+bool Debugger::isBreakpointConditionTrue(const QString &condition, const State &state) {
+
+	auto it = compiledConditions_.find(condition);
+	if (it == compiledConditions_.end()) {
+		Result<CompiledExpression, ExpressionError> compiled = edb::v2::compile_expression(condition);
+		if (compiled) {
+			it = compiledConditions_.insert(condition, std::move(*compiled));
+		} else {
+			it = compiledConditions_.insert(condition, std::nullopt);
+		}
+	}
 
-	if (std::optional<edb::address_t> condition_value = edb::v2::eval_expression(condition)) {
-		return *condition_value;
+	if (!*it) {
+		if (std::optional<edb::address_t> condition_value = edb::v2::eval_expression(condition)) {
+			return *condition_value;
+		}
+		return true;
 	}
-	return true;
+
+	const Result<edb::address_t, ExpressionError> condition_value = (*it)->evaluate(state, edb::v1::get_value);
+	if (!condition_value) {
+		QMessageBox::critical(this, tr("Error In Expression!"), condition_value.error().what());
+		return true;
+	}
+
+	return *condition_value;
 }
 
 //------------------------------------------------------------------------------
@@ -2230,6 +2306,10 @@ edb::EventStatus Debugger::handleTrap(const std::shared_ptr<IDebugEvent> &event)
 		// TODO(eteran): add an option to let the user stop of debug events
 		if (bp->internal() && bp->tag == ld_loader_tag) {
 
+			// the loader is telling us that libraries are being (un)mapped, and
+			// so conditions may now refer to symbols at different addresses
+			compiledConditions_.clear();
+
 			if (dynamicInfoBreakpointSet_) {
 				if (debugtPointer_) {
 					if (edb::v1::debuggeeIs32Bit()) {
@@ -2252,7 +2332,7 @@ edb::EventStatus Debugger::handleTrap(const std::shared_ptr<IDebugEvent> &event)
 
 		// handle conditional breakpoints
 		if (!condition.isEmpty()) {
-			if (!isBreakpointConditionTrue(condition)) {
+			if (!isBreakpointConditionTrue(condition, state)) {
 				return edb::DEBUG_CONTINUE_BP;
 			}
 		}
@@ -2570,6 +2650,9 @@ void Debugger::updateUi() {
 
 	if (edb::v1::debugger_core) {
 
+		// whatever the views described last time may not be true anymore
+		edb::v1::annotation_cache().invalidate();
+
 		State state;
 		if (IProcess *process = edb::v1::debugger_core->process()) {
 			if (std::shared_ptr<IThread> thread = process->currentThread()) {
@@ -2637,6 +2720,7 @@ void Debugger::resumeExecution(ExceptionResume pass_exception, DebugMode mode, R
 
 			if (mode == Step) {
 				reenableBreakpointStep_ = bp;
+				regionsMayHaveChanged_  = instruction_may_change_regions(thread->instructionPointer());
 				const auto stepStatus   = thread->step(status);
 				if (!stepStatus) {
 					QMessageBox::critical(this, tr("Error"), tr("Failed to step thread: %1").arg(stepStatus.error()));
@@ -2771,8 +2855,17 @@ void Debugger::on_action_Pause_triggered() {
 void Debugger::cleanupDebugger() {
 
 	timer_->stop();
+	if (debugEventNotifier_) {
+		debugEventNotifier_->setEnabled(false);
+	}
 
 	ui.cpuView->clearComments();
+	compiledConditions_.clear();
+	edb::v1::instruction_cache().clear();
+	edb::v1::instruction_index().clear();
+	edb::v1::clear_binary_info();
+	edb::v1::clear_modified();
+	edb::v1::annotation_cache().clear();
 	edb::v1::memory_regions().clear();
 	edb::v1::symbol_manager().clear();
 	edb::v1::arch_processor().reset();
@@ -2863,7 +2956,18 @@ void Debugger::detachFromProcess(DetachAction kill) {
 void Debugger::setInitialDebuggerState() {
 
 	updateMenuState(Paused);
-	timer_->start(0);
+
+	// if the core can tell us when it has an event for us, we don't need to poll it
+	const int fd = edb::v1::debugger_core->debugEventDescriptor();
+	if (fd != -1) {
+		if (!debugEventNotifier_) {
+			debugEventNotifier_ = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+			connect(debugEventNotifier_, &QSocketNotifier::activated, this, &Debugger::nextDebugEvent);
+		}
+		debugEventNotifier_->setEnabled(true);
+	} else {
+		timer_->start(0);
+	}
 
 	edb::v1::symbol_manager().clear();
 	edb::v1::memory_regions().sync();
@@ -2943,6 +3047,9 @@ void Debugger::setInitialBreakpoint(const QString &s) {
 	edb::address_t entryPoint = 0;
 
 	if (edb::v1::config().initial_breakpoint == Configuration::MainSymbol) {
+		// we need the program's symbols now, not whenever they're done loading
+		edb::v1::symbol_manager().waitForSymbolFile(s);
+
 		const QString mainSymbol          = QFileInfo(s).fileName() + "!main";
 		const std::shared_ptr<Symbol> sym = edb::v1::symbol_manager().find(mainSymbol);
 
@@ -3426,15 +3533,32 @@ void Debugger::nextDebugEvent() {
 
 	Q_ASSERT(edb::v1::debugger_core);
 
-	if (std::shared_ptr<IDebugEvent> e = edb::v1::debugger_core->waitDebugEvent(10ms)) {
+	// when we were woken by the core there is no need to wait
+	const auto timeout = (debugEventNotifier_ && debugEventNotifier_->isEnabled()) ? 0ms : 10ms;
+
+	if (std::shared_ptr<IDebugEvent> e = edb::v1::debugger_core->waitDebugEvent(timeout)) {
 
 		lastEvent_ = e;
 
-		// TODO(eteran): disable this in favor of only doing it on library load events
-		//               once we are confident. We should be able to just enclose it inside
-		//               an "if(!dynamic_info_bp_set_) {" test (since we still want to
-		//               do this when the hook isn't set.
-		edb::v1::memory_regions().sync();
+		// NOTE(eteran): the memory map can only change while the debuggee runs,
+		//               so if all it did was execute a single instruction which
+		//               can't alter it, there is no need to reread it.
+		bool regionsChanged = regionsMayHaveChanged_;
+		if (!regionsChanged) {
+			if (IProcess *process = edb::v1::debugger_core->process()) {
+				if (std::shared_ptr<IThread> thread = process->currentThread()) {
+					regionsChanged = !thread_in_known_regions(thread.get());
+				}
+			}
+		}
+
+		if (regionsChanged) {
+			edb::v1::memory_regions().sync();
+		}
+
+		// unless we know better, assume that whatever resumes the process next
+		// may alter its memory map
+		regionsMayHaveChanged_ = true;
 
 #if defined(Q_OS_LINUX)
 		if (!dynamicInfoBreakpointSet_) {
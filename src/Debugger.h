@@ -19,16 +19,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef DEBUGGER_H_20090811_
 #define DEBUGGER_H_20090811_
 
+#include "CompiledExpression.h"
 #include "DataViewInfo.h"
 #include "IDebugEventHandler.h"
 #include "OSTypes.h"
 #include "QHexView"
 
+#include <QHash>
 #include <QMainWindow>
 #include <QProcess>
 #include <QVector>
 
 #include <memory>
+#include <optional>
 
 #include "ui_Debugger.h"
 
@@ -43,6 +46,7 @@ class IPlugin;
 class RecentFileManager;
 class CommentServer;
 
+class QSocketNotifier;
 class QStringListModel;
 class QTimer;
 class QToolButton;
@@ -223,7 +227,7 @@ private:
 	Result<edb::address_t, QString> getGotoExpression();
 	Result<edb::reg_t, QString> getFollowRegister() const;
 	bool commonOpen(const QString &s, const QList<QByteArray> &args, const QString &input, const QString &output);
-	bool isBreakpointConditionTrue(const QString &condition);
+	bool isBreakpointConditionTrue(const QString &condition, const State &state);
 	edb::EventStatus handleEventExited(const std::shared_ptr<IDebugEvent> &event);
 	edb::EventStatus handleEventStopped(const std::shared_ptr<IDebugEvent> &event);
 	edb::EventStatus handleEventTerminated(const std::shared_ptr<IDebugEvent> &event);
@@ -299,10 +303,12 @@ private:
 	QLabel *status_                       = nullptr;
 	QStringListModel *listModel_          = nullptr;
 	QTimer *timer_                        = nullptr;
+	QSocketNotifier *debugEventNotifier_  = nullptr;
 	QToolButton *tabCreate_               = nullptr;
 	QToolButton *tabDelete_               = nullptr;
 	RecentFileManager *recentFileManager_ = nullptr;
 	bool stackViewLocked_                 = false;
+	bool regionsMayHaveChanged_           = true;
 
 #if defined(Q_OS_LINUX)
 	edb::address_t debugtPointer_  = 0;
@@ -316,12 +322,13 @@ private:
 	QString ttyFile_;
 	QString workingDirectory_;
 	QVector<std::shared_ptr<DataViewInfo>> dataRegions_;
+	QHash<QString, std::optional<CompiledExpression>> compiledConditions_; // nullopt if it didn't compile
 	std::shared_ptr<IBreakpoint> reenableBreakpointRun_;
 	std::shared_ptr<IBreakpoint> reenableBreakpointStep_;
 	std::shared_ptr<CommentServer> commentServer_;
 	std::shared_ptr<QHexView> stackView_;
 	std::shared_ptr<const IDebugEvent> lastEvent_;
-	std::unique_ptr<IBinary> binaryInfo_;
+	std::shared_ptr<IBinary> binaryInfo_;
 
 private:
 	QAction *gotoAddressAction_;
@@ -24,6 +24,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QCompleter>
 #include <QPushButton>
+#include <QStringListModel>
+
+namespace {
+
+// enough to fill the popup, the best matches come first
+constexpr std::size_t MaxCompletions = 50;
+
+}
 
 ExpressionDialog::ExpressionDialog(const QString &title, const QString &prompt, QWidget *parent, Qt::WindowFlags f)
 	: QDialog(parent, f) {
@@ -51,24 +59,50 @@ ExpressionDialog::ExpressionDialog(const QString &title, const QString &prompt,
 
 	setLayout(layout_);
 
+	// the completions are looked up as the user types, rather than handing
+	// the completer every symbol up front, which with large binaries loaded
+	// takes a while. They are already filtered, and include names which only
+	// contain what was typed, so the completer shouldn't filter them again
+	completions_ = new QStringListModel(this);
+
+	auto completer = new QCompleter(completions_, this);
+	completer->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+	completer->setCaseSensitivity(Qt::CaseInsensitive);
+	expression_->setCompleter(completer);
+
 	connect(expression_, &QLineEdit::textChanged, this, &ExpressionDialog::on_text_changed);
 	expression_->selectAll();
+}
 
-	std::vector<std::shared_ptr<Symbol>> symbols = edb::v1::symbol_manager().symbols();
-	QStringList allLabels;
+void ExpressionDialog::updateCompletions(const QString &text) {
 
-	for (const std::shared_ptr<Symbol> &sym : symbols) {
-		allLabels.append(sym->name_no_prefix);
-	}
+	QStringList names;
 
-	allLabels.append(edb::v1::symbol_manager().labels().values());
+	if (!text.isEmpty()) {
+		const QHash<edb::address_t, QString> labels = edb::v1::symbol_manager().labels();
+		for (const QString &label : labels) {
+			if (label.startsWith(text, Qt::CaseInsensitive)) {
+				names.append(label);
+			}
+		}
 
-	QCompleter *completer = new QCompleter(allLabels, this);
-	expression_->setCompleter(completer);
-	allLabels.clear();
+		const std::vector<std::shared_ptr<Symbol>> symbols = edb::v1::symbol_manager().search(text, MaxCompletions);
+		for (const std::shared_ptr<Symbol> &sym : symbols) {
+			if (!names.contains(sym->name_no_prefix)) {
+				names.append(sym->name_no_prefix);
+			}
+		}
+	}
+
+	completions_->setStringList(names);
 }
 
 void ExpressionDialog::on_text_changed(const QString &text) {
+
+	// textChanged is emitted before the completer is told about the edit, so
+	// it shows the new list
+	updateCompletions(text);
+
 	QHash<edb::address_t, QString> labels = edb::v1::symbol_manager().labels();
 	edb::address_t resAddr                = labels.key(text);
 
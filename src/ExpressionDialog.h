@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QVBoxLayout>
 
 class QString;
+class QStringListModel;
 
 class ExpressionDialog final : public QDialog {
 	Q_OBJECT
@@ -43,11 +44,15 @@ private Q_SLOTS:
 	void on_text_changed(const QString &text);
 
 private:
-	QVBoxLayout *layout_         = nullptr;
-	QLabel *labelText_           = nullptr;
-	QLabel *labelError_          = nullptr;
-	QLineEdit *expression_       = nullptr;
-	QDialogButtonBox *buttonBox_ = nullptr;
+	void updateCompletions(const QString &text);
+
+private:
+	QVBoxLayout *layout_           = nullptr;
+	QLabel *labelText_             = nullptr;
+	QLabel *labelError_            = nullptr;
+	QLineEdit *expression_         = nullptr;
+	QDialogButtonBox *buttonBox_   = nullptr;
+	QStringListModel *completions_ = nullptr;
 	QPalette paletteError_;
 	edb::address_t lastAddress_;
 };
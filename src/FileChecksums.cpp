@@ -0,0 +1,358 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FileChecksums.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtGlobal>
+
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+#include "libELF/elf_model.h"
+
+namespace {
+
+// the index of what we know, kept in the symbol directory
+const QString IndexName = QLatin1String("checksums.idx");
+
+// notes are tiny, anything bigger than this isn't worth reading
+constexpr qint64 MaxNotesSize = 0x10000;
+
+//------------------------------------------------------------------------------
+// Name: align_up
+// Desc:
+//------------------------------------------------------------------------------
+constexpr quint64 align_up(quint64 value, quint64 alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+//------------------------------------------------------------------------------
+// Name: file_inode
+// Desc: the inode of <filename>, or 0 where there is no such thing
+//------------------------------------------------------------------------------
+quint64 file_inode(const QString &filename) {
+#ifdef Q_OS_UNIX
+	struct stat st;
+	if (::stat(QFile::encodeName(filename).constData(), &st) == 0) {
+		return static_cast<quint64>(st.st_ino);
+	}
+#else
+	Q_UNUSED(filename)
+#endif
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+// Name: read_build_id
+// Desc: returns the NT_GNU_BUILD_ID note of an ELF file, only the program
+//       headers and the notes they point to are read
+//------------------------------------------------------------------------------
+template <class M>
+QByteArray read_build_id(QFile &file) {
+
+	using elf_header = typename M::elf_header;
+	using elf_phdr   = typename M::elf_phdr;
+	using elf_nhdr   = typename M::elf_nhdr;
+
+	elf_header header;
+	if (!file.seek(0) || file.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header)) {
+		return QByteArray();
+	}
+
+	if (header.e_phentsize != sizeof(elf_phdr) || header.e_phnum == 0 || header.e_phnum == PN_XNUM) {
+		return QByteArray();
+	}
+
+	const qint64 phdrs_size = header.e_phnum * sizeof(elf_phdr);
+	if (!file.seek(header.e_phoff)) {
+		return QByteArray();
+	}
+
+	const QByteArray phdrs = file.read(phdrs_size);
+	if (phdrs.size() != phdrs_size) {
+		return QByteArray();
+	}
+
+	for (int i = 0; i < header.e_phnum; ++i) {
+
+		elf_phdr phdr;
+		std::memcpy(&phdr, phdrs.constData() + i * sizeof(elf_phdr), sizeof(elf_phdr));
+
+		if (phdr.p_type != PT_NOTE || phdr.p_filesz > MaxNotesSize || !file.seek(phdr.p_offset)) {
+			continue;
+		}
+
+		const QByteArray notes = file.read(phdr.p_filesz);
+		const auto size        = static_cast<quint64>(notes.size());
+		const quint64 align    = (phdr.p_align == 8) ? 8 : 4;
+
+		quint64 offset = 0;
+		while (offset + sizeof(elf_nhdr) <= size) {
+
+			elf_nhdr note;
+			std::memcpy(&note, notes.constData() + offset, sizeof(elf_nhdr));
+
+			const quint64 name = offset + sizeof(elf_nhdr);
+			const quint64 desc = name + align_up(note.n_namesz, align);
+			const quint64 next = desc + align_up(note.n_descsz, align);
+
+			if (desc + note.n_descsz > size) {
+				break;
+			}
+
+			if (note.n_type == NT_GNU_BUILD_ID && note.n_namesz == sizeof(ELF_NOTE_GNU) && std::memcmp(notes.constData() + name, ELF_NOTE_GNU, sizeof(ELF_NOTE_GNU)) == 0) {
+				return notes.mid(static_cast<int>(desc), static_cast<int>(note.n_descsz));
+			}
+
+			offset = next;
+		}
+	}
+
+	return QByteArray();
+}
+
+}
+
+//------------------------------------------------------------------------------
+// Name: buildId
+// Desc: the build id of <filename>, if it is an ELF file which has one
+//------------------------------------------------------------------------------
+QByteArray FileChecksums::buildId(const QString &filename) {
+
+	QFile file(filename);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return QByteArray();
+	}
+
+	const QByteArray ident = file.read(EI_NIDENT);
+	if (ident.size() != EI_NIDENT || std::memcmp(ident.constData(), ELFMAG, SELFMAG) != 0) {
+		return QByteArray();
+	}
+
+	switch (ident[EI_CLASS]) {
+	case ELFCLASS32:
+		return read_build_id<elf_model<32>>(file);
+	case ELFCLASS64:
+		return read_build_id<elf_model<64>>(file);
+	default:
+		return QByteArray();
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: md5
+// Desc: returns the MD5 of <filename>, or what it was the last time that it was
+//       hashed if it hasn't changed since then. Files that are unchanged have
+//       the same size, modification time and inode
+//------------------------------------------------------------------------------
+QByteArray FileChecksums::md5(const QString &filename, const QString &directory) {
+	return checksum(filename, directory, false);
+}
+
+//------------------------------------------------------------------------------
+// Name: buildMd5
+// Desc: like md5(), except that a file which changed but kept its build id
+//       gets the MD5 it had before. Builds with the same id have the same
+//       symbols, so this is only for telling whether a symbol file is stale,
+//       where it spares hashing a reinstalled copy of the same package
+//------------------------------------------------------------------------------
+QByteArray FileChecksums::buildMd5(const QString &filename, const QString &directory) {
+	return checksum(filename, directory, true);
+}
+
+//------------------------------------------------------------------------------
+// Name: checksum
+// Desc: the MD5 of <filename>, trusting a matching build id if <sameBuild>
+//------------------------------------------------------------------------------
+QByteArray FileChecksums::checksum(const QString &filename, const QString &directory, bool sameBuild) {
+
+	const QFileInfo info(filename);
+	if (!info.exists() || info.size() == 0) {
+		return QByteArray();
+	}
+
+	const QString key = info.absoluteFilePath();
+
+	Entry current;
+	current.inode    = file_inode(key);
+	current.size     = info.size();
+	current.modified = info.lastModified().toMSecsSinceEpoch();
+
+	Entry previous;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		if (!loaded_ || directory != directory_) {
+			load(directory);
+		}
+
+		auto it = entries_.find(key);
+		if (it != entries_.end()) {
+			previous = it.value();
+			if (previous.inode == current.inode && previous.size == current.size && previous.modified == current.modified) {
+				return previous.md5;
+			}
+		}
+	}
+
+	// reading the file is slow, so it's done without holding the lock
+	current.buildId = buildId(key);
+
+	// the entry isn't updated, it still describes the file that was hashed
+	if (sameBuild && !current.buildId.isEmpty() && current.buildId == previous.buildId) {
+		return previous.md5;
+	}
+
+	QFile file(key);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return QByteArray();
+	}
+
+	QCryptographicHash hasher(QCryptographicHash::Md5);
+	if (!hasher.addData(&file)) {
+		return QByteArray();
+	}
+
+	current.md5 = hasher.result();
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (directory == directory_) {
+		entries_.insert(key, current);
+		save(key, current);
+	}
+
+	return current.md5;
+}
+
+//------------------------------------------------------------------------------
+// Name: load
+// Desc: reads the index in <directory>. Entries are only ever appended to it,
+//       later ones replacing earlier ones, so it is rewritten here once it has
+//       accumulated enough of those
+//------------------------------------------------------------------------------
+void FileChecksums::load(const QString &directory) {
+
+	entries_.clear();
+	directory_ = directory;
+	loaded_    = true;
+
+	if (directory.isEmpty()) {
+		return;
+	}
+
+	QFile file(QDir(directory).filePath(IndexName));
+	if (!file.open(QIODevice::ReadOnly)) {
+		return;
+	}
+
+	int lines = 0;
+	while (!file.atEnd()) {
+		const QByteArray line = file.readLine();
+		++lines;
+
+		QString path;
+		Entry entry;
+		if (parseEntry(line, &path, &entry)) {
+			entries_.insert(path, entry);
+		}
+	}
+
+	file.close();
+
+	if (lines > entries_.size() * 2 + 64) {
+		QSaveFile compacted(file.fileName());
+		if (compacted.open(QIODevice::WriteOnly)) {
+			for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+				compacted.write(formatEntry(it.key(), it.value()));
+			}
+			compacted.commit();
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: save
+// Desc: adds an entry to the index
+//------------------------------------------------------------------------------
+void FileChecksums::save(const QString &filename, const Entry &entry) {
+
+	if (directory_.isEmpty() || filename.contains(QLatin1Char('\n'))) {
+		return;
+	}
+
+	QFile file(QDir(directory_).filePath(IndexName));
+	if (file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+		file.write(formatEntry(filename, entry));
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: formatEntry
+// Desc: a line of the index, which looks like:
+//       <inode> <size> <modified> <build id or -> <md5> <path>
+//------------------------------------------------------------------------------
+QByteArray FileChecksums::formatEntry(const QString &filename, const Entry &entry) {
+
+	QByteArray line;
+	line += QByteArray::number(entry.inode) + ' ';
+	line += QByteArray::number(entry.size) + ' ';
+	line += QByteArray::number(entry.modified) + ' ';
+	line += (entry.buildId.isEmpty() ? QByteArray("-") : entry.buildId.toHex()) + ' ';
+	line += entry.md5.toHex() + ' ';
+	line += filename.toUtf8() + '\n';
+	return line;
+}
+
+//------------------------------------------------------------------------------
+// Name: parseEntry
+// Desc: the opposite of formatEntry
+//------------------------------------------------------------------------------
+bool FileChecksums::parseEntry(const QByteArray &line, QString *filename, Entry *entry) {
+
+	// the path is everything after the 5th space, it may contain more of them
+	QList<QByteArray> fields;
+	int first = 0;
+	for (int i = 0; i < 5; ++i) {
+		const int last = line.indexOf(' ', first);
+		if (last == -1) {
+			return false;
+		}
+
+		fields.push_back(line.mid(first, last - first));
+		first = last + 1;
+	}
+
+	bool ok[3];
+	entry->inode    = fields[0].toULongLong(&ok[0]);
+	entry->size     = fields[1].toLongLong(&ok[1]);
+	entry->modified = fields[2].toLongLong(&ok[2]);
+	entry->buildId  = (fields[3] == "-") ? QByteArray() : QByteArray::fromHex(fields[3]);
+	entry->md5      = QByteArray::fromHex(fields[4]);
+	*filename       = QString::fromUtf8(line.mid(first)).remove(QLatin1Char('\n'));
+
+	return ok[0] && ok[1] && ok[2] && entry->md5.size() == 16 && !filename->isEmpty();
+}
@@ -0,0 +1,60 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FILE_CHECKSUMS_H_20201016_
+#define FILE_CHECKSUMS_H_20201016_
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <mutex>
+
+// Remembers the MD5 of files along with enough about them to tell when they
+// change, so that checking whether a symbol file is stale usually costs a
+// stat instead of reading and hashing the entire binary. What is learned is
+// kept in an index in the symbol directory, so it carries over between runs.
+class FileChecksums {
+public:
+	QByteArray md5(const QString &filename, const QString &directory);
+	QByteArray buildMd5(const QString &filename, const QString &directory);
+
+private:
+	struct Entry {
+		quint64 inode   = 0;
+		qint64 size     = 0;
+		qint64 modified = 0; // milliseconds since the epoch
+		QByteArray buildId;
+		QByteArray md5;
+	};
+
+private:
+	static QByteArray buildId(const QString &filename);
+	static QByteArray formatEntry(const QString &filename, const Entry &entry);
+	static bool parseEntry(const QByteArray &line, QString *filename, Entry *entry);
+	QByteArray checksum(const QString &filename, const QString &directory, bool sameBuild);
+	void load(const QString &directory);
+	void save(const QString &filename, const Entry &entry);
+
+private:
+	std::mutex mutex_;
+	QString directory_;
+	QHash<QString, Entry> entries_;
+	bool loaded_ = false;
+};
+
+#endif
@@ -58,7 +58,7 @@ edb::address_t Function::endAddress() const {
  * @return
  */
 edb::address_t Function::lastInstruction() const {
-	return back().back()->rva();
+	return back().back().address;
 }
 
 /**
@@ -0,0 +1,168 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "InstructionCache.h"
+#include "edb.h"
+
+#include <algorithm>
+#include <cstring>
+
+//------------------------------------------------------------------------------
+// Name: decode
+// Desc: runs the decoder over <first> to <last> and summarizes the result
+//------------------------------------------------------------------------------
+InstructionCache::Record InstructionCache::decode(edb::address_t address, const uint8_t *first, const uint8_t *last) {
+
+	Record record;
+
+	const edb::Instruction inst(first, last, address);
+	const std::size_t available = std::min<std::size_t>(last - first, edb::Instruction::MaxSize);
+
+	if (!inst) {
+		record.length = static_cast<uint8_t>(available);
+		std::memcpy(record.bytes, first, available);
+		return record;
+	}
+
+	Entry &entry       = record.entry;
+	entry.valid        = true;
+	entry.size         = static_cast<uint8_t>(inst.byteSize());
+	entry.operandCount = static_cast<uint8_t>(inst.operandCount());
+
+	if (is_call(inst)) {
+		entry.flow = Flow::Call;
+	} else if (is_return(inst)) {
+		entry.flow = Flow::Return;
+	} else if (is_conditional_jump(inst)) {
+		entry.flow = Flow::ConditionalJump;
+	} else if (is_jump(inst)) {
+		entry.flow = Flow::Jump;
+	} else if (is_interrupt(inst)) {
+		entry.flow = Flow::Interrupt;
+	} else if (is_syscall(inst) || is_sysenter(inst)) {
+		entry.flow = Flow::Syscall;
+	}
+
+	for (std::size_t i = 0; i < entry.operandCount && i < 8; ++i) {
+		const auto operand = inst[i];
+		if (is_expression(operand)) {
+			entry.memoryOperands |= (1u << i);
+		} else if (is_immediate(operand)) {
+			entry.immediateOperands |= (1u << i);
+		}
+	}
+
+	if ((entry.flow == Flow::Call || entry.flow == Flow::Jump || entry.flow == Flow::ConditionalJump) && (entry.immediateOperands & 1)) {
+		entry.hasTarget = true;
+		entry.target    = inst[0]->imm;
+	}
+
+	record.length = entry.size;
+	std::memcpy(record.bytes, first, entry.size);
+	return record;
+}
+
+//------------------------------------------------------------------------------
+// Name: lookup
+// Desc: returns the summary of the instruction made of the bytes from <first>
+//       to <last>, which were read from <address>, decoding them only if
+//       they aren't the bytes we decoded there last time
+//------------------------------------------------------------------------------
+InstructionCache::Entry InstructionCache::lookup(edb::address_t address, const uint8_t *first, const uint8_t *last) {
+
+	if (first >= last) {
+		return Entry();
+	}
+
+	// a different mode decodes the same bytes differently
+	const IDebugger::CpuMode mode = edb::v1::debugger_core ? edb::v1::debugger_core->cpuMode() : IDebugger::CpuMode::Unknown;
+	if (mode != mode_) {
+		clear();
+		mode_ = mode;
+	}
+
+	const std::size_t available = std::min<std::size_t>(last - first, edb::Instruction::MaxSize);
+
+	auto it = records_.find(address);
+	if (it != records_.end()) {
+		const Record &record = it.value();
+
+		// an invalid instruction must be looked at with exactly the same
+		// bytes, a valid one only needs the bytes that it is made of
+		const bool same_length = record.entry.valid ? available >= record.length : available == record.length;
+		if (same_length && std::memcmp(record.bytes, first, record.length) == 0) {
+			++statistics_.hits;
+			return record.entry;
+		}
+	}
+
+	++statistics_.misses;
+
+	if (it == records_.end() && records_.size() >= MaxEntries) {
+		records_.clear();
+	}
+
+	const Record record = decode(address, first, last);
+	records_.insert(address, record);
+	return record.entry;
+}
+
+//------------------------------------------------------------------------------
+// Name: invalidate
+// Desc: forgets every instruction which overlaps <address> to <address + size>
+//------------------------------------------------------------------------------
+void InstructionCache::invalidate(edb::address_t address, std::size_t size) {
+
+	if (size == 0 || records_.isEmpty()) {
+		return;
+	}
+
+	// instructions which start in front of the range can still reach into it
+	const uint64_t start = address.toUint();
+	const uint64_t first = start > edb::Instruction::MaxSize ? start - edb::Instruction::MaxSize : 0;
+	const uint64_t last  = start + size;
+
+	auto overlaps = [&](uint64_t a, const Record &record) {
+		return a < last && a + record.length > start;
+	};
+
+	if (last - first > static_cast<uint64_t>(records_.size())) {
+		for (auto it = records_.begin(); it != records_.end();) {
+			if (overlaps(it.key().toUint(), it.value())) {
+				it = records_.erase(it);
+			} else {
+				++it;
+			}
+		}
+	} else {
+		for (uint64_t a = first; a < last; ++a) {
+			auto it = records_.find(a);
+			if (it != records_.end() && overlaps(a, it.value())) {
+				records_.erase(it);
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: clear
+// Desc:
+//------------------------------------------------------------------------------
+void InstructionCache::clear() {
+	records_.clear();
+}
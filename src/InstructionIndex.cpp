@@ -0,0 +1,390 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "InstructionIndex.h"
+#include "IAnalyzer.h"
+#include "IDebugger.h"
+#include "IProcess.h"
+#include "IRegion.h"
+#include "Instruction.h"
+#include "edb.h"
+
+#include <QCoreApplication>
+#include <QTimer>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+namespace {
+
+constexpr std::size_t ReadChunkSize    = 0x100000;
+constexpr std::size_t ResweepChunkSize = 0x1000;
+
+//------------------------------------------------------------------------------
+// Name: instruction_length
+// Desc: returns the length of the instruction at <first>. Bytes that don't
+//       decode count as a one byte instruction, which is how the disassembly
+//       view shows them
+//------------------------------------------------------------------------------
+std::size_t instruction_length(const uint8_t *first, const uint8_t *last, edb::address_t address) {
+	const edb::Instruction inst(first, last, address, edb::Instruction::Detail::FlowOnly);
+	return inst.byteSize();
+}
+
+//------------------------------------------------------------------------------
+// Name: read_bytes
+// Desc: reads <size> bytes from <address> a chunk at a time, anything which
+//       can't be read is left as zeros
+//------------------------------------------------------------------------------
+QByteArray read_bytes(IProcess *process, edb::address_t address, std::size_t size) {
+	QByteArray bytes(static_cast<int>(size), '\0');
+	for (std::size_t offset = 0; offset < size; offset += ReadChunkSize) {
+		process->readBytes(address + offset, bytes.data() + offset, std::min(ReadChunkSize, size - offset));
+	}
+	return bytes;
+}
+
+}
+
+//------------------------------------------------------------------------------
+// Name: Boundaries
+// Desc: constructor
+//------------------------------------------------------------------------------
+InstructionIndex::Boundaries::Boundaries(edb::address_t base, std::size_t size)
+	: base(base), size(size), bits((size + 63) / 64) {
+}
+
+//------------------------------------------------------------------------------
+// Name: previous
+// Desc: returns the offset of the last instruction which starts before <offset>
+//------------------------------------------------------------------------------
+std::optional<std::size_t> InstructionIndex::Boundaries::previous(std::size_t offset) const {
+
+	if (offset == 0) {
+		return {};
+	}
+
+	std::size_t word = (offset - 1) / 64;
+	uint64_t mask    = ~uint64_t(0) >> (63 - (offset - 1) % 64);
+
+	while (true) {
+		if (const uint64_t w = bits[word] & mask) {
+			for (int bit = 63; bit >= 0; --bit) {
+				if ((w >> bit) & 1) {
+					return word * 64 + bit;
+				}
+			}
+		}
+
+		if (word == 0) {
+			return {};
+		}
+
+		--word;
+		mask = ~uint64_t(0);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: sweep
+// Desc: disassembles <bytes>, which were read from <base>, from start to end.
+//       The sweep is restarted at each of <entryPoints> in case it went
+//       through one of them out of step with the real instructions
+//------------------------------------------------------------------------------
+std::shared_ptr<InstructionIndex::Boundaries> InstructionIndex::sweep(const QByteArray &bytes, edb::address_t base, const QVector<edb::address_t> &entryPoints) {
+
+	const std::size_t size = static_cast<std::size_t>(bytes.size());
+	auto boundaries        = std::make_shared<Boundaries>(base, size);
+
+	std::vector<std::size_t> entries;
+	for (edb::address_t address : entryPoints) {
+		if (address >= base && address < base + size) {
+			entries.push_back((address - base).toUint());
+		}
+	}
+
+	std::sort(entries.begin(), entries.end());
+
+	const auto data    = reinterpret_cast<const uint8_t *>(bytes.constData());
+	auto entry         = entries.begin();
+	std::size_t offset = 0;
+
+	while (offset < size) {
+		if (entry != entries.end() && *entry <= offset) {
+			offset = *entry++;
+		}
+
+		boundaries->set(offset);
+		offset += instruction_length(data + offset, data + size, base + offset);
+	}
+
+	return boundaries;
+}
+
+//------------------------------------------------------------------------------
+// Name: boundaries
+// Desc: returns the index for <region>, or nullptr if it isn't ready yet, in
+//       which case building it is started if it wasn't already
+//------------------------------------------------------------------------------
+InstructionIndex::Boundaries *InstructionIndex::boundaries(const std::shared_ptr<IRegion> &region) {
+
+	// writable code is likely to be changed by the debuggee itself, and we
+	// would only ever find out after the fact
+	if (!region || region->writable() || region->size() == 0 || region->size() > MaxRegionSize) {
+		return nullptr;
+	}
+
+	const edb::address_t base = region->start();
+	const std::size_t size    = region->size();
+
+	auto it = regions_.find(base);
+	if (it != regions_.end() && it->size != size) {
+		regions_.erase(it);
+		it = regions_.end();
+	}
+
+	if (it == regions_.end()) {
+		if (!edb::v1::debugger_core || !edb::v1::debugger_core->process()) {
+			return nullptr;
+		}
+
+		Entry entry;
+		entry.id   = ++nextId_;
+		entry.size = size;
+		entry.bytes.reserve(static_cast<int>(size));
+
+		if (IAnalyzer *analyzer = edb::v1::analyzer()) {
+			const IAnalyzer::FunctionMap functions = analyzer->functions(region);
+			for (auto f = functions.begin(); f != functions.end(); ++f) {
+				entry.entryPoints.push_back(f.key());
+			}
+		}
+
+		regions_.insert(base, entry);
+		readMore(base, entry.id);
+		return nullptr;
+	}
+
+	Entry &entry = it.value();
+	if (!entry.boundaries) {
+		if (entry.read != entry.size || !entry.future.isFinished()) {
+			return nullptr;
+		}
+
+		entry.boundaries = entry.future.result();
+		entry.future     = QFuture<std::shared_ptr<Boundaries>>();
+	}
+
+	return entry.boundaries.get();
+}
+
+//------------------------------------------------------------------------------
+// Name: readMore
+// Desc: copies the next chunk of the region at <base>, if the index being built
+//       for it is still <id>. The debuggee can only be read from this thread,
+//       so the copy is made a chunk at a time from the event loop, and the
+//       disassembly is left to the thread pool once it is complete
+//------------------------------------------------------------------------------
+void InstructionIndex::readMore(edb::address_t base, uint64_t id) {
+
+	auto it = regions_.find(base);
+	if (it == regions_.end() || it->id != id) {
+		return;
+	}
+
+	IProcess *process = edb::v1::debugger_core ? edb::v1::debugger_core->process() : nullptr;
+	if (!process) {
+		regions_.erase(it);
+		return;
+	}
+
+	Entry &entry           = it.value();
+	const std::size_t size = std::min(ReadChunkSize, entry.size - entry.read);
+	entry.bytes.append(read_bytes(process, base + entry.read, size));
+	entry.read += size;
+
+	if (entry.read != entry.size) {
+		QTimer::singleShot(0, qApp, [this, base, id]() {
+			readMore(base, id);
+		});
+		return;
+	}
+
+	const QByteArray bytes                     = entry.bytes;
+	const QVector<edb::address_t> entry_points = entry.entryPoints;
+
+	entry.future = QtConcurrent::run([bytes, base, entry_points]() {
+		return sweep(bytes, base, entry_points);
+	});
+
+	entry.bytes.clear();
+	entry.entryPoints.clear();
+}
+
+//------------------------------------------------------------------------------
+// Name: checked
+// Desc: returns <start> if the instruction there still reaches <address>.
+//       Code can change without edb writing to it, for example when a JIT
+//       reuses its memory, so if it doesn't the index for the region at
+//       <base> is thrown away and will be built again from what is there now
+//------------------------------------------------------------------------------
+std::optional<edb::address_t> InstructionIndex::checked(edb::address_t base, edb::address_t start, edb::address_t address) {
+
+	if (IProcess *process = edb::v1::debugger_core ? edb::v1::debugger_core->process() : nullptr) {
+		uint8_t code[edb::Instruction::MaxSize];
+		if (const std::size_t n = process->readBytes(start, code, sizeof(code))) {
+			if (start + instruction_length(code, code + n, start) >= address) {
+				return start;
+			}
+		}
+	}
+
+	regions_.remove(base);
+	return {};
+}
+
+//------------------------------------------------------------------------------
+// Name: previousInstruction
+// Desc: returns the address of the instruction in front of <address>
+//------------------------------------------------------------------------------
+std::optional<edb::address_t> InstructionIndex::previousInstruction(const std::shared_ptr<IRegion> &region, edb::address_t address) {
+
+	const Boundaries *const index = boundaries(region);
+	if (!index || address <= index->base || address > index->base + index->size) {
+		return {};
+	}
+
+	if (const std::optional<std::size_t> offset = index->previous((address - index->base).toUint())) {
+		return checked(index->base, index->base + *offset, address);
+	}
+
+	return {};
+}
+
+//------------------------------------------------------------------------------
+// Name: instructionStart
+// Desc: returns the address of the instruction which <address> is part of
+//------------------------------------------------------------------------------
+std::optional<edb::address_t> InstructionIndex::instructionStart(const std::shared_ptr<IRegion> &region, edb::address_t address) {
+
+	const Boundaries *const index = boundaries(region);
+	if (!index || address < index->base || address >= index->base + index->size) {
+		return {};
+	}
+
+	if (const std::optional<std::size_t> offset = index->previous((address - index->base).toUint() + 1)) {
+		return checked(index->base, index->base + *offset, address + 1);
+	}
+
+	return {};
+}
+
+//------------------------------------------------------------------------------
+// Name: resweep
+// Desc: disassembles the region again around the bytes from <first> to
+//       <last>, which have changed, until it falls back into step with the
+//       instructions which were already known
+//------------------------------------------------------------------------------
+void InstructionIndex::resweep(Boundaries *index, std::size_t first, std::size_t last, const ReadFunction &read) {
+
+	// nothing that starts more than an instruction's length in front of the
+	// change can reach into it
+	const std::size_t back = first > edb::Instruction::MaxSize ? first - edb::Instruction::MaxSize : 0;
+	std::size_t offset     = index->previous(back + 1).value_or(0);
+
+	QByteArray window;
+	std::size_t window_start = 0;
+
+	while (offset < index->size) {
+
+		const std::size_t window_end = window_start + window.size();
+		if (window.isEmpty() || (offset + edb::Instruction::MaxSize > window_end && window_end < index->size)) {
+			window_start = offset;
+			window       = read(offset, std::min(ResweepChunkSize, index->size - offset));
+		}
+
+		const auto data   = reinterpret_cast<const uint8_t *>(window.constData());
+		const auto p      = data + (offset - window_start);
+		const auto length = instruction_length(p, data + window.size(), index->base + offset);
+
+		index->set(offset);
+		for (std::size_t i = 1; i < length && offset + i < index->size; ++i) {
+			index->reset(offset + i);
+		}
+
+		offset += length;
+
+		// past the change, landing on a known instruction means that the
+		// rest of the sweep would turn out the same as before
+		if (offset >= last && offset < index->size && index->test(offset)) {
+			break;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: invalidate
+// Desc: brings the indexes up to date with a change to <size> bytes at <address>
+//------------------------------------------------------------------------------
+void InstructionIndex::invalidate(edb::address_t address, std::size_t size) {
+
+	IProcess *process = edb::v1::debugger_core ? edb::v1::debugger_core->process() : nullptr;
+	if (size == 0 || !process) {
+		return;
+	}
+
+	for (auto it = regions_.begin(); it != regions_.end();) {
+		const edb::address_t base = it.key();
+		Entry &entry              = it.value();
+
+		if (address >= base + entry.size || address + size <= base) {
+			++it;
+			continue;
+		}
+
+		if (!entry.boundaries) {
+			// it was built from what was there before, so start over
+			it = regions_.erase(it);
+			continue;
+		}
+
+		const std::size_t first = address > base ? (address - base).toUint() : 0;
+		const std::size_t last  = std::min<std::size_t>((address + size - base).toUint(), entry.size);
+		resweep(entry.boundaries.get(), first, last, [process, base](std::size_t offset, std::size_t n) {
+			return read_bytes(process, base + offset, n);
+		});
+
+		++it;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: remove
+// Desc: forgets the index for the region at <base>
+//------------------------------------------------------------------------------
+void InstructionIndex::remove(edb::address_t base) {
+	regions_.remove(base);
+}
+
+//------------------------------------------------------------------------------
+// Name: clear
+// Desc:
+//------------------------------------------------------------------------------
+void InstructionIndex::clear() {
+	regions_.clear();
+}
@@ -24,6 +24,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "edb.h"
 
 #include <QDebug>
+#include <QSet>
+
+#include <algorithm>
 
 //------------------------------------------------------------------------------
 // Name: MemoryRegions
@@ -40,60 +43,127 @@ MemoryRegions::MemoryRegions()
 void MemoryRegions::clear() {
 	beginResetModel();
 	regions_.clear();
+	spans_.clear();
 	endResetModel();
 }
 
+//------------------------------------------------------------------------------
+// Name: rebuildIndex
+// Desc: regenerates the sorted span table from the current list of regions
+//------------------------------------------------------------------------------
+void MemoryRegions::rebuildIndex() {
+
+	spans_.clear();
+	spans_.reserve(regions_.size());
+
+	for (int i = 0; i < regions_.size(); ++i) {
+		const std::shared_ptr<IRegion> &region = regions_[i];
+		spans_.push_back(Span{region->start(), region->end(), i});
+	}
+
+	// NOTE(eteran): on linux, the maps file is already in order, so this is
+	// just a quick check, but other platforms make no such promise
+	auto by_start = [](const Span &lhs, const Span &rhs) {
+		return lhs.start < rhs.start;
+	};
+
+	if (!std::is_sorted(spans_.begin(), spans_.end(), by_start)) {
+		std::sort(spans_.begin(), spans_.end(), by_start);
+	}
+}
+
 //------------------------------------------------------------------------------
 // Name: sync
-// Desc: reads a memory map file line by line
+// Desc: updates the list of regions from the debuggee. Region objects which
+//       did not change are reused by the process, so we can tell exactly what
+//       was added and removed, and only look for symbols in new modules.
 //------------------------------------------------------------------------------
 void MemoryRegions::sync() {
 
-	beginResetModel();
-
 	QList<std::shared_ptr<IRegion>> regions;
 
 	if (edb::v1::debugger_core) {
 		if (IProcess *process = edb::v1::debugger_core->process()) {
 			regions = process->regions();
-			Q_FOREACH (const std::shared_ptr<IRegion> &region, regions) {
-				// if the region has a name, is mapped starting
-				// at the beginning of the file, and is executable, sounds
-				// like a module mapping!
-				if (!region->name().isEmpty()) {
-					if (region->executable()) {
-
-						// NOTE(eteran): region start is not good enough, we need **module** start
-						edb::address_t base = region->start();
-						Q_FOREACH (const std::shared_ptr<IRegion> &r, regions) {
-							if (r->name() == region->name()) {
-								base = std::min(base, r->start());
-							}
-						}
-
-						edb::v1::symbol_manager().loadSymbolFile(region->name(), base);
+		}
+	}
+
+	// nothing changed, so no need to disturb any of the views
+	if (regions == regions_) {
+		return;
+	}
+
+	QSet<const IRegion *> previous;
+	previous.reserve(regions_.size());
+	for (const std::shared_ptr<IRegion> &region : regions_) {
+		previous.insert(region.get());
+	}
+
+	QSet<const IRegion *> current;
+	current.reserve(regions.size());
+	for (const std::shared_ptr<IRegion> &region : regions) {
+		current.insert(region.get());
+	}
+
+	QList<std::shared_ptr<IRegion>> added;
+	for (const std::shared_ptr<IRegion> &region : regions) {
+		if (!previous.contains(region.get())) {
+			added.push_back(region);
+		}
+	}
+
+	QList<std::shared_ptr<IRegion>> removed;
+	for (const std::shared_ptr<IRegion> &region : regions_) {
+		if (!current.contains(region.get())) {
+			removed.push_back(region);
+		}
+	}
+
+	for (const std::shared_ptr<IRegion> &region : added) {
+		// if the region has a name, is mapped starting
+		// at the beginning of the file, and is executable, sounds
+		// like a module mapping!
+		if (!region->name().isEmpty()) {
+			if (region->executable()) {
+
+				// NOTE(eteran): region start is not good enough, we need **module** start
+				edb::address_t base = region->start();
+				for (const std::shared_ptr<IRegion> &r : regions) {
+					if (r->name() == region->name()) {
+						base = std::min(base, r->start());
 					}
 				}
+
+				edb::v1::symbol_manager().loadSymbolFile(region->name(), base);
 			}
 		}
 	}
 
+	beginResetModel();
 	std::swap(regions_, regions);
+	rebuildIndex();
 	endResetModel();
+
+	Q_EMIT regionsChanged(added, removed);
 }
 
 //------------------------------------------------------------------------------
-// Name: find_region
-// Desc:
+// Name: findRegion
+// Desc: returns the region containing <address>, or nullptr if there is none
 //------------------------------------------------------------------------------
 std::shared_ptr<IRegion> MemoryRegions::findRegion(edb::address_t address) const {
 
-	auto it = std::find_if(regions_.begin(), regions_.end(), [address](const std::shared_ptr<IRegion> &region) {
-		return region->contains(address);
+	// find the first span which starts after the address, the one before it
+	// is the only one which can contain it
+	auto it = std::upper_bound(spans_.cbegin(), spans_.cend(), address, [](edb::address_t value, const Span &span) {
+		return value < span.start;
 	});
 
-	if (it != regions_.end()) {
-		return *it;
+	if (it != spans_.cbegin()) {
+		--it;
+		if (address >= it->start && address < it->end) {
+			return regions_[it->index];
+		}
 	}
 
 	return nullptr;
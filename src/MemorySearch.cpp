@@ -0,0 +1,201 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "MemorySearch.h"
+#include "IDebugger.h"
+#include "IProcess.h"
+#include "IRegion.h"
+#include "edb.h"
+#include "util/Math.h"
+
+#include <QFuture>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <deque>
+#include <utility>
+
+//------------------------------------------------------------------------------
+// Name: MemorySearch
+// Desc: constructor
+//------------------------------------------------------------------------------
+MemorySearch::MemorySearch(const QByteArray &needle)
+	: pattern_(BytePattern::fromBytes(needle)) {
+}
+
+//------------------------------------------------------------------------------
+// Name: MemorySearch
+// Desc: constructor
+//------------------------------------------------------------------------------
+MemorySearch::MemorySearch(BytePattern pattern)
+	: pattern_(std::move(pattern)) {
+}
+
+//------------------------------------------------------------------------------
+// Name: setChunkSize
+// Desc: sets how many bytes are read and scanned at a time, this bounds the
+//       amount of memory used by a search
+//------------------------------------------------------------------------------
+void MemorySearch::setChunkSize(std::size_t size) {
+	chunkSize_ = std::max<std::size_t>(size, 1);
+}
+
+//------------------------------------------------------------------------------
+// Name: setSkipInaccessible
+// Desc: if true, regions which have no access permissions are not searched
+//------------------------------------------------------------------------------
+void MemorySearch::setSkipInaccessible(bool skip) {
+	skipInaccessible_ = skip;
+}
+
+//------------------------------------------------------------------------------
+// Name: scan
+// Desc: returns the offsets of all matches in the first <size> bytes of <data>
+//       which start before <limit>. This is safe to call from any thread.
+//------------------------------------------------------------------------------
+QVector<std::size_t> MemorySearch::scan(const uint8_t *data, std::size_t size, std::size_t limit) const {
+
+	QVector<std::size_t> offsets;
+
+	const uint8_t *const last = data + size;
+	const uint8_t *p          = data;
+
+	while ((p = pattern_.find(p, last)) != last) {
+		const auto offset = static_cast<std::size_t>(p - data);
+		if (offset >= limit) {
+			break;
+		}
+
+		offsets.push_back(offset);
+		++p;
+	}
+
+	return offsets;
+}
+
+//------------------------------------------------------------------------------
+// Name: run
+// Desc: searches <regions> of the current process. Matches are delivered to
+//       <onResults> in address order as they are found, both handlers are
+//       called on the calling thread. Returns false if the search was
+//       cancelled.
+//------------------------------------------------------------------------------
+bool MemorySearch::run(const QList<std::shared_ptr<IRegion>> &regions, const ResultHandler &onResults, const ProgressHandler &onProgress) const {
+
+	if (pattern_.isEmpty() || !edb::v1::debugger_core) {
+		return true;
+	}
+
+	IProcess *process = edb::v1::debugger_core->process();
+	if (!process) {
+		return true;
+	}
+
+	struct Pending {
+		QFuture<QVector<edb::address_t>> future;
+		int region;
+		std::size_t done;
+		std::size_t total;
+	};
+
+	const std::size_t page_size = edb::v1::debugger_core->pageSize();
+	const std::size_t overlap   = pattern_.size() - 1;
+
+	// enough chunks to keep every core busy while we read the next one,
+	// but no more, so that memory use doesn't depend on the size of the search
+	const std::size_t max_pending = static_cast<std::size_t>(std::max(2, QThread::idealThreadCount() * 2));
+
+	std::deque<Pending> pending;
+	bool cancelled = false;
+
+	// results are handed out strictly in the order that the chunks were
+	// submitted so that the caller sees them sorted by address
+	auto deliver = [&]() {
+		Pending &front                         = pending.front();
+		const QVector<edb::address_t> &matches = front.future.result();
+
+		if (!matches.isEmpty()) {
+			onResults(matches);
+		}
+
+		if (onProgress && !cancelled) {
+			if (!onProgress(util::percentage(front.region, regions.size(), front.done, front.total))) {
+				cancelled = true;
+			}
+		}
+
+		pending.pop_front();
+	};
+
+	for (int i = 0; i < regions.size() && !cancelled; ++i) {
+		const std::shared_ptr<IRegion> &region = regions[i];
+
+		if (skipInaccessible_ && !region->accessible()) {
+			continue;
+		}
+
+		const edb::address_t end = region->end();
+		edb::address_t address   = region->start();
+
+		while (address < end && !cancelled) {
+
+			const std::size_t remaining = end - address;
+			const std::size_t step      = std::min(chunkSize_, remaining);
+			const std::size_t want      = std::min(step + overlap, remaining);
+
+			QByteArray chunk(static_cast<int>(want), Qt::Uninitialized);
+			const std::size_t n = process->readBytes(address, chunk.data(), want);
+
+			if (n != 0) {
+				chunk.resize(static_cast<int>(n));
+
+				const edb::address_t base = address;
+				const std::size_t limit   = std::min(step, n);
+
+				auto future = QtConcurrent::run([this, chunk, base, limit]() {
+					QVector<edb::address_t> matches;
+					for (std::size_t offset : scan(reinterpret_cast<const uint8_t *>(chunk.constData()), chunk.size(), limit)) {
+						matches.push_back(base + offset);
+					}
+					return matches;
+				});
+
+				pending.push_back(Pending{future, i, address - region->start(), region->size()});
+
+				if (pending.size() >= max_pending) {
+					deliver();
+				}
+			}
+
+			if (n < step) {
+				// we couldn't read all of it, so skip past the page that stopped us
+				const edb::address_t bad_address = address + n;
+				address                          = bad_address - (bad_address % page_size) + page_size;
+			} else {
+				address += step;
+			}
+		}
+	}
+
+	while (!pending.empty()) {
+		deliver();
+	}
+
+	return !cancelled;
+}
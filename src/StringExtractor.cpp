@@ -0,0 +1,431 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "StringExtractor.h"
+#include "IDebugger.h"
+#include "IProcess.h"
+#include "IRegion.h"
+#include "edb.h"
+#include "util/Math.h"
+
+#include <QByteArray>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#define EDB_STRINGS_SSE2
+#endif
+
+namespace {
+
+// stringAt reads this much at a time, so that a string which may be very long
+// but usually isn't doesn't cost a read of the most it could be
+constexpr std::size_t StringReadSize = 0x1000;
+
+//------------------------------------------------------------------------------
+// Name: is_ascii_char
+// Desc: returns true if <ch> is a printable character or whitespace
+//------------------------------------------------------------------------------
+constexpr bool is_ascii_char(uint8_t ch) {
+	return (ch >= 0x20 && ch < 0x7f) || (ch >= 0x09 && ch <= 0x0d);
+}
+
+//------------------------------------------------------------------------------
+// Name: is_utf16_char
+// Desc: for now, we only acknowledge ASCII chars encoded as unicode
+//------------------------------------------------------------------------------
+constexpr bool is_utf16_char(uint16_t ch) {
+	return ch >= 0x20 && ch < 0x80;
+}
+
+//------------------------------------------------------------------------------
+// Name: is_string_start
+// Desc: returns true if a string of either encoding can start with <ch>
+//------------------------------------------------------------------------------
+constexpr bool is_string_start(uint8_t ch) {
+	return is_ascii_char(ch) || is_utf16_char(ch);
+}
+
+#ifdef EDB_STRINGS_SSE2
+//------------------------------------------------------------------------------
+// Name: ascii_mask
+// Desc: returns a mask with bit N set if byte N of <v> is_ascii_char. SSE2 only
+//       has signed compares, so each range is shifted down to start at -128
+//------------------------------------------------------------------------------
+inline unsigned int ascii_mask(__m128i v) {
+	const __m128i print = _mm_cmplt_epi8(_mm_add_epi8(v, _mm_set1_epi8(0x60)), _mm_set1_epi8(-128 + 0x5f));
+	const __m128i space = _mm_cmplt_epi8(_mm_add_epi8(v, _mm_set1_epi8(0x77)), _mm_set1_epi8(-128 + 0x05));
+	return static_cast<unsigned int>(_mm_movemask_epi8(_mm_or_si128(print, space)));
+}
+
+//------------------------------------------------------------------------------
+// Name: utf16_mask
+// Desc: returns a mask with bits 2N and 2N+1 set if word N of <v> is_utf16_char
+//------------------------------------------------------------------------------
+inline unsigned int utf16_mask(__m128i v) {
+	const __m128i chars = _mm_cmplt_epi16(_mm_add_epi16(v, _mm_set1_epi16(0x7fe0)), _mm_set1_epi16(-32768 + 0x60));
+	return static_cast<unsigned int>(_mm_movemask_epi8(chars));
+}
+
+//------------------------------------------------------------------------------
+// Name: start_mask
+// Desc: returns a mask with bit N set if byte N of <v> is_string_start
+//------------------------------------------------------------------------------
+inline unsigned int start_mask(__m128i v) {
+	return ascii_mask(v) | static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(0x7f))));
+}
+
+//------------------------------------------------------------------------------
+// Name: load
+// Desc:
+//------------------------------------------------------------------------------
+inline __m128i load(const uint8_t *p) {
+	return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Name: skip_to_start
+// Desc: returns the offset of the first byte in <data> which could start a
+//       string, or <size> if there is none
+//------------------------------------------------------------------------------
+std::size_t skip_to_start(const uint8_t *data, std::size_t size) {
+
+	std::size_t n = 0;
+
+#ifdef EDB_STRINGS_SSE2
+	for (; n + 16 <= size; n += 16) {
+		if (const unsigned int mask = start_mask(load(data + n))) {
+			return n + __builtin_ctz(mask);
+		}
+	}
+#endif
+
+	while (n < size && !is_string_start(data[n])) {
+		++n;
+	}
+
+	return n;
+}
+
+}
+
+//------------------------------------------------------------------------------
+// Name: StringExtractor
+// Desc: constructor
+//------------------------------------------------------------------------------
+StringExtractor::StringExtractor(int minLength, int maxLength)
+	: minLength_(std::max(minLength, 1)), maxLength_(std::max(maxLength, 0)) {
+}
+
+//------------------------------------------------------------------------------
+// Name: setSearchUtf16
+// Desc: if true, strings of ASCII characters encoded as UTF-16 are found too
+//------------------------------------------------------------------------------
+void StringExtractor::setSearchUtf16(bool search) {
+	searchUtf16_ = search;
+}
+
+//------------------------------------------------------------------------------
+// Name: asciiLength
+// Desc: returns how many of the first <size> bytes of <data> are printable
+//       characters or whitespace
+//------------------------------------------------------------------------------
+std::size_t StringExtractor::asciiLength(const uint8_t *data, std::size_t size) {
+
+	std::size_t n = 0;
+
+#ifdef EDB_STRINGS_SSE2
+	for (; n + 16 <= size; n += 16) {
+		const unsigned int mask = ascii_mask(load(data + n));
+		if (mask != 0xffff) {
+			return n + __builtin_ctz(~mask);
+		}
+	}
+#endif
+
+	while (n < size && is_ascii_char(data[n])) {
+		++n;
+	}
+
+	return n;
+}
+
+//------------------------------------------------------------------------------
+// Name: utf16Length
+// Desc: returns how many of the first <count> UTF-16 characters of <data> are
+//       printable ASCII characters
+//------------------------------------------------------------------------------
+std::size_t StringExtractor::utf16Length(const uint8_t *data, std::size_t count) {
+
+	std::size_t n = 0;
+
+#ifdef EDB_STRINGS_SSE2
+	for (; n + 8 <= count; n += 8) {
+		const unsigned int mask = utf16_mask(load(data + n * 2));
+		if (mask != 0xffff) {
+			return n + __builtin_ctz(~mask) / 2;
+		}
+	}
+#endif
+
+	for (; n < count; ++n) {
+		uint16_t ch;
+		std::memcpy(&ch, data + n * 2, sizeof(ch));
+		if (!is_utf16_char(ch)) {
+			break;
+		}
+	}
+
+	return n;
+}
+
+//------------------------------------------------------------------------------
+// Name: toString
+// Desc: converts the <length> character string at <data> to a QString,
+//       replacing characters which need an escape char with the escape sequence
+//------------------------------------------------------------------------------
+QString StringExtractor::toString(const uint8_t *data, int length, Encoding encoding) {
+
+	QString s;
+	s.reserve(length);
+
+	const int stride = (encoding == Encoding::Utf16) ? 2 : 1;
+
+	// the high byte of every UTF-16 character we accept is zero
+	for (int i = 0; i < length; ++i) {
+		const char ch = static_cast<char>(data[i * stride]);
+		switch (ch) {
+		case '\r':
+			s += QLatin1String("\\r");
+			break;
+		case '\n':
+			s += QLatin1String("\\n");
+			break;
+		case '\t':
+			s += QLatin1String("\\t");
+			break;
+		case '\v':
+			s += QLatin1String("\\v");
+			break;
+		case '"':
+			s += QLatin1String("\\\"");
+			break;
+		default:
+			s += QLatin1Char(ch);
+			break;
+		}
+	}
+
+	return s;
+}
+
+//------------------------------------------------------------------------------
+// Name: extract
+// Desc: finds the strings in the first <size> bytes of <data> which start
+//       before <limit>, appending them to <matches> with <base> as the address
+//       of <data>. Returns the offset at which scanning should resume for the
+//       data which follows. This is safe to call from any thread.
+//------------------------------------------------------------------------------
+std::size_t StringExtractor::extract(const uint8_t *data, std::size_t size, std::size_t limit, edb::address_t base, QVector<Match> *matches) const {
+
+	const auto min_length = static_cast<std::size_t>(minLength_);
+	const auto max_length = static_cast<std::size_t>(maxLength_);
+
+	limit = std::min(limit, size);
+
+	std::size_t offset = 0;
+	while (offset < limit) {
+
+		offset += skip_to_start(data + offset, limit - offset);
+		if (offset == limit) {
+			break;
+		}
+
+		const std::size_t ascii = asciiLength(data + offset, std::min(max_length, size - offset));
+		if (ascii >= min_length) {
+			matches->push_back(Match{base + offset, static_cast<int>(ascii), Encoding::Ascii});
+			offset += ascii;
+			continue;
+		}
+
+		if (searchUtf16_) {
+			const std::size_t utf16 = utf16Length(data + offset, std::min(max_length, (size - offset) / 2));
+			if (utf16 >= min_length) {
+				matches->push_back(Match{base + offset, static_cast<int>(utf16), Encoding::Utf16});
+				offset += utf16 * 2;
+				continue;
+			}
+
+			// the only string which can start inside of a run of ASCII that
+			// is too short is a UTF-16 one, starting at its last character
+			offset += std::max<std::size_t>(ascii, 2) - 1;
+		} else {
+			offset += std::max<std::size_t>(ascii, 1);
+		}
+	}
+
+	return offset;
+}
+
+//------------------------------------------------------------------------------
+// Name: stringAt
+// Desc: attempts to get a string at a given address whose length is
+//       >= minLength and <= maxLength, preferring ASCII to UTF-16
+//------------------------------------------------------------------------------
+bool StringExtractor::stringAt(edb::address_t address, Match *match, QString *text) const {
+
+	Q_ASSERT(match);
+	Q_ASSERT(text);
+
+	if (!edb::v1::debugger_core) {
+		return false;
+	}
+
+	IProcess *process = edb::v1::debugger_core->process();
+	if (!process) {
+		return false;
+	}
+
+	const auto max_length   = static_cast<std::size_t>(std::max(maxLength_, 0));
+	const std::size_t limit = max_length * (searchUtf16_ ? 2 : 1);
+
+	// keep reading while either run of characters may still be going, each
+	// picking up from where it got to
+	QByteArray bytes;
+	std::size_t ascii = 0;
+	std::size_t utf16 = 0;
+	bool ascii_done   = false;
+	bool utf16_done   = !searchUtf16_;
+
+	while (!(ascii_done && utf16_done) && static_cast<std::size_t>(bytes.size()) < limit) {
+		const auto offset      = static_cast<std::size_t>(bytes.size());
+		const std::size_t want = std::min(StringReadSize, limit - offset);
+
+		bytes.resize(static_cast<int>(offset + want));
+		const std::size_t n = process->readBytes(address + offset, bytes.data() + offset, want);
+		bytes.resize(static_cast<int>(offset + n));
+
+		const auto data       = reinterpret_cast<const uint8_t *>(bytes.constData());
+		const std::size_t end = offset + n;
+
+		if (!ascii_done) {
+			const std::size_t available = std::min(max_length, end);
+			ascii += asciiLength(data + ascii, available - ascii);
+			ascii_done = ascii < available || available == max_length;
+		}
+
+		if (!utf16_done) {
+			const std::size_t available = std::min(max_length, end / 2);
+			utf16 += utf16Length(data + utf16 * 2, available - utf16);
+			utf16_done = utf16 < available || available == max_length;
+		}
+
+		if (n != want) {
+			break;
+		}
+	}
+
+	const auto data = reinterpret_cast<const uint8_t *>(bytes.constData());
+
+	if (ascii >= static_cast<std::size_t>(minLength_)) {
+		*match = Match{address, static_cast<int>(ascii), Encoding::Ascii};
+		*text  = toString(data, match->length, match->encoding);
+		return true;
+	}
+
+	if (searchUtf16_) {
+		if (utf16 >= static_cast<std::size_t>(minLength_)) {
+			*match = Match{address, static_cast<int>(utf16), Encoding::Utf16};
+			*text  = toString(data, match->length, match->encoding);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//------------------------------------------------------------------------------
+// Name: run
+// Desc: finds all of the strings in <region> of the current process, in
+//       address order. Both handlers are called on the calling thread, which
+//       must be the one that owns the debugger core. Returns false if the
+//       search was cancelled.
+//------------------------------------------------------------------------------
+bool StringExtractor::run(const std::shared_ptr<IRegion> &region, const ResultHandler &onResult, const ProgressHandler &onProgress) const {
+
+	if (!edb::v1::debugger_core) {
+		return true;
+	}
+
+	IProcess *process = edb::v1::debugger_core->process();
+	if (!process) {
+		return true;
+	}
+
+	const std::size_t page_size = edb::v1::debugger_core->pageSize();
+
+	// chunks overlap by enough that a string starting near the end of one
+	// is seen in full
+	const std::size_t overlap = static_cast<std::size_t>(maxLength_) * 2;
+
+	const edb::address_t start = region->start();
+	const edb::address_t end   = region->end();
+	edb::address_t address     = start;
+
+	QByteArray chunk;
+	QVector<Match> matches;
+
+	while (address < end) {
+
+		const std::size_t remaining = end - address;
+		const std::size_t step      = std::min(DefaultChunkSize, remaining);
+		const std::size_t want      = std::min(step + overlap, remaining);
+
+		chunk.resize(static_cast<int>(want));
+		const std::size_t n = process->readBytes(address, chunk.data(), want);
+
+		std::size_t next = 0;
+		if (n != 0) {
+			const auto data = reinterpret_cast<const uint8_t *>(chunk.constData());
+
+			matches.clear();
+			next = extract(data, n, step, address, &matches);
+
+			for (const Match &match : matches) {
+				onResult(match, toString(data + (match.address - address).toUint(), match.length, match.encoding));
+			}
+		}
+
+		if (n < step) {
+			// we couldn't read all of it, so skip past the page that stopped us
+			const edb::address_t bad_address = address + n;
+			address                          = bad_address - (bad_address % page_size) + page_size;
+		} else {
+			address += next;
+		}
+
+		if (onProgress && !onProgress(util::percentage(std::min(address, end) - start, region->size()))) {
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,349 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SymbolIndex.h"
+
+#include <algorithm>
+#include <numeric>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+//------------------------------------------------------------------------------
+// Name: trigrams
+// Desc: the distinct trigrams of <text>, sorted
+//------------------------------------------------------------------------------
+void trigrams(const char *text, std::size_t length, std::vector<uint32_t> *result) {
+
+	result->clear();
+
+	for (std::size_t i = 0; i + 3 <= length; ++i) {
+		const auto b0 = static_cast<uint8_t>(text[i + 0]);
+		const auto b1 = static_cast<uint8_t>(text[i + 1]);
+		const auto b2 = static_cast<uint8_t>(text[i + 2]);
+		result->push_back((uint32_t(b0) << 16) | (uint32_t(b1) << 8) | b2);
+	}
+
+	std::sort(result->begin(), result->end());
+	result->erase(std::unique(result->begin(), result->end()), result->end());
+}
+
+}
+
+//------------------------------------------------------------------------------
+// Name: add
+// Desc: adds <name> to the index, returning its id. The index must be built
+//       again before searching for it
+//------------------------------------------------------------------------------
+uint32_t SymbolIndex::add(const QString &name) {
+
+	const QByteArray lower = name.toLower().toUtf8();
+	const auto id          = static_cast<uint32_t>(offsets_.size());
+
+	offsets_.push_back(static_cast<uint32_t>(names_.size()));
+	lengths_.push_back(static_cast<uint32_t>(lower.size()));
+	names_.append(lower.constData(), static_cast<std::size_t>(lower.size()));
+	return id;
+}
+
+//------------------------------------------------------------------------------
+// Name: build
+// Desc: sorts the names and makes the trigram lists for everything added
+//------------------------------------------------------------------------------
+void SymbolIndex::build() {
+
+	const auto count = static_cast<uint32_t>(offsets_.size());
+
+	auto view = [this](uint32_t id) {
+		return std::string_view(name(id), length(id));
+	};
+
+	sorted_.resize(count);
+	std::iota(sorted_.begin(), sorted_.end(), 0u);
+	std::sort(sorted_.begin(), sorted_.end(), [&view](uint32_t lhs, uint32_t rhs) {
+		return view(lhs) < view(rhs);
+	});
+
+	// count the names containing each trigram first, so that the lists can
+	// be laid out back to back in one allocation. Nearly all symbol names are
+	// ASCII, so those trigrams get a table of their own instead of a hash
+	std::vector<uint32_t> ascii(1u << 21);
+	std::unordered_map<uint32_t, uint32_t> others;
+
+	auto slot = [&ascii, &others](uint32_t trigram) -> uint32_t & {
+		if ((trigram & 0x808080) == 0) {
+			return ascii[((trigram >> 2) & 0x1fc000) | ((trigram >> 1) & 0x3f80) | (trigram & 0x7f)];
+		}
+		return others[trigram];
+	};
+
+	std::vector<uint32_t> current;
+	trigramCounts_.resize(count);
+
+	for (uint32_t id = 0; id < count; ++id) {
+		trigrams(name(id), length(id), &current);
+		trigramCounts_[id] = static_cast<uint16_t>(std::min<std::size_t>(current.size(), UINT16_MAX));
+		for (uint32_t trigram : current) {
+			++slot(trigram);
+		}
+	}
+
+	trigrams_.clear();
+	for (uint32_t i = 0; i < ascii.size(); ++i) {
+		if (ascii[i] != 0) {
+			trigrams_.push_back(((i & 0x1fc000) << 2) | ((i & 0x3f80) << 1) | (i & 0x7f));
+		}
+	}
+
+	for (const auto &other : others) {
+		trigrams_.push_back(other.first);
+	}
+
+	std::sort(trigrams_.begin(), trigrams_.end());
+
+	// from here on, the slots hold where the next id of each list goes
+	starts_.resize(trigrams_.size() + 1);
+	starts_[0] = 0;
+	for (std::size_t i = 0; i < trigrams_.size(); ++i) {
+		uint32_t &names = slot(trigrams_[i]);
+		starts_[i + 1]  = starts_[i] + names;
+		names           = starts_[i];
+	}
+
+	// the ids are visited in order, so every list ends up sorted
+	postings_.resize(starts_.back());
+
+	for (uint32_t id = 0; id < count; ++id) {
+		trigrams(name(id), length(id), &current);
+		for (uint32_t trigram : current) {
+			postings_[slot(trigram)++] = id;
+		}
+	}
+
+	hits_.assign(count, 0);
+}
+
+//------------------------------------------------------------------------------
+// Name: clear
+// Desc:
+//------------------------------------------------------------------------------
+void SymbolIndex::clear() {
+	names_.clear();
+	offsets_.clear();
+	lengths_.clear();
+	sorted_.clear();
+	trigrams_.clear();
+	starts_.clear();
+	postings_.clear();
+	trigramCounts_.clear();
+	hits_.clear();
+}
+
+//------------------------------------------------------------------------------
+// Name: postings
+// Desc: the ids of the names containing <trigram>
+//------------------------------------------------------------------------------
+const uint32_t *SymbolIndex::postings(uint32_t trigram, std::size_t *count) const {
+
+	auto it = std::lower_bound(trigrams_.begin(), trigrams_.end(), trigram);
+	if (it == trigrams_.end() || *it != trigram) {
+		*count = 0;
+		return nullptr;
+	}
+
+	const auto index = static_cast<std::size_t>(it - trigrams_.begin());
+	*count           = starts_[index + 1] - starts_[index];
+	return postings_.data() + starts_[index];
+}
+
+//------------------------------------------------------------------------------
+// Name: substringCandidates
+// Desc: the ids of the names containing every trigram of <query>, which is a
+//       superset of the names containing <query>
+//------------------------------------------------------------------------------
+std::vector<uint32_t> SymbolIndex::substringCandidates(const std::string &query) const {
+
+	std::vector<uint32_t> keys;
+	trigrams(query.data(), query.size(), &keys);
+
+	struct List {
+		const uint32_t *ids;
+		std::size_t count;
+	};
+
+	std::vector<List> lists;
+	for (uint32_t trigram : keys) {
+		List list;
+		list.ids = postings(trigram, &list.count);
+		if (list.count == 0) {
+			return {};
+		}
+		lists.push_back(list);
+	}
+
+	// start with the rarest trigram, and look the candidates up in the others
+	std::sort(lists.begin(), lists.end(), [](const List &lhs, const List &rhs) {
+		return lhs.count < rhs.count;
+	});
+
+	std::vector<uint32_t> candidates(lists[0].ids, lists[0].ids + lists[0].count);
+	for (std::size_t i = 1; i < lists.size() && !candidates.empty(); ++i) {
+		const List &list = lists[i];
+		candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&list](uint32_t id) {
+							 return !std::binary_search(list.ids, list.ids + list.count, id);
+						 }),
+						 candidates.end());
+	}
+
+	return candidates;
+}
+
+//------------------------------------------------------------------------------
+// Name: search
+// Desc: returns up to <limit> names matching <query>, best matches first,
+//       leaving out the ones which <filter> rejects
+//------------------------------------------------------------------------------
+std::vector<SymbolIndex::Result> SymbolIndex::search(const QString &query, std::size_t limit, const Filter &filter) const {
+
+	const QByteArray lower = query.toLower().toUtf8();
+	const std::string q(lower.constData(), static_cast<std::size_t>(lower.size()));
+
+	std::vector<Result> results;
+	if (q.empty() || limit == 0) {
+		return results;
+	}
+
+	auto view = [this](uint32_t id) {
+		return std::string_view(name(id), length(id));
+	};
+
+	auto accept = [&filter](uint32_t id) {
+		return !filter || filter(id);
+	};
+
+	// shorter names are more likely to be what was meant
+	auto shorter = [&view](uint32_t lhs, uint32_t rhs) {
+		const std::string_view l = view(lhs);
+		const std::string_view r = view(rhs);
+		return (l.size() != r.size()) ? l.size() < r.size() : l < r;
+	};
+
+	// the exact and prefix matches are adjacent in sorted order, with the
+	// exact ones first
+	auto it = std::lower_bound(sorted_.begin(), sorted_.end(), q, [&view](uint32_t id, const std::string &value) {
+		return view(id) < value;
+	});
+
+	for (; it != sorted_.end() && results.size() < limit; ++it) {
+		const std::string_view candidate = view(*it);
+		if (candidate.compare(0, q.size(), q) != 0) {
+			break;
+		}
+
+		if (accept(*it)) {
+			results.push_back({*it, candidate.size() == q.size() ? Match::Exact : Match::Prefix});
+		}
+	}
+
+	if (results.size() == limit) {
+		return results;
+	}
+
+	// substrings, names starting with the query were found above
+	std::vector<uint32_t> candidates;
+	if (q.size() >= 3) {
+		candidates = substringCandidates(q);
+	} else {
+		candidates.resize(offsets_.size());
+		std::iota(candidates.begin(), candidates.end(), 0u);
+	}
+
+	std::vector<uint32_t> substrings;
+	for (uint32_t id : candidates) {
+		const std::size_t pos = view(id).find(q);
+		if (pos != std::string_view::npos && pos != 0 && accept(id)) {
+			substrings.push_back(id);
+		}
+	}
+
+	const std::size_t substring_count = std::min(substrings.size(), limit - results.size());
+	std::partial_sort(substrings.begin(), substrings.begin() + substring_count, substrings.end(), shorter);
+	for (std::size_t i = 0; i < substring_count; ++i) {
+		results.push_back({substrings[i], Match::Substring});
+	}
+
+	if (results.size() == limit || q.size() < 4) {
+		return results;
+	}
+
+	// fuzzy matches, names which have at least half of the query's trigrams,
+	// ranked by how similar their sets of trigrams are
+	std::vector<uint32_t> keys;
+	trigrams(q.data(), q.size(), &keys);
+
+	std::vector<uint32_t> touched;
+	for (uint32_t trigram : keys) {
+		std::size_t count;
+		const uint32_t *ids = postings(trigram, &count);
+		for (std::size_t i = 0; i < count; ++i) {
+			uint8_t &hits = hits_[ids[i]];
+			if (hits == 0) {
+				touched.push_back(ids[i]);
+			}
+
+			if (hits != UINT8_MAX) {
+				++hits;
+			}
+		}
+	}
+
+	std::unordered_set<uint32_t> found;
+	for (const Result &result : results) {
+		found.insert(result.id);
+	}
+
+	struct Similar {
+		uint32_t id;
+		double score;
+	};
+
+	std::vector<Similar> similar;
+	for (uint32_t id : touched) {
+		const uint32_t hits = hits_[id];
+		hits_[id]           = 0;
+
+		if (hits * 2 >= keys.size() && found.find(id) == found.end() && accept(id)) {
+			// the Jaccard index of the two sets of trigrams
+			const double score = double(hits) / double(keys.size() + trigramCounts_[id] - hits);
+			similar.push_back({id, score});
+		}
+	}
+
+	const std::size_t similar_count = std::min(similar.size(), limit - results.size());
+	std::partial_sort(similar.begin(), similar.begin() + similar_count, similar.end(), [&shorter](const Similar &lhs, const Similar &rhs) {
+		return (lhs.score != rhs.score) ? lhs.score > rhs.score : shorter(lhs.id, rhs.id);
+	});
+
+	for (std::size_t i = 0; i < similar_count; ++i) {
+		results.push_back({similar[i].id, Match::Fuzzy});
+	}
+
+	return results;
+}
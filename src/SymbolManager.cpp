@@ -20,30 +20,60 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "Configuration.h"
 #include "ISymbolGenerator.h"
 #include "Symbol.h"
+#include "SymbolStore.h"
 #include "edb.h"
 
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QMessageBox>
 #include <QProcess>
+#include <QtConcurrent>
 #include <QtDebug>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <istream>
 
+//------------------------------------------------------------------------------
+// Name: ~SymbolManager
+// Desc:
+//------------------------------------------------------------------------------
+SymbolManager::~SymbolManager() {
+	pool_.waitForDone();
+}
+
 //------------------------------------------------------------------------------
 // Name: clear
 // Desc:
 //------------------------------------------------------------------------------
 void SymbolManager::clear() {
+
+	// anything still being loaded is for whatever we were debugging before
+	for (QFutureWatcher<LoadResult> *watcher : pending_) {
+		watcher->disconnect(this);
+		watcher->deleteLater();
+	}
+
+	if (!pending_.isEmpty()) {
+		pending_.clear();
+		edb::v1::clear_status();
+	}
+
 	symbolFiles_.clear();
+	stores_.clear();
 	symbols_.clear();
 	symbolsByAddress_.clear();
 	symbolsByFile_.clear();
 	symbolsByName_.clear();
+	symbolsByShortName_.clear();
 	labels_.clear();
 	labelsByName_.clear();
+
+	index_.clear();
+	indexStarts_.clear();
+	indexDirty_ = true;
 }
 
 //------------------------------------------------------------------------------
@@ -74,17 +104,26 @@ void SymbolManager::loadSymbolFile(const QString &filename, edb::address_t base)
 		}
 
 		const QString path = QString("%1/%2").arg(symbol_directory, info.absolutePath());
-		const QString name = info.fileName();
 
 		// ensure that the sub-directory exists
 		QDir().mkpath(path);
 
-		if (!symbolFiles_.contains(info.absoluteFilePath())) {
-			const QString map_file = QString("%1/%2.map").arg(path, name);
+		const QString key = info.absoluteFilePath();
 
-			if (processSymbolFile(map_file, base, filename, true)) {
-				symbolFiles_.insert(info.absoluteFilePath());
-			}
+		// generating and loading symbols can take a while, so it is done in the
+		// background and they show up when they are ready
+		if (!symbolFiles_.contains(key) && !pending_.contains(key)) {
+
+			auto watcher = new QFutureWatcher<LoadResult>(this);
+			connect(watcher, &QFutureWatcher<LoadResult>::finished, this, [this, key]() {
+				finishLoad(key);
+			});
+
+			const bool remove_stale = edb::v1::config().remove_stale_symbols;
+			watcher->setFuture(QtConcurrent::run(&pool_, &SymbolManager::loadSymbols, path, key, base, remove_stale, symbolGenerator_));
+
+			pending_.insert(key, watcher);
+			updateStatus();
 		}
 	}
 }
@@ -100,15 +139,33 @@ const std::shared_ptr<Symbol> SymbolManager::find(const QString &name) const {
 		return it.value();
 	}
 
-	// slow path... look for any symbol which matches the name, but skipping the prefix
-	// we can make this faster later at the cost of yet another hash table if we
-	// feel the need
-	auto it2 = std::find_if(symbols_.begin(), symbols_.end(), [&name](const std::shared_ptr<Symbol> &symbol) {
-		return symbol->name_no_prefix == name;
-	});
+	// the names in a store don't include the prefix, it's the binary's name
+	const int bang = name.indexOf('!');
+	if (bang != -1) {
+		const QString prefix  = name.left(bang);
+		const QByteArray rest = name.mid(bang + 1).toUtf8();
+
+		for (const LoadedStore &loaded : stores_) {
+			if (loaded.prefix == prefix) {
+				if (const std::optional<std::size_t> index = loaded.store->find(rest)) {
+					return storeSymbol(loaded, *index);
+				}
+			}
+		}
+	}
+
+	// look for any symbol which matches the name, but skipping the prefix
+	auto it2 = symbolsByShortName_.find(name);
+	if (it2 != symbolsByShortName_.end()) {
+		return it2.value();
+	}
 
-	if (it2 != symbols_.end()) {
-		return *it2;
+	// which the stores can answer with their hash tables
+	const QByteArray utf8 = name.toUtf8();
+	for (const LoadedStore &loaded : stores_) {
+		if (const std::optional<std::size_t> index = loaded.store->find(utf8)) {
+			return storeSymbol(loaded, *index);
+		}
 	}
 
 	return nullptr;
@@ -120,7 +177,19 @@ const std::shared_ptr<Symbol> SymbolManager::find(const QString &name) const {
 //------------------------------------------------------------------------------
 const std::shared_ptr<Symbol> SymbolManager::find(edb::address_t address) const {
 	auto it = symbolsByAddress_.find(address);
-	return (it != symbolsByAddress_.end()) ? it.value() : nullptr;
+	if (it != symbolsByAddress_.end()) {
+		return it.value();
+	}
+
+	for (const LoadedStore &loaded : stores_) {
+		if (const std::optional<std::size_t> index = storeLastAtOrBefore(loaded, address)) {
+			if (storeAddress(loaded, *index) == address) {
+				return storeSymbol(loaded, *index);
+			}
+		}
+	}
+
+	return nullptr;
 }
 
 //------------------------------------------------------------------------------
@@ -129,22 +198,36 @@ const std::shared_ptr<Symbol> SymbolManager::find(edb::address_t address) const
 //------------------------------------------------------------------------------
 const std::shared_ptr<Symbol> SymbolManager::findNearSymbol(edb::address_t address) const {
 
-	auto it = symbolsByAddress_.lowerBound(address);
-	if (it != symbolsByAddress_.end()) {
+	// the closest symbol which starts at or before the address, wherever it is
+	std::shared_ptr<Symbol> sym;
+
+	auto it = symbolsByAddress_.upperBound(address);
+	if (it != symbolsByAddress_.begin()) {
+		sym = (--it).value();
+	}
 
-		// not an exact match, we should backup one
-		if (address != it.value()->address) {
-			// not safe to backup!, return early
-			if (it == symbolsByAddress_.begin()) {
-				return nullptr;
+	const LoadedStore *best_store = nullptr;
+	std::size_t best_index        = 0;
+	edb::address_t best_address   = sym ? sym->address : edb::address_t(0);
+
+	for (const LoadedStore &loaded : stores_) {
+		if (const std::optional<std::size_t> index = storeLastAtOrBefore(loaded, address)) {
+			const edb::address_t start = storeAddress(loaded, *index);
+			if ((!sym && !best_store) || start > best_address) {
+				best_store   = &loaded;
+				best_index   = *index;
+				best_address = start;
 			}
-			--it;
 		}
+	}
 
-		if (const std::shared_ptr<Symbol> sym = it.value()) {
-			if (address >= sym->address && address < sym->address + sym->size) {
-				return sym;
-			}
+	if (best_store) {
+		sym = storeSymbol(*best_store, best_index);
+	}
+
+	if (sym) {
+		if (address >= sym->address && address < sym->address + sym->size) {
+			return sym;
 		}
 	}
 
@@ -161,14 +244,54 @@ void SymbolManager::addSymbol(const std::shared_ptr<Symbol> &symbol) {
 	symbolsByAddress_[symbol->address] = symbol;
 	symbolsByName_[symbol->name]       = symbol;
 	symbolsByFile_[symbol->file].push_back(symbol);
+
+	// when names are ambiguous without the prefix, the first one wins
+	if (!symbolsByShortName_.contains(symbol->name_no_prefix)) {
+		symbolsByShortName_.insert(symbol->name_no_prefix, symbol);
+	}
+
+	indexDirty_ = true;
+}
+
+//------------------------------------------------------------------------------
+// Name: loadSymbols
+// Desc: runs on a worker thread, finds the symbols for <library_filename> in
+//       <path>, generating them first if there aren't any yet. This must not
+//       touch the state of the symbol manager, the result is published by
+//       finishLoad
+//------------------------------------------------------------------------------
+SymbolManager::LoadResult SymbolManager::loadSymbols(const QString &path, const QString &library_filename, edb::address_t base, bool remove_stale, ISymbolGenerator *generator) {
+
+	const QString name       = QFileInfo(library_filename).fileName();
+	const QString store_file = QString("%1/%2.sym").arg(path, name);
+	const QString map_file   = QString("%1/%2.map").arg(path, name);
+
+	LoadResult result;
+
+	// text symbol files made by older versions are still read, but only
+	// until there is a store for the same binary
+	if (QFile::exists(map_file) && !QFile::exists(store_file)) {
+		result.status = processSymbolFile(map_file, base, library_filename, remove_stale, &result.symbols);
+		if (result.status != LoadStatus::Missing) {
+			return result;
+		}
+	}
+
+	result.status = processSymbolStore(store_file, base, library_filename, remove_stale, &result.store);
+	if (result.status == LoadStatus::Missing && generator) {
+		if (generator->generateSymbolFile(library_filename, store_file)) {
+			result.status = processSymbolStore(store_file, base, library_filename, remove_stale, &result.store);
+		}
+	}
+
+	return result;
 }
 
 //------------------------------------------------------------------------------
 // Name: processSymbolFile
-// Desc:
-// Note: returning false means 'try again', true means, 'we loaded what we could'
+// Desc: reads a text symbol file into <symbols>
 //------------------------------------------------------------------------------
-bool SymbolManager::processSymbolFile(const QString &f, edb::address_t base, const QString &library_filename, bool allow_retry) {
+SymbolManager::LoadStatus SymbolManager::processSymbolFile(const QString &f, edb::address_t base, const QString &library_filename, bool remove_stale, std::vector<std::shared_ptr<Symbol>> *symbols) {
 
 	// TODO(eteran): support filename starting with "http://" being fetched from a web server
 
@@ -179,7 +302,6 @@ bool SymbolManager::processSymbolFile(const QString &f, edb::address_t base, con
 
 	std::ifstream file(qPrintable(f));
 	if (file) {
-		edb::v1::set_status(tr("Loading symbols: %1").arg(f), 0);
 		edb::address_t sym_start;
 		edb::address_t sym_end;
 		std::string sym_name;
@@ -193,20 +315,16 @@ bool SymbolManager::processSymbolFile(const QString &f, edb::address_t base, con
 			if (file) {
 
 				const QByteArray file_md5   = QByteArray::fromHex(md5.c_str());
-				const QByteArray actual_md5 = edb::v1::get_file_md5(library_filename);
+				const QByteArray actual_md5 = edb::v1::get_symbol_md5(library_filename);
 
 				if (file_md5 != actual_md5) {
 					qDebug() << "Your symbol file for" << library_filename << "appears to not match the actual file, perhaps you should rebuild your symbols?";
-					const Configuration &config = edb::v1::config();
-					if (config.remove_stale_symbols) {
+					if (remove_stale) {
+						file.close();
 						symbolFile.remove();
-
-						if (allow_retry) {
-							return processSymbolFile(f, base, library_filename, false);
-						}
+						return LoadStatus::Missing;
 					}
-					edb::v1::clear_status();
-					return false;
+					return LoadStatus::Stale;
 				}
 
 				const QFileInfo info(QString::fromStdString(filename));
@@ -238,32 +356,314 @@ bool SymbolManager::processSymbolFile(const QString &f, edb::address_t base, con
 						sym->address += base;
 					}
 
-					addSymbol(sym);
+					symbols->push_back(sym);
 				}
-				edb::v1::clear_status();
-				return true;
 			}
 		}
-	} else if (symbolGenerator_) {
-		edb::v1::set_status(tr("Auto-Generating Symbol File: %1").arg(f), 0);
-		bool generatedOK = symbolGenerator_->generateSymbolFile(library_filename, f);
+
+		// TODO(eteran): should we return Missing and try again later?
+		return LoadStatus::Loaded;
+	}
+
+	return LoadStatus::Missing;
+}
+
+//------------------------------------------------------------------------------
+// Name: processSymbolStore
+// Desc: like processSymbolFile, but for a symbol store. Nothing is read up
+//       front, the store is mapped and the symbols in it are looked up there
+//------------------------------------------------------------------------------
+SymbolManager::LoadStatus SymbolManager::processSymbolStore(const QString &f, edb::address_t base, const QString &library_filename, bool remove_stale, LoadedStore *loaded) {
+
+	if (!QFile::exists(f)) {
+		return LoadStatus::Missing;
+	}
+
+	std::shared_ptr<SymbolStore> store = SymbolStore::open(f);
+	if (!store) {
+		qWarning() << "WARNING: File" << f << "seems corrupt";
+		QFile::remove(f);
+		return LoadStatus::Missing;
+	}
+
+	if (store->md5() != edb::v1::get_symbol_md5(library_filename)) {
+		qDebug() << "Your symbol file for" << library_filename << "appears to not match the actual file, perhaps you should rebuild your symbols?";
+		if (remove_stale) {
+			store.reset();
+			QFile::remove(f);
+			return LoadStatus::Missing;
+		}
+		return LoadStatus::Stale;
+	}
+
+	loaded->prefix   = QFileInfo(store->binary()).fileName();
+	loaded->base     = base;
+	loaded->relative = store->lowerBound(0, store->size(), base.toUint());
+	loaded->store    = std::move(store);
+	return LoadStatus::Loaded;
+}
+
+//------------------------------------------------------------------------------
+// Name: finishLoad
+// Desc: makes the symbols that a worker loaded for <filename> available
+//------------------------------------------------------------------------------
+void SymbolManager::finishLoad(const QString &filename) {
+
+	QFutureWatcher<LoadResult> *const watcher = pending_.take(filename);
+	if (!watcher) {
+		return;
+	}
+
+	watcher->disconnect(this);
+	watcher->deleteLater();
+
+	const LoadResult result = watcher->result();
+
+	// a stale file which was kept gets another chance next time around
+	if (result.status != LoadStatus::Stale) {
+		symbolFiles_.insert(filename);
+	}
+
+	for (const std::shared_ptr<Symbol> &symbol : result.symbols) {
+		addSymbol(symbol);
+	}
+
+	if (result.store.store) {
+		stores_.push_back(result.store);
+		indexDirty_ = true;
+	}
+
+	updateStatus();
+
+	if (!result.symbols.empty() || result.store.store) {
+		Q_EMIT symbolsChanged();
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: updateStatus
+// Desc:
+//------------------------------------------------------------------------------
+void SymbolManager::updateStatus() {
+	if (pending_.isEmpty()) {
 		edb::v1::clear_status();
-		if (generatedOK) {
-			return false;
+	} else {
+		edb::v1::set_status(tr("Loading symbols: %1 modules remaining").arg(pending_.size()), 0);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: waitForSymbolFile
+// Desc: if the symbols for <filename> are being loaded, waits for that to
+//       finish so that they can be used right away
+//------------------------------------------------------------------------------
+void SymbolManager::waitForSymbolFile(const QString &filename) {
+
+	const QString key = QFileInfo(filename).absoluteFilePath();
+
+	if (QFutureWatcher<LoadResult> *const watcher = pending_.value(key)) {
+		watcher->waitForFinished();
+		finishLoad(key);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: storeAddress
+// Desc: the address of the symbol at <index> in <loaded>, after fixing it up
+//       for where the binary is loaded
+//------------------------------------------------------------------------------
+edb::address_t SymbolManager::storeAddress(const LoadedStore &loaded, std::size_t index) {
+	const edb::address_t address = loaded.store->address(index);
+	return (index < loaded.relative) ? address + loaded.base : address;
+}
+
+//------------------------------------------------------------------------------
+// Name: storeLastAtOrBefore
+// Desc: the index of the symbol in <loaded> with the highest address which is
+//       not greater than <address>. Both the relative and the absolute symbols
+//       are sorted, so this is a binary search of each
+//------------------------------------------------------------------------------
+std::optional<std::size_t> SymbolManager::storeLastAtOrBefore(const LoadedStore &loaded, edb::address_t address) {
+
+	std::optional<std::size_t> result;
+
+	if (address >= loaded.base) {
+		const std::size_t index = loaded.store->upperBound(0, loaded.relative, (address - loaded.base).toUint());
+		if (index != 0) {
+			result = index - 1;
+		}
+	}
+
+	const std::size_t index = loaded.store->upperBound(loaded.relative, loaded.store->size(), address.toUint());
+	if (index != loaded.relative) {
+		if (!result || storeAddress(loaded, index - 1) >= storeAddress(loaded, *result)) {
+			result = index - 1;
 		}
 	}
 
-	// TODO(eteran): should we return false and try again later?
-	edb::v1::clear_status();
-	return true;
+	return result;
+}
+
+//------------------------------------------------------------------------------
+// Name: storeSymbol
+// Desc: makes a Symbol for the symbol at <index> in <loaded>
+//------------------------------------------------------------------------------
+std::shared_ptr<Symbol> SymbolManager::storeSymbol(const LoadedStore &loaded, std::size_t index) {
+
+	auto sym = std::make_shared<Symbol>();
+
+	sym->file           = loaded.store->filename();
+	sym->name_no_prefix = loaded.store->name(index);
+	sym->name           = QString("%1!%2").arg(loaded.prefix, sym->name_no_prefix);
+	sym->address        = storeAddress(loaded, index);
+	sym->size           = loaded.store->symbolSize(index);
+	sym->type           = loaded.store->type(index);
+	return sym;
 }
 
 //------------------------------------------------------------------------------
 // Name: symbols
-// Desc:
+// Desc: every symbol, this makes a Symbol for everything in the symbol stores
+//       so prefer a more specific lookup when there is one
 //------------------------------------------------------------------------------
 const std::vector<std::shared_ptr<Symbol>> SymbolManager::symbols() const {
-	return symbols_;
+
+	std::vector<std::shared_ptr<Symbol>> results = symbols_;
+
+	for (const LoadedStore &loaded : stores_) {
+		for (std::size_t i = 0; i < loaded.store->size(); ++i) {
+			results.push_back(storeSymbol(loaded, i));
+		}
+	}
+
+	return results;
+}
+
+//------------------------------------------------------------------------------
+// Name: symbols
+// Desc: the symbols whose address is in [start, end)
+//------------------------------------------------------------------------------
+const std::vector<std::shared_ptr<Symbol>> SymbolManager::symbols(edb::address_t start, edb::address_t end) const {
+
+	std::vector<std::shared_ptr<Symbol>> results;
+
+	for (auto it = symbolsByAddress_.lowerBound(start); it != symbolsByAddress_.end() && it.key() < end; ++it) {
+		results.push_back(it.value());
+	}
+
+	for (const LoadedStore &loaded : stores_) {
+
+		auto add_range = [&](std::size_t first, std::size_t last) {
+			for (std::size_t i = first; i < last; ++i) {
+				results.push_back(storeSymbol(loaded, i));
+			}
+		};
+
+		if (end > loaded.base) {
+			const edb::address_t relative_start = (start > loaded.base) ? start - loaded.base : edb::address_t(0);
+			const edb::address_t relative_end   = end - loaded.base;
+			add_range(
+				loaded.store->lowerBound(0, loaded.relative, relative_start.toUint()),
+				loaded.store->lowerBound(0, loaded.relative, relative_end.toUint()));
+		}
+
+		add_range(
+			loaded.store->lowerBound(loaded.relative, loaded.store->size(), start.toUint()),
+			loaded.store->lowerBound(loaded.relative, loaded.store->size(), end.toUint()));
+	}
+
+	return results;
+}
+
+//------------------------------------------------------------------------------
+// Name: buildIndex
+// Desc: indexes the names of every symbol for search()
+//------------------------------------------------------------------------------
+void SymbolManager::buildIndex() const {
+
+	index_.clear();
+	indexStarts_.clear();
+
+	for (const std::shared_ptr<Symbol> &symbol : symbols_) {
+		index_.add(symbol->name_no_prefix);
+	}
+
+	for (const LoadedStore &loaded : stores_) {
+		indexStarts_.push_back(static_cast<uint32_t>(index_.size()));
+		for (std::size_t i = 0; i < loaded.store->size(); ++i) {
+			index_.add(loaded.store->name(i));
+		}
+	}
+
+	index_.build();
+	indexDirty_ = false;
+}
+
+//------------------------------------------------------------------------------
+// Name: indexedInModule
+// Desc: returns true if the prefix of the symbol that <id> in the index
+//       refers to starts with <module>
+//------------------------------------------------------------------------------
+bool SymbolManager::indexedInModule(uint32_t id, const QString &module) const {
+
+	auto it = std::upper_bound(indexStarts_.begin(), indexStarts_.end(), id);
+	if (it == indexStarts_.begin()) {
+		return symbols_[id]->name.startsWith(module, Qt::CaseInsensitive);
+	}
+
+	return stores_[static_cast<std::size_t>(it - indexStarts_.begin() - 1)].prefix.startsWith(module, Qt::CaseInsensitive);
+}
+
+//------------------------------------------------------------------------------
+// Name: indexedSymbol
+// Desc: the symbol that <id> in the index refers to
+//------------------------------------------------------------------------------
+std::shared_ptr<Symbol> SymbolManager::indexedSymbol(uint32_t id) const {
+
+	auto it = std::upper_bound(indexStarts_.begin(), indexStarts_.end(), id);
+	if (it == indexStarts_.begin()) {
+		return symbols_[id];
+	}
+
+	const auto store = static_cast<std::size_t>(it - indexStarts_.begin() - 1);
+	return storeSymbol(stores_[store], id - indexStarts_[store]);
+}
+
+//------------------------------------------------------------------------------
+// Name: search
+// Desc: finds up to <limit> symbols whose names look like <query>, best
+//       matches first. A query of the form "module!name" only looks at the
+//       modules whose names start with "module"
+//------------------------------------------------------------------------------
+const std::vector<std::shared_ptr<Symbol>> SymbolManager::search(const QString &query, std::size_t limit) const {
+
+	if (indexDirty_) {
+		buildIndex();
+	}
+
+	QString module;
+	QString name = query;
+
+	const int bang = query.indexOf('!');
+	if (bang != -1) {
+		module = query.left(bang);
+		name   = query.mid(bang + 1);
+	}
+
+	// the index skips the other modules itself, so it can stop at <limit>
+	SymbolIndex::Filter filter;
+	if (!module.isEmpty()) {
+		filter = [this, &module](uint32_t id) {
+			return indexedInModule(id, module);
+		};
+	}
+
+	std::vector<std::shared_ptr<Symbol>> results;
+	for (const SymbolIndex::Result &match : index_.search(name, limit, filter)) {
+		results.push_back(indexedSymbol(match.id));
+	}
+
+	return results;
 }
 
 //------------------------------------------------------------------------------
@@ -271,6 +671,8 @@ const std::vector<std::shared_ptr<Symbol>> SymbolManager::symbols() const {
 // Desc:
 //------------------------------------------------------------------------------
 void SymbolManager::setSymbolGenerator(ISymbolGenerator *generator) {
+	// the workers may be using the one that we had until now
+	pool_.waitForDone();
 	symbolGenerator_ = generator;
 }
 
@@ -329,5 +731,11 @@ QHash<edb::address_t, QString> SymbolManager::labels() const {
 // Desc:
 //------------------------------------------------------------------------------
 QStringList SymbolManager::files() const {
-	return symbolsByFile_.keys();
+
+	QStringList results = symbolsByFile_.keys();
+	for (const LoadedStore &loaded : stores_) {
+		results.push_back(loaded.store->filename());
+	}
+
+	return results;
 }
@@ -20,28 +20,36 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define SYMBOL_MANAGER_H_20060814_
 
 #include "ISymbolManager.h"
+#include "SymbolIndex.h"
 
-#include <QCoreApplication>
+#include <QFutureWatcher>
 #include <QHash>
 #include <QMap>
 #include <QSet>
+#include <QThreadPool>
+#include <optional>
 
 class QString;
+class SymbolStore;
 
 class SymbolManager final : public ISymbolManager {
-	Q_DECLARE_TR_FUNCTIONS(SymbolManager)
+	Q_OBJECT
 
 public:
 	SymbolManager() = default;
+	~SymbolManager() override;
 
 public:
 	const std::vector<std::shared_ptr<Symbol>> symbols() const override;
+	const std::vector<std::shared_ptr<Symbol>> symbols(edb::address_t start, edb::address_t end) const override;
+	const std::vector<std::shared_ptr<Symbol>> search(const QString &query, std::size_t limit) const override;
 	const std::shared_ptr<Symbol> find(const QString &name) const override;
 	const std::shared_ptr<Symbol> find(edb::address_t address) const override;
 	const std::shared_ptr<Symbol> findNearSymbol(edb::address_t address) const override;
 	void addSymbol(const std::shared_ptr<Symbol> &symbol) override;
 	void clear() override;
 	void loadSymbolFile(const QString &filename, edb::address_t base) override;
+	void waitForSymbolFile(const QString &filename) override;
 	void setSymbolGenerator(ISymbolGenerator *generator) override;
 	void setLabel(edb::address_t address, const QString &label) override;
 	QString findAddressName(edb::address_t address, bool prefixed = true) override;
@@ -49,18 +57,69 @@ public:
 	QStringList files() const override;
 
 private:
-	bool processSymbolFile(const QString &f, edb::address_t base, const QString &library_filename, bool allow_retry);
+	// a symbol store, and where the binary it is for is loaded. Symbols with
+	// an address below the base are relative to it, which is all of them for
+	// libraries, and none of them for most executables
+	struct LoadedStore {
+		std::shared_ptr<SymbolStore> store;
+		QString prefix;
+		edb::address_t base  = 0;
+		std::size_t relative = 0; // the number of relative symbols, they sort first
+	};
+
+	enum class LoadStatus {
+		Loaded,
+		Missing, // there was no symbol file, or it was removed
+		Stale,   // the symbol file doesn't match the binary, but was kept
+	};
+
+	// what a worker made of the symbol file for a binary, the symbols are
+	// made available all at once when it is published on the GUI thread
+	struct LoadResult {
+		LoadStatus status = LoadStatus::Missing;
+		std::vector<std::shared_ptr<Symbol>> symbols;
+		LoadedStore store;
+	};
+
+private:
+	static LoadResult loadSymbols(const QString &path, const QString &library_filename, edb::address_t base, bool remove_stale, ISymbolGenerator *generator);
+	static LoadStatus processSymbolFile(const QString &f, edb::address_t base, const QString &library_filename, bool remove_stale, std::vector<std::shared_ptr<Symbol>> *symbols);
+	static LoadStatus processSymbolStore(const QString &f, edb::address_t base, const QString &library_filename, bool remove_stale, LoadedStore *loaded);
+
+private:
+	void finishLoad(const QString &filename);
+	void updateStatus();
+	void buildIndex() const;
+	bool indexedInModule(uint32_t id, const QString &module) const;
+	std::shared_ptr<Symbol> indexedSymbol(uint32_t id) const;
+
+private:
+	static edb::address_t storeAddress(const LoadedStore &loaded, std::size_t index);
+	static std::optional<std::size_t> storeLastAtOrBefore(const LoadedStore &loaded, edb::address_t address);
+	static std::shared_ptr<Symbol> storeSymbol(const LoadedStore &loaded, std::size_t index);
 
 private:
 	QSet<QString> symbolFiles_;
+	std::vector<LoadedStore> stores_;
 	std::vector<std::shared_ptr<Symbol>> symbols_;
 	QMap<edb::address_t, std::shared_ptr<Symbol>> symbolsByAddress_;
 	QHash<QString, QList<std::shared_ptr<Symbol>>> symbolsByFile_;
 	QHash<QString, std::shared_ptr<Symbol>> symbolsByName_;
+	QHash<QString, std::shared_ptr<Symbol>> symbolsByShortName_;
 	QHash<edb::address_t, QString> labels_;
 	QHash<QString, edb::address_t> labelsByName_;
 	ISymbolGenerator *symbolGenerator_ = nullptr;
 	bool showPathNotice_               = true;
+
+	// symbol files are generated and loaded here, keyed by the binary
+	QThreadPool pool_;
+	QHash<QString, QFutureWatcher<LoadResult> *> pending_;
+
+	// the names of everything above for search(), built when it is first
+	// needed. The ids of symbols_ come first, then those of each store
+	mutable SymbolIndex index_;
+	mutable std::vector<uint32_t> indexStarts_; // the first id of each store
+	mutable bool indexDirty_ = true;
 };
 
 #endif
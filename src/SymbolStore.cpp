@@ -0,0 +1,320 @@
+/*
+Copyright (C) 2020 - 2020 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SymbolStore.h"
+
+#include <QDateTime>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+constexpr char Magic[8] = {'E', 'D', 'B', 'S', 'Y', 'M', 'S', '\0'};
+
+//------------------------------------------------------------------------------
+// Name: align
+// Desc: rounds <offset> up to the next 8 byte boundary
+//------------------------------------------------------------------------------
+constexpr uint64_t align(uint64_t offset) {
+	return (offset + 7) & ~uint64_t(7);
+}
+
+//------------------------------------------------------------------------------
+// Name: write_padded
+// Desc: writes <size> bytes followed by enough zeros to reach <padded_size>
+//------------------------------------------------------------------------------
+bool write_padded(QSaveFile &file, const void *data, uint64_t size, uint64_t padded_size) {
+
+	static const char zeros[8] = {};
+
+	if (size != 0 && file.write(static_cast<const char *>(data), static_cast<qint64>(size)) != static_cast<qint64>(size)) {
+		return false;
+	}
+
+	const qint64 padding = static_cast<qint64>(padded_size - size);
+	return padding == 0 || file.write(zeros, padding) == padding;
+}
+
+}
+
+//------------------------------------------------------------------------------
+// Name: hash
+// Desc: FNV-1a, this is part of the file format so it must never change
+//------------------------------------------------------------------------------
+uint64_t SymbolStore::hash(const char *name, std::size_t length) {
+	uint64_t h = 0xcbf29ce484222325ull;
+	for (std::size_t i = 0; i < length; ++i) {
+		h ^= static_cast<uint8_t>(name[i]);
+		h *= 0x100000001b3ull;
+	}
+	return h;
+}
+
+//------------------------------------------------------------------------------
+// Name: write
+// Desc: writes <records> as a symbol store for <binary> to <filename>. When
+//       more than one symbol has the same name, looking the name up finds the
+//       one with the highest address
+//------------------------------------------------------------------------------
+bool SymbolStore::write(const QString &filename, const QString &binary, const QByteArray &md5, std::vector<Record> records) {
+
+	static_assert(sizeof(Header) % 8 == 0, "the header must keep the sections after it aligned");
+	static_assert(sizeof(Entry) == 16, "entries are part of the file format");
+
+	std::stable_sort(records.begin(), records.end(), [](const Record &lhs, const Record &rhs) {
+		return lhs.address < rhs.address;
+	});
+
+	// the hash table has to fit twice as many entries in 32-bit indexes
+	const std::size_t count = records.size();
+	if (count > (std::size_t(1) << 30)) {
+		return false;
+	}
+
+	QByteArray strings;
+	auto add_string = [&strings](const QByteArray &string) {
+		const auto offset = static_cast<uint64_t>(strings.size());
+		strings.append(string);
+		strings.append('\0');
+		return offset;
+	};
+
+	const uint64_t binary_offset = add_string(binary.toUtf8());
+
+	uint32_t bucket_count = 1;
+	while (bucket_count < count * 2) {
+		bucket_count *= 2;
+	}
+
+	const uint32_t mask = bucket_count - 1;
+
+	std::vector<uint64_t> addresses(count);
+	std::vector<Entry> entries(count);
+	std::vector<uint32_t> buckets(bucket_count, 0);
+	std::vector<QByteArray> names(count);
+
+	for (std::size_t i = 0; i < count; ++i) {
+		const Record &record = records[i];
+		names[i]             = record.name.toUtf8();
+
+		const uint64_t offset = add_string(names[i]);
+		if (offset > std::numeric_limits<uint32_t>::max()) {
+			return false;
+		}
+
+		addresses[i]      = record.address.toUint();
+		entries[i]        = Entry();
+		entries[i].name   = static_cast<uint32_t>(offset);
+		entries[i].length = static_cast<uint32_t>(names[i].size());
+		entries[i].size   = record.size;
+		entries[i].type   = static_cast<uint8_t>(record.type);
+
+		// linear probing, a later symbol with the same name takes the slot over
+		uint32_t slot = static_cast<uint32_t>(hash(names[i].constData(), names[i].size())) & mask;
+		while (buckets[slot] != 0 && names[buckets[slot] - 1] != names[i]) {
+			slot = (slot + 1) & mask;
+		}
+
+		buckets[slot] = static_cast<uint32_t>(i + 1);
+	}
+
+	Header header = {};
+	std::memcpy(header.magic, Magic, sizeof(Magic));
+	header.version     = Version;
+	header.bucketCount = bucket_count;
+	header.count       = count;
+	header.addresses   = align(sizeof(Header));
+	header.entries     = align(header.addresses + count * sizeof(uint64_t));
+	header.buckets     = align(header.entries + count * sizeof(Entry));
+	header.strings     = align(header.buckets + bucket_count * sizeof(uint32_t));
+	header.stringsSize = static_cast<uint64_t>(strings.size());
+	header.binary      = static_cast<uint32_t>(binary_offset);
+	header.created     = QDateTime::currentMSecsSinceEpoch() / 1000;
+	std::memcpy(header.md5, md5.constData(), std::min<std::size_t>(md5.size(), sizeof(header.md5)));
+
+	// written to a temporary file and renamed into place, so nobody ever
+	// gets to see half of a store
+	QSaveFile file(filename);
+	if (!file.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+
+	const bool ok =
+		write_padded(file, &header, sizeof(Header), header.addresses) &&
+		write_padded(file, addresses.data(), count * sizeof(uint64_t), header.entries - header.addresses) &&
+		write_padded(file, entries.data(), count * sizeof(Entry), header.buckets - header.entries) &&
+		write_padded(file, buckets.data(), bucket_count * sizeof(uint32_t), header.strings - header.buckets) &&
+		write_padded(file, strings.constData(), header.stringsSize, header.stringsSize);
+
+	if (!ok) {
+		file.cancelWriting();
+		return false;
+	}
+
+	return file.commit();
+}
+
+//------------------------------------------------------------------------------
+// Name: open
+// Desc: maps the store in <filename>, returns nullptr if it isn't one which
+//       this version of edb understands
+//------------------------------------------------------------------------------
+std::shared_ptr<SymbolStore> SymbolStore::open(const QString &filename) {
+
+	std::shared_ptr<SymbolStore> store(new SymbolStore);
+	store->file_.setFileName(filename);
+
+	if (!store->file_.open(QIODevice::ReadOnly)) {
+		return nullptr;
+	}
+
+	const auto file_size = static_cast<uint64_t>(store->file_.size());
+	if (file_size < sizeof(Header)) {
+		return nullptr;
+	}
+
+	const uchar *const base = store->file_.map(0, store->file_.size());
+	if (!base) {
+		return nullptr;
+	}
+
+	// the mapping stays valid until the file object is destroyed
+	store->file_.close();
+
+	const auto header = reinterpret_cast<const Header *>(base);
+	if (std::memcmp(header->magic, Magic, sizeof(Magic)) != 0 || header->version != Version) {
+		return nullptr;
+	}
+
+	if (header->bucketCount == 0 || (header->bucketCount & (header->bucketCount - 1)) != 0) {
+		return nullptr;
+	}
+
+	// everything we'll ever touch has to be inside of the file
+	auto in_file = [file_size](uint64_t offset, uint64_t count, uint64_t size) {
+		return offset % 8 == 0 && offset <= file_size && count <= (file_size - offset) / size;
+	};
+
+	if (!in_file(header->addresses, header->count, sizeof(uint64_t)) ||
+		!in_file(header->entries, header->count, sizeof(Entry)) ||
+		!in_file(header->buckets, header->bucketCount, sizeof(uint32_t)) ||
+		!in_file(header->strings, header->stringsSize, 1)) {
+		return nullptr;
+	}
+
+	store->header_    = header;
+	store->addresses_ = reinterpret_cast<const uint64_t *>(base + header->addresses);
+	store->entries_   = reinterpret_cast<const Entry *>(base + header->entries);
+	store->buckets_   = reinterpret_cast<const uint32_t *>(base + header->buckets);
+	store->strings_   = reinterpret_cast<const char *>(base + header->strings);
+	store->count_     = static_cast<std::size_t>(header->count);
+	return store;
+}
+
+//------------------------------------------------------------------------------
+// Name: name
+// Desc: the name of the symbol at <index>
+//------------------------------------------------------------------------------
+QString SymbolStore::name(std::size_t index) const {
+
+	const Entry &entry = entries_[index];
+	if (entry.name > header_->stringsSize || entry.length > header_->stringsSize - entry.name) {
+		return QString();
+	}
+
+	return QString::fromUtf8(strings_ + entry.name, static_cast<int>(entry.length));
+}
+
+//------------------------------------------------------------------------------
+// Name: upperBound
+// Desc: the index of the first symbol in [first, last) whose address is
+//       greater than <address>
+//------------------------------------------------------------------------------
+std::size_t SymbolStore::upperBound(std::size_t first, std::size_t last, uint64_t address) const {
+	return static_cast<std::size_t>(std::upper_bound(addresses_ + first, addresses_ + last, address) - addresses_);
+}
+
+//------------------------------------------------------------------------------
+// Name: lowerBound
+// Desc: the index of the first symbol in [first, last) whose address is not
+//       less than <address>
+//------------------------------------------------------------------------------
+std::size_t SymbolStore::lowerBound(std::size_t first, std::size_t last, uint64_t address) const {
+	return static_cast<std::size_t>(std::lower_bound(addresses_ + first, addresses_ + last, address) - addresses_);
+}
+
+//------------------------------------------------------------------------------
+// Name: find
+// Desc: the index of the symbol named <name> (in UTF-8)
+//------------------------------------------------------------------------------
+std::optional<std::size_t> SymbolStore::find(const QByteArray &name) const {
+
+	const uint32_t mask = header_->bucketCount - 1;
+	uint32_t slot       = static_cast<uint32_t>(hash(name.constData(), name.size())) & mask;
+
+	for (uint32_t probes = 0; probes < header_->bucketCount; ++probes) {
+
+		const uint32_t index = buckets_[slot];
+		if (index == 0) {
+			break;
+		}
+
+		if (index <= count_) {
+			const Entry &entry = entries_[index - 1];
+			if (entry.length == static_cast<uint32_t>(name.size()) && entry.name <= header_->stringsSize && entry.length <= header_->stringsSize - entry.name) {
+				if (std::memcmp(strings_ + entry.name, name.constData(), entry.length) == 0) {
+					return index - 1;
+				}
+			}
+		}
+
+		slot = (slot + 1) & mask;
+	}
+
+	return {};
+}
+
+//------------------------------------------------------------------------------
+// Name: md5
+// Desc: the checksum of the binary that these symbols were generated from
+//------------------------------------------------------------------------------
+QByteArray SymbolStore::md5() const {
+	return QByteArray(reinterpret_cast<const char *>(header_->md5), sizeof(header_->md5));
+}
+
+//------------------------------------------------------------------------------
+// Name: binary
+// Desc: the path of the binary that these symbols were generated from
+//------------------------------------------------------------------------------
+QString SymbolStore::binary() const {
+
+	if (header_->binary >= header_->stringsSize) {
+		return QString();
+	}
+
+	const char *const first = strings_ + header_->binary;
+	const auto end          = static_cast<const char *>(std::memchr(first, '\0', header_->stringsSize - header_->binary));
+	if (!end) {
+		return QString();
+	}
+
+	return QString::fromUtf8(first, static_cast<int>(end - first));
+}
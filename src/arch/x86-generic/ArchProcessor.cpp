@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "IProcess.h"
 #include "IThread.h"
 #include "Instruction.h"
+#include "InstructionCache.h"
 #include "Prototype.h"
 #include "RegisterViewModel.h"
 #include "State.h"
@@ -826,21 +827,26 @@ void analyze_jump_targets(const edb::Instruction &inst, QStringList &ret) {
 	const edb::address_t start_address = address - 128;
 	const edb::address_t end_address   = address + 127;
 
-	uint8_t buffer[edb::Instruction::MaxSize];
+	// read the whole window at once, plus enough to decode the last one
+	uint8_t buffer[255 + edb::Instruction::MaxSize];
+	std::size_t size = sizeof(buffer);
 
-	for (edb::address_t addr = start_address; addr < end_address; ++addr) {
-		if (const int sz = edb::v1::get_instruction_bytes(addr, buffer)) {
-			edb::Instruction inst(buffer, buffer + sz, addr);
-			if (is_jump(inst)) {
-				const auto operand = inst[0];
+	if (!edb::v1::get_instruction_bytes(start_address, buffer, &size)) {
+		return;
+	}
 
-				if (is_immediate(operand)) {
-					const edb::address_t target = operand->imm;
+	InstructionCache &cache = edb::v1::instruction_cache();
 
-					if (target == address) {
-						ret << ArchProcessor::tr("possible jump from %1").arg(edb::v1::format_pointer(addr));
-					}
-				}
+	for (edb::address_t addr = start_address; addr < end_address; ++addr) {
+		const std::size_t offset = (addr - start_address).toUint();
+		if (offset >= size) {
+			break;
+		}
+
+		const InstructionCache::Entry entry = cache.lookup(addr, buffer + offset, buffer + size);
+		if ((entry.flow == InstructionCache::Flow::Jump || entry.flow == InstructionCache::Flow::ConditionalJump) && entry.hasTarget) {
+			if (entry.target == address) {
+				ret << ArchProcessor::tr("possible jump from %1").arg(edb::v1::format_pointer(addr));
 			}
 		}
 	}
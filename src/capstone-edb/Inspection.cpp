@@ -162,7 +162,7 @@ bool is_conditional_gpr_move(const Instruction &insn) {
 }
 
 bool is_fpu(const Instruction &insn) {
-	return insn && ((insn->detail->x86.opcode[0] & 0xd8) == 0xd8);
+	return insn.hasDetail() && ((insn->detail->x86.opcode[0] & 0xd8) == 0xd8);
 }
 
 bool is_conditional_move(const Instruction &insn) {
@@ -240,7 +240,7 @@ bool is_fpu_taking_bcd(const Instruction &insn) {
 }
 
 bool is_simd(const Instruction &insn) {
-	if (!insn)
+	if (!insn.hasDetail())
 		return false;
 
 	const x86_insn_group simdGroups[] = {
@@ -23,9 +23,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QStringList>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cctype>
 #include <cstring>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <vector>
@@ -36,11 +38,120 @@ namespace {
 
 constexpr int MaxOperands = 3;
 
+// capstone handles must not be used by more than one thread at a time, so
+// every thread which decodes gets handles of its own. These are the settings
+// they are opened with, and any change bumps configGeneration so that each
+// thread reopens its handles the next time it decodes something
+std::mutex configLock;
 Architecture capstoneArch = Architecture::ARCH_X86;
-bool capstoneInitialized  = false;
-csh csh                   = 0;
+std::atomic<bool> capstoneInitialized{false};
+std::atomic<unsigned int> configGeneration{0};
 Formatter activeFormatter;
 
+/**
+ * @brief open_handle
+ * @param arch
+ * @param handle
+ * @return
+ */
+cs_err open_handle(Architecture arch, csh *handle) {
+	switch (arch) {
+	case Architecture::ARCH_AMD64:
+		return cs_open(CS_ARCH_X86, CS_MODE_64, handle);
+	case Architecture::ARCH_X86:
+		return cs_open(CS_ARCH_X86, CS_MODE_32, handle);
+	case Architecture::ARCH_ARM32_ARM:
+		return cs_open(CS_ARCH_ARM, CS_MODE_ARM, handle);
+	case Architecture::ARCH_ARM32_THUMB:
+		return cs_open(CS_ARCH_ARM, CS_MODE_THUMB, handle);
+	case Architecture::ARCH_ARM64:
+		return cs_open(CS_ARCH_ARM64, CS_MODE_ARM, handle);
+	default:
+		return CS_ERR_ARCH;
+	}
+}
+
+/**
+ * @brief apply_options
+ * @param handle
+ * @param options
+ */
+void apply_options(csh handle, const Formatter::FormatOptions &options) {
+#if defined(EDB_X86) || defined(EDB_X86_64)
+	if (options.syntax == Formatter::SyntaxAtt) {
+		cs_option(handle, CS_OPT_SYNTAX, CS_OPT_SYNTAX_ATT);
+	} else {
+		cs_option(handle, CS_OPT_SYNTAX, CS_OPT_SYNTAX_INTEL);
+	}
+#elif defined(EDB_ARM32) // FIXME(ARM): does this apply to AArch64?
+	// TODO: make this optional. Don't forget to reflect this in register view!
+	(void)options;
+	cs_option(handle, CS_OPT_SYNTAX, CS_OPT_SYNTAX_NOREGNAME);
+#else
+	(void)handle;
+	(void)options;
+#endif
+}
+
+// the capstone handles owned by one thread, one with detail turned on and one
+// with it off for Instruction::Detail::FlowOnly
+struct ThreadDecoder {
+	~ThreadDecoder() {
+		close();
+	}
+
+	void close() {
+		if (full) {
+			cs_close(&full);
+			full = 0;
+		}
+
+		if (flowOnly) {
+			cs_close(&flowOnly);
+			flowOnly = 0;
+		}
+	}
+
+	csh full                         = 0;
+	csh flowOnly                     = 0;
+	unsigned int generation          = 0;
+	Architecture arch                = Architecture::ARCH_X86;
+	Formatter::FormatOptions options = {};
+};
+
+/**
+ * @brief thread_decoder
+ * @return the calling thread's capstone handles, opened with the current settings
+ */
+ThreadDecoder &thread_decoder() {
+
+	thread_local ThreadDecoder decoder;
+
+	if (decoder.generation != configGeneration.load(std::memory_order_acquire)) {
+		std::lock_guard<std::mutex> lock(configLock);
+
+		decoder.close();
+		decoder.arch       = capstoneArch;
+		decoder.options    = activeFormatter.options();
+		decoder.generation = configGeneration.load(std::memory_order_relaxed);
+
+		if (open_handle(decoder.arch, &decoder.full) == CS_ERR_OK) {
+			cs_option(decoder.full, CS_OPT_DETAIL, CS_OPT_ON);
+			apply_options(decoder.full, decoder.options);
+		} else {
+			decoder.full = 0;
+		}
+
+		if (open_handle(decoder.arch, &decoder.flowOnly) == CS_ERR_OK) {
+			apply_options(decoder.flowOnly, decoder.options);
+		} else {
+			decoder.flowOnly = 0;
+		}
+	}
+
+	return decoder;
+}
+
 #if defined(EDB_X86) || defined(EDB_X86_64)
 /**
  * @brief is_simd_register
@@ -118,7 +229,7 @@ std::size_t simdOperandNormalizedNumberInInstruction(const Instruction &insn, co
 	const size_t operandCount = insn.operandCount();
 
 	// normalized number is according to Intel order
-	if (activeFormatter.options().syntax == Formatter::SyntaxAtt) {
+	if (thread_decoder().options.syntax == Formatter::SyntaxAtt) {
 		assert(number < operandCount);
 		number = operandCount - 1 - number;
 	}
@@ -136,7 +247,7 @@ std::size_t simdOperandNormalizedNumberInInstruction(const Instruction &insn, co
  * @return
  */
 bool isX86_64() {
-	return capstoneArch == Architecture::ARCH_AMD64;
+	return thread_decoder().arch == Architecture::ARCH_AMD64;
 }
 
 /**
@@ -202,70 +313,76 @@ std::vector<std::string> to_operands(QString str) {
 
 bool init(Architecture arch) {
 
-	capstoneArch = arch;
+	std::lock_guard<std::mutex> lock(configLock);
 
-	if (capstoneInitialized) {
-		cs_close(&csh);
+	// the ARM core calls this on every stop to follow switches between ARM
+	// and Thumb, so don't make every thread reopen its handles for nothing
+	if (capstoneInitialized && capstoneArch == arch) {
+		return true;
 	}
 
+	capstoneArch        = arch;
 	capstoneInitialized = false;
+	configGeneration.fetch_add(1, std::memory_order_release);
 
-	const cs_err result = [arch]() {
-		switch (arch) {
-		case Architecture::ARCH_AMD64:
-			return cs_open(CS_ARCH_X86, CS_MODE_64, &csh);
-		case Architecture::ARCH_X86:
-			return cs_open(CS_ARCH_X86, CS_MODE_32, &csh);
-		case Architecture::ARCH_ARM32_ARM:
-			return cs_open(CS_ARCH_ARM, CS_MODE_ARM, &csh);
-		case Architecture::ARCH_ARM32_THUMB:
-			return cs_open(CS_ARCH_ARM, CS_MODE_THUMB, &csh);
-		case Architecture::ARCH_ARM64:
-			return cs_open(CS_ARCH_ARM64, CS_MODE_ARM, &csh);
-		default:
-			return CS_ERR_ARCH;
-		}
-	}();
-
-	if (result != CS_ERR_OK) {
+	// make sure that capstone supports this architecture before claiming
+	// success, the handles which are actually used are opened per thread
+	csh handle;
+	if (open_handle(arch, &handle) != CS_ERR_OK) {
 		return false;
 	}
 
+	cs_close(&handle);
 	capstoneInitialized = true;
-
-	cs_option(csh, CS_OPT_DETAIL, CS_OPT_ON);
-
-	// Set selected formatting options on reinit
-	activeFormatter.setOptions(activeFormatter.options());
 	return true;
 }
 
-Instruction::Instruction(Instruction &&other) noexcept
-	: insn_(other.insn_), byte0_(other.byte0_), rva_(other.rva_) {
-
-	other.insn_  = nullptr;
-	other.byte0_ = 0;
-	other.rva_   = 0;
+Instruction::Instruction(Instruction &&other) noexcept {
+	adopt(other);
+	other.insn_     = nullptr;
+	other.detailed_ = false;
+	other.byte0_    = 0;
+	other.rva_      = 0;
 }
 
 Instruction &Instruction::operator=(Instruction &&rhs) noexcept {
-	insn_      = rhs.insn_;
-	byte0_     = rhs.byte0_;
-	rva_       = rhs.rva_;
-	rhs.insn_  = nullptr;
-	rhs.byte0_ = 0;
-	rhs.rva_   = 0;
+	if (this != &rhs) {
+		adopt(rhs);
+		rhs.insn_     = nullptr;
+		rhs.detailed_ = false;
+		rhs.byte0_    = 0;
+		rhs.rva_      = 0;
+	}
 	return *this;
 }
 
-Instruction::~Instruction() {
-	if (insn_) {
-		cs_free(insn_, 1);
+/**
+ * copies the decoded instruction out of <other>, pointing the copy at our own
+ * storage rather than at <other>'s
+ *
+ * @brief Instruction::adopt
+ * @param other
+ */
+void Instruction::adopt(const Instruction &other) noexcept {
+	byte0_    = other.byte0_;
+	rva_      = other.rva_;
+	detailed_ = other.detailed_;
+	insn_     = nullptr;
+
+	if (other.insn_) {
+		storage_ = other.storage_;
+		if (other.detailed_) {
+			detail_         = other.detail_;
+			storage_.detail = &detail_;
+		} else {
+			storage_.detail = nullptr;
+		}
+		insn_ = &storage_;
 	}
 }
 
-Instruction::Instruction(const void *first, const void *last, uint64_t rva) noexcept
-	: rva_(rva) {
+Instruction::Instruction(const void *first, const void *last, uint64_t rva, Detail detail) noexcept
+	: detailed_(detail == Detail::Full), rva_(rva) {
 
 	assert(capstoneInitialized);
 	auto codeBegin = static_cast<const uint8_t *>(first);
@@ -273,24 +390,36 @@ Instruction::Instruction(const void *first, const void *last, uint64_t rva) noex
 
 	byte0_ = codeBegin[0];
 
-	cs_insn *insn = nullptr;
-	if (first < last && cs_disasm(csh, codeBegin, codeEnd - codeBegin, rva, 1, &insn)) {
-		insn_ = insn;
+	if (first >= last) {
+		return;
+	}
+
+	const ThreadDecoder &decoder = thread_decoder();
+	const csh handle             = detailed_ ? decoder.full : decoder.flowOnly;
+
+	// capstone fills in the detail through this pointer when it is turned
+	// on, and leaves it alone otherwise
+	storage_.detail = detailed_ ? &detail_ : nullptr;
+
+	const uint8_t *code = codeBegin;
+	size_t size         = static_cast<size_t>(codeEnd - codeBegin);
+	uint64_t address    = rva;
+
+	if (handle && cs_disasm_iter(handle, &code, &size, &address, &storage_)) {
+		insn_ = &storage_;
 #if defined(EDB_ARM32)
-		if (insn_->detail->arm.op_count >= 2) {
+		if (detailed_ && insn_->detail->arm.op_count >= 2) {
 			// XXX: this is a work around capstone bug #1013
 			auto &op = insn_->detail->arm.operands[1];
 			if (op.type == ARM_OP_MEM && op.subtracted && op.mem.scale == 1)
 				op.mem.scale = -1;
 		}
 #endif
-	} else {
-		insn_ = nullptr;
 	}
 }
 
 Operand Instruction::operator[](size_t n) const {
-	if (!valid())
+	if (!hasDetail())
 		return Operand();
 	if (n > operandCount())
 		return Operand();
@@ -305,7 +434,7 @@ Operand Instruction::operator[](size_t n) const {
 }
 
 Operand Instruction::operand(size_t n) const {
-	if (!valid())
+	if (!hasDetail())
 		return Operand();
 	if (n > operandCount())
 		return Operand();
@@ -321,6 +450,9 @@ Operand Instruction::operand(size_t n) const {
 
 Instruction::ConditionCode Instruction::conditionCode() const {
 
+	// the condition is read from the opcode, which needs the detail
+	assert(!insn_ || detailed_);
+
 #if defined(EDB_X86) || defined(EDB_X86_64)
 	switch (operation()) {
 	// J*CXZ
@@ -398,10 +530,11 @@ Instruction::ConditionCode Instruction::conditionCode() const {
 }
 
 void Instruction::swap(Instruction &other) {
-	using std::swap;
-	swap(insn_, other.insn_);
-	swap(byte0_, other.byte0_);
-	swap(rva_, other.rva_);
+	// the decoded data lives inside of the objects, so it has to be moved
+	// rather than just swapping the pointers to it
+	Instruction temp(std::move(other));
+	other = std::move(*this);
+	*this = std::move(temp);
 }
 
 QString Formatter::adjustInstructionText(const Instruction &insn) const {
@@ -416,7 +549,7 @@ QString Formatter::adjustInstructionText(const Instruction &insn) const {
 	operands.replace(QRegExp("(word|byte) ptr "), "\\1 ");
 
 #if defined(EDB_X86) || defined(EDB_X86_64)
-	if (activeFormatter.options().simplifyRIPRelativeTargets && isX86_64() && (insn->detail->x86.modrm & 0xc7) == 0x05) {
+	if (thread_decoder().options.simplifyRIPRelativeTargets && isX86_64() && (insn->detail->x86.modrm & 0xc7) == 0x05) {
 		QRegExp ripRel("\\brip ?[+-] ?((0x)?[0-9a-fA-F]+)\\b");
 		operands.replace(ripRel, "rel 0x" + QString::number(insn->detail->x86.disp + insn->address + insn->size, 16));
 	}
@@ -434,18 +567,11 @@ void Formatter::setOptions(const Formatter::FormatOptions &options) {
 
 	options_ = options;
 
-#if defined(EDB_X86) || defined(EDB_X86_64)
-	if (options.syntax == SyntaxAtt) {
-		cs_option(csh, CS_OPT_SYNTAX, CS_OPT_SYNTAX_ATT);
-	} else {
-		cs_option(csh, CS_OPT_SYNTAX, CS_OPT_SYNTAX_INTEL);
-	}
-#elif defined(EDB_ARM32) // FIXME(ARM): does this apply to AArch64?
-	// TODO: make this optional. Don't forget to reflect this in register view!
-	cs_option(csh, CS_OPT_SYNTAX, CS_OPT_SYNTAX_NOREGNAME);
-#endif
-
+	// the syntax is a property of the capstone handles, so have every thread
+	// reopen its handles with the new options
+	std::lock_guard<std::mutex> lock(configLock);
 	activeFormatter = *this;
+	configGeneration.fetch_add(1, std::memory_order_release);
 }
 
 std::string Formatter::toString(const Instruction &insn) const {
@@ -544,7 +670,7 @@ std::string Formatter::toString(const Operand &operand) const {
 
 std::string Formatter::registerName(unsigned int reg) const {
 	assert(capstoneInitialized);
-	const char *raw = cs_reg_name(csh, reg);
+	const char *raw = cs_reg_name(thread_decoder().full, reg);
 	if (!raw)
 		return "(invalid register)";
 	std::string str(raw);
@@ -1166,17 +1292,55 @@ bool is_SIMD_USI(const Operand &operand) {
 
 bool is_return(const Instruction &insn) {
 	if (!insn) return false;
-	return cs_insn_group(csh, insn.native(), CS_GRP_RET);
+	if (!insn.hasDetail()) {
+#if defined(EDB_X86) || defined(EDB_X86_64)
+		switch (insn.operation()) {
+		case X86_INS_RET:
+		case X86_INS_RETF:
+		case X86_INS_RETFQ:
+		case X86_INS_IRET:
+		case X86_INS_IRETD:
+		case X86_INS_IRETQ:
+			return true;
+		default:
+			return false;
+		}
+#else
+		return false;
+#endif
+	}
+	return cs_insn_group(thread_decoder().full, insn.native(), CS_GRP_RET);
 }
 
 bool is_jump(const Instruction &insn) {
 	if (!insn) return false;
-	return cs_insn_group(csh, insn.native(), CS_GRP_JUMP);
+	if (!insn.hasDetail()) {
+#if defined(EDB_X86) || defined(EDB_X86_64)
+		switch (insn.operation()) {
+		case X86_INS_LOOP:
+		case X86_INS_LOOPE:
+		case X86_INS_LOOPNE:
+			return true;
+		default:
+			return is_unconditional_jump(insn) || is_conditional_jump(insn);
+		}
+#else
+		return false;
+#endif
+	}
+	return cs_insn_group(thread_decoder().full, insn.native(), CS_GRP_JUMP);
 }
 
 bool is_call(const Instruction &insn) {
 	if (!insn) return false;
-	return cs_insn_group(csh, insn.native(), CS_GRP_CALL);
+	if (!insn.hasDetail()) {
+#if defined(EDB_X86) || defined(EDB_X86_64)
+		return insn.operation() == X86_INS_CALL || insn.operation() == X86_INS_LCALL;
+#else
+		return false;
+#endif
+	}
+	return cs_insn_group(thread_decoder().full, insn.native(), CS_GRP_CALL);
 }
 
 bool modifies_pc(const Instruction &insn) {
@@ -1185,6 +1349,9 @@ bool modifies_pc(const Instruction &insn) {
 #if defined(EDB_X86) || defined(EDB_X86_64)
 	return false;
 #elif defined(EDB_ARM32)
+	if (!insn.hasDetail())
+		return false;
+
 	const auto &detail = *insn->detail;
 	for (uint8_t i = 0; i < detail.regs_write_count; ++i)
 		if (detail.regs_write[i] == ARM_REG_PC)
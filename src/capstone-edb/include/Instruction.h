@@ -54,18 +54,32 @@ public:
 #endif
 
 public:
-	Instruction(const void *first, const void *end, uint64_t rva) noexcept;
+	// how much of the instruction to decode. FlowOnly decodes only the
+	// length and the instruction id, that is enough to walk instruction
+	// boundaries and to tell calls, jumps and returns apart, and is a lot
+	// cheaper than a full decode. Operands are not available in this mode.
+	enum class Detail {
+		Full,
+		FlowOnly
+	};
+
+public:
+	Instruction(const void *first, const void *end, uint64_t rva, Detail detail = Detail::Full) noexcept;
 	Instruction(const Instruction &) = delete;
 	Instruction &operator=(const Instruction &) = delete;
 	Instruction(Instruction &&) noexcept;
 	Instruction &operator=(Instruction &&) noexcept;
-	~Instruction();
+	~Instruction() = default;
 
 public:
 	bool valid() const {
 		return insn_;
 	}
 
+	bool hasDetail() const {
+		return insn_ && detailed_;
+	}
+
 	explicit operator bool() const {
 		return valid();
 	}
@@ -74,9 +88,9 @@ public:
 	int operation() const { return insn_ ? insn_->id : 0; }
 	std::size_t operandCount() const {
 #if defined(EDB_X86) || defined(EDB_X86_64)
-		return insn_ ? insn_->detail->x86.op_count : 0;
+		return hasDetail() ? insn_->detail->x86.op_count : 0;
 #elif defined(EDB_ARM32) || defined(EDB_ARM64)
-		return insn_ ? insn_->detail->arm.op_count : 0;
+		return hasDetail() ? insn_->detail->arm.op_count : 0;
 #else
 #error "What to return here?"
 #endif
@@ -161,7 +175,15 @@ public:
 	ConditionCode conditionCode() const;
 
 private:
+	void adopt(const Instruction &other) noexcept;
+
+private:
+	// the decoder writes straight into this storage, so decoding doesn't
+	// allocate. insn_ points at storage_ if the decode succeeded
 	cs_insn *insn_ = nullptr;
+	cs_insn storage_;
+	cs_detail detail_;
+	bool detailed_ = false;
 
 	// we have our own copies of this data so we can give something meaningful
 	// even during a failed disassembly
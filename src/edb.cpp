@@ -17,8 +17,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "edb.h"
+#include "AnnotationCache.h"
 #include "ArchProcessor.h"
 #include "BinaryString.h"
+#include "CompiledExpression.h"
 #include "Configuration.h"
 #include "DebugEventHandlers.h"
 #include "Debugger.h"
@@ -28,17 +30,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "DialogOptions.h"
 #include "Expression.h"
 #include "ExpressionDialog.h"
+#include "FileChecksums.h"
 #include "IBreakpoint.h"
 #include "IDebugger.h"
 #include "IPlugin.h"
 #include "IProcess.h"
 #include "IRegion.h"
 #include "IThread.h"
+#include "InstructionCache.h"
+#include "InstructionIndex.h"
 #include "MemoryRegions.h"
+#include "MemorySearch.h"
 #include "Prototype.h"
 #include "QHexView"
 #include "QtHelper.h"
 #include "State.h"
+#include "StringExtractor.h"
 #include "Symbol.h"
 #include "SymbolManager.h"
 #include "version.h"
@@ -56,6 +63,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QDebug>
 #include <cctype>
+#include <map>
 
 IDebugger *edb::v1::debugger_core = nullptr;
 QWidget *edb::v1::debugger_ui     = nullptr;
@@ -76,10 +84,29 @@ CapstoneEDB::Formatter g_Formatter;
 
 QHash<QString, edb::Prototype> g_FunctionDB;
 
+// the parser found for a region (or nullptr if none claimed it). the region is
+// only held weakly so that a negative entry can't outlive its region and match
+// a new one which happens to be allocated at the same address
+struct BinaryInfoEntry {
+	std::weak_ptr<IRegion> region;
+	std::shared_ptr<IBinary> binary;
+};
+
+// like g_BinaryInfoList, this is only touched from the GUI thread
+QHash<const IRegion *, BinaryInfoEntry> g_BinaryInfoCache;
+
+// the ranges edb has written to since attaching, keyed by their start
+std::map<edb::address_t, edb::address_t> g_ModifiedRanges;
+
 Debugger *ui() {
 	return qobject_cast<Debugger *>(edb::v1::debugger_ui);
 }
 
+FileChecksums &file_checksums() {
+	static FileChecksums checksums;
+	return checksums;
+}
+
 bool function_symbol_base(edb::address_t address, QString *value, int *offset) {
 
 	Q_ASSERT(value);
@@ -218,6 +245,42 @@ ArchProcessor &arch_processor() {
 	return g_ArchProcessor;
 }
 
+//------------------------------------------------------------------------------
+// Name: instruction_cache
+// Desc:
+//------------------------------------------------------------------------------
+InstructionCache &instruction_cache() {
+	static InstructionCache g_InstructionCache;
+	return g_InstructionCache;
+}
+
+//------------------------------------------------------------------------------
+// Name: instruction_index
+// Desc:
+//------------------------------------------------------------------------------
+InstructionIndex &instruction_index() {
+	static InstructionIndex g_InstructionIndex;
+
+	// regions which are no longer mapped take their indexes with them
+	static const QMetaObject::Connection connection = QObject::connect(&memory_regions(), &MemoryRegions::regionsChanged, [](const QList<std::shared_ptr<IRegion>> &, const QList<std::shared_ptr<IRegion>> &removed) {
+		for (const std::shared_ptr<IRegion> &r : removed) {
+			g_InstructionIndex.remove(r->start());
+		}
+	});
+
+	Q_UNUSED(connection)
+	return g_InstructionIndex;
+}
+
+//------------------------------------------------------------------------------
+// Name: annotation_cache
+// Desc:
+//------------------------------------------------------------------------------
+AnnotationCache &annotation_cache() {
+	static AnnotationCache g_AnnotationCache;
+	return g_AnnotationCache;
+}
+
 //------------------------------------------------------------------------------
 // Name: set_analyzer
 // Desc:
@@ -337,6 +400,13 @@ void set_breakpoint_condition(address_t address, const QString &condition) {
 
 	if (std::shared_ptr<IBreakpoint> bp = find_breakpoint(address)) {
 		bp->condition = condition;
+
+		// some breakpoint types evaluate the condition in the debuggee, so
+		// they need to be rewritten to pick up the new one
+		if (bp->enabled()) {
+			bp->disable();
+			bp->enable();
+		}
 	}
 }
 
@@ -377,7 +447,7 @@ std::shared_ptr<IBreakpoint> create_breakpoint(address_t address) {
 		} else {
 			uint8_t buffer[Instruction::MaxSize + 1];
 			if (const int size = get_instruction_bytes(address, buffer)) {
-				Instruction inst(buffer, buffer + size, address);
+				Instruction inst(buffer, buffer + size, address, Instruction::Detail::FlowOnly);
 				if (!inst) {
 					ret = QMessageBox::question(
 						nullptr,
@@ -618,31 +688,21 @@ bool get_ascii_string_at_address(address_t address, QString &s, int min_length,
 		if (IProcess *process = debugger_core->process()) {
 			s.clear();
 
+			int length = 0;
+			QByteArray bytes;
+
 			if (min_length <= max_length) {
-				while (max_length--) {
-					char ch;
-					if (!process->readBytes(address++, &ch, sizeof(ch))) {
-						break;
-					}
-
-					const int ascii_char = static_cast<unsigned char>(ch);
-					if (ascii_char < 0x80 && (std::isprint(ascii_char) || std::isspace(ascii_char))) {
-						s += ch;
-					} else {
-						break;
-					}
-				}
+				bytes.resize(max_length);
+
+				const std::size_t n = process->readBytes(address, bytes.data(), bytes.size());
+				length              = static_cast<int>(StringExtractor::asciiLength(reinterpret_cast<const uint8_t *>(bytes.constData()), n));
 			}
 
-			is_string = s.length() >= min_length;
+			is_string = length >= min_length;
 
 			if (is_string) {
-				found_length = s.length();
-				s.replace("\r", "\\r");
-				s.replace("\n", "\\n");
-				s.replace("\t", "\\t");
-				s.replace("\v", "\\v");
-				s.replace("\"", "\\\"");
+				found_length = length;
+				s            = StringExtractor::toString(reinterpret_cast<const uint8_t *>(bytes.constData()), length, StringExtractor::Encoding::Ascii);
 			}
 		}
 	}
@@ -665,37 +725,21 @@ bool get_utf16_string_at_address(address_t address, QString &s, int min_length,
 		if (IProcess *process = debugger_core->process()) {
 			s.clear();
 
-			if (min_length <= max_length) {
-				while (max_length--) {
-
-					uint16_t val;
-					if (!process->readBytes(address, &val, sizeof(val))) {
-						break;
-					}
-
-					address += sizeof(val);
+			int length = 0;
+			QByteArray bytes;
 
-					QChar ch(val);
+			if (min_length <= max_length) {
+				bytes.resize(max_length * static_cast<int>(sizeof(uint16_t)));
 
-					// for now, we only acknowledge ASCII chars encoded as unicode
-					const int ascii_char = ch.toLatin1();
-					if (ascii_char >= 0x20 && ascii_char < 0x80) {
-						s += ch;
-					} else {
-						break;
-					}
-				}
+				const std::size_t n = process->readBytes(address, bytes.data(), bytes.size());
+				length              = static_cast<int>(StringExtractor::utf16Length(reinterpret_cast<const uint8_t *>(bytes.constData()), n / sizeof(uint16_t)));
 			}
 
-			is_string = s.length() >= min_length;
+			is_string = length >= min_length;
 
 			if (is_string) {
-				found_length = s.length();
-				s.replace("\r", "\\r");
-				s.replace("\n", "\\n");
-				s.replace("\t", "\\t");
-				s.replace("\v", "\\v");
-				s.replace("\"", "\\\"");
+				found_length = length;
+				s            = StringExtractor::toString(reinterpret_cast<const uint8_t *>(bytes.constData()), length, StringExtractor::Encoding::Utf16);
 			}
 		}
 	}
@@ -857,19 +901,47 @@ bool get_instruction_bytes(address_t address, uint8_t *buf, size_t *size) {
 // Name: get_binary_info
 // Desc: gets an object which knows how to analyze the binary file provided
 //       or NULL if none-found.
-// Note: the caller is responsible for deleting the object!
+// Note: the parsers are cached per region, MemoryRegions keeps the same region
+//       object for as long as its mapping is unchanged, so this is cheap enough
+//       to call on every paint. Like the other binary info functions, this may
+//       only be called from the GUI thread
 //------------------------------------------------------------------------------
-std::unique_ptr<IBinary> get_binary_info(const std::shared_ptr<IRegion> &region) {
+std::shared_ptr<IBinary> get_binary_info(const std::shared_ptr<IRegion> &region) {
+
+	if (!region) {
+		return nullptr;
+	}
+
+	// regions which are no longer mapped take their parsers with them
+	static const QMetaObject::Connection connection = QObject::connect(&memory_regions(), &MemoryRegions::regionsChanged, [](const QList<std::shared_ptr<IRegion>> &, const QList<std::shared_ptr<IRegion>> &removed) {
+		for (const std::shared_ptr<IRegion> &r : removed) {
+			g_BinaryInfoCache.remove(r.get());
+		}
+	});
+
+	Q_UNUSED(connection)
+
+	auto it = g_BinaryInfoCache.find(region.get());
+	if (it != g_BinaryInfoCache.end()) {
+		if (it->region.lock() == region) {
+			return it->binary;
+		}
+
+		g_BinaryInfoCache.erase(it);
+	}
+
+	std::shared_ptr<IBinary> binary;
+
 	Q_FOREACH (IBinary::create_func_ptr_t f, g_BinaryInfoList) {
 		try {
-			std::unique_ptr<IBinary> p((*f)(region));
+			binary = (*f)(region);
 			// reorder the list to put this successful plugin
 			// in front.
 			if (g_BinaryInfoList[0] != f) {
 				g_BinaryInfoList.removeOne(f);
 				g_BinaryInfoList.push_front(f);
 			}
-			return p;
+			break;
 
 		} catch (const std::exception &) {
 			// let's just ignore it...
@@ -877,10 +949,39 @@ std::unique_ptr<IBinary> get_binary_info(const std::shared_ptr<IRegion> &region)
 	}
 
 #if 0
-	qDebug() << "Failed to find any binary parser for region"
-		<< QString::number(region->start(), 16);
+	if (!binary) {
+		qDebug() << "Failed to find any binary parser for region"
+			<< QString::number(region->start(), 16);
+	}
 #endif
-	return nullptr;
+
+	g_BinaryInfoCache.insert(region.get(), {region, binary});
+	return binary;
+}
+
+//------------------------------------------------------------------------------
+// Name: invalidate_binary_info
+// Desc: forgets the parsers of the regions overlapping [address, address + size)
+//       so that patched headers get parsed again
+//------------------------------------------------------------------------------
+void invalidate_binary_info(address_t address, std::size_t size) {
+
+	for (auto it = g_BinaryInfoCache.begin(); it != g_BinaryInfoCache.end();) {
+		const std::shared_ptr<IRegion> region = it->region.lock();
+		if (!region || (address < region->end() && address + size > region->start())) {
+			it = g_BinaryInfoCache.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: clear_binary_info
+// Desc: forgets all cached parsers
+//------------------------------------------------------------------------------
+void clear_binary_info() {
+	g_BinaryInfoCache.clear();
 }
 
 //------------------------------------------------------------------------------
@@ -1099,6 +1200,7 @@ bool modify_bytes(address_t address, size_t size, QByteArray &bytes, uint8_t fil
 			}
 
 			process->writeBytes(address, bytes.data(), size);
+			bytes_modified(address, size);
 
 			// do a refresh, not full update
 			Debugger *const gui = ui();
@@ -1110,6 +1212,54 @@ bool modify_bytes(address_t address, size_t size, QByteArray &bytes, uint8_t fil
 	return true;
 }
 
+//------------------------------------------------------------------------------
+// Name: mark_modified
+// Desc: records that edb has written <size> bytes to <address>
+//------------------------------------------------------------------------------
+void mark_modified(address_t address, size_t size) {
+	if (size != 0) {
+		address_t &end = g_ModifiedRanges[address];
+		end            = std::max<address_t>(end, address + size);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: bytes_modified
+// Desc: to be called after edb has written <size> bytes to <address>, records
+//       the write and forgets everything cached about what used to be there
+//------------------------------------------------------------------------------
+void bytes_modified(address_t address, size_t size) {
+	mark_modified(address, size);
+	instruction_cache().invalidate(address, size);
+	instruction_index().invalidate(address, size);
+	invalidate_binary_info(address, size);
+	annotation_cache().invalidate();
+}
+
+//------------------------------------------------------------------------------
+// Name: was_modified
+// Desc: returns true if edb has written to any of the range [start, end) since
+//       attaching, so that what is there no longer matches the file it was
+//       mapped from
+//------------------------------------------------------------------------------
+bool was_modified(address_t start, address_t end) {
+	for (auto it = g_ModifiedRanges.begin(); it != g_ModifiedRanges.end() && it->first < end; ++it) {
+		if (it->second > start) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//------------------------------------------------------------------------------
+// Name: clear_modified
+// Desc:
+//------------------------------------------------------------------------------
+void clear_modified() {
+	g_ModifiedRanges.clear();
+}
+
 //------------------------------------------------------------------------------
 // Name: get_md5
 // Desc:
@@ -1129,21 +1279,21 @@ QByteArray get_md5(const void *p, size_t n) {
 
 //------------------------------------------------------------------------------
 // Name: get_file_md5
-// Desc: returns a byte array representing the MD5 of a file
+// Desc: returns a byte array representing the MD5 of a file, files which
+//       haven't changed since the last time are not read again
 //------------------------------------------------------------------------------
 QByteArray get_file_md5(const QString &s) {
+	return file_checksums().md5(s, config().symbol_path);
+}
 
-	QFile file(s);
-	file.open(QIODevice::ReadOnly);
-	if (file.isOpen()) {
-		if (file.size() != 0) {
-			QCryptographicHash hasher(QCryptographicHash::Md5);
-			hasher.addData(file.readAll());
-			return hasher.result();
-		}
-	}
-
-	return QByteArray();
+//------------------------------------------------------------------------------
+// Name: get_symbol_md5
+// Desc: returns the MD5 which symbol files for a binary are checked against.
+//       This is the MD5 of the file, except that a file which changed but
+//       kept its build id keeps the MD5 it had before
+//------------------------------------------------------------------------------
+QByteArray get_symbol_md5(const QString &s) {
+	return file_checksums().buildMd5(s, config().symbol_path);
 }
 
 //------------------------------------------------------------------------------
@@ -1368,6 +1518,37 @@ QAbstractScrollArea *disassembly_widget() {
 	return ui()->ui.cpuView;
 }
 
+//------------------------------------------------------------------------------
+// Name: find_pattern
+// Desc: returns the address of every match of <pattern> in <regions>
+//------------------------------------------------------------------------------
+QVector<address_t> find_pattern(const BytePattern &pattern, const QList<std::shared_ptr<IRegion>> &regions) {
+
+	QVector<address_t> results;
+
+	MemorySearch search(pattern);
+	search.run(regions, [&results](const QVector<address_t> &matches) {
+		results += matches;
+	});
+
+	return results;
+}
+
+//------------------------------------------------------------------------------
+// Name: find_pattern
+// Desc: compiles <pattern> and returns the address of every match of it in
+//       <regions>, see BytePattern.h for the syntax
+//------------------------------------------------------------------------------
+Result<QVector<address_t>, QString> find_pattern(const QString &pattern, const QList<std::shared_ptr<IRegion>> &regions) {
+
+	const Result<BytePattern, QString> compiled = BytePattern::compile(pattern);
+	if (!compiled) {
+		return make_unexpected(compiled.error());
+	}
+
+	return find_pattern(*compiled, regions);
+}
+
 //------------------------------------------------------------------------------
 // Name: read_pages
 // Desc:
@@ -1498,6 +1679,85 @@ std::optional<edb::address_t> eval_expression(const QString &expression) {
 	}
 }
 
+//------------------------------------------------------------------------------
+// Name: compile_expression
+// Desc: compiles an expression for repeated evaluation against the current
+//       thread. Names are resolved the same way get_variable does, but only
+//       once, so symbols become constants and registers become slots in the
+//       State the expression is later evaluated against.
+//------------------------------------------------------------------------------
+Result<CompiledExpression, ExpressionError> compile_expression(const QString &expression) {
+
+	IProcess *process = v1::debugger_core ? v1::debugger_core->process() : nullptr;
+	if (!process) {
+		return make_unexpected(ExpressionError(ExpressionError::UnknownVariable));
+	}
+
+	std::shared_ptr<IThread> thread = process->currentThread();
+	if (!thread) {
+		return make_unexpected(ExpressionError(ExpressionError::UnknownVariable));
+	}
+
+	State state;
+	thread->getState(&state);
+
+	return CompiledExpression::compile(expression, [&state](const QString &name, ExpressionError *error) -> std::optional<CompiledExpression::Variable> {
+		CompiledExpression::Variable variable;
+
+		const Register reg = state.value(name);
+		if (!reg) {
+			if (const std::shared_ptr<Symbol> sym = v1::symbol_manager().find(name)) {
+				variable.kind  = CompiledExpression::Variable::Constant;
+				variable.value = sym->address;
+				return variable;
+			}
+
+			*error = ExpressionError(ExpressionError::UnknownVariable);
+			return {};
+		}
+
+		// NOTE(eteran): to match get_variable, segment registers which have
+		// a base evaluate to that base rather than to the selector
+		if (reg.name() == "fs" || reg.name() == "gs") {
+			variable.kind = CompiledExpression::Variable::NamedRegister;
+			variable.name = reg.name() + "_base";
+			return variable;
+		}
+
+		if (reg.bitSize() > 8 * sizeof(edb::address_t)) {
+			*error = ExpressionError(ExpressionError::UnknownVariable);
+			return {};
+		}
+
+		if (reg.name() == state.instructionPointerRegister().name()) {
+			variable.kind = CompiledExpression::Variable::InstructionPointer;
+			return variable;
+		}
+
+		if (reg.name() == state.flagsRegister().name()) {
+			variable.kind = CompiledExpression::Variable::Flags;
+			return variable;
+		}
+
+		for (size_t n = 0;; ++n) {
+			const Register gpr = state.gpRegister(n);
+			if (!gpr) {
+				break;
+			}
+
+			if (gpr.name() == reg.name()) {
+				variable.kind  = CompiledExpression::Variable::GpRegister;
+				variable.value = n;
+				return variable;
+			}
+		}
+
+		variable.kind = CompiledExpression::Variable::NamedRegister;
+		variable.name = reg.name();
+		return variable;
+	});
+}
+
 //------------------------------------------------------------------------------
 // Name: get_expression_from_user
 // Desc:
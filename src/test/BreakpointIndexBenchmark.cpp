@@ -0,0 +1,102 @@
+
+#include "BreakpointIndex.h"
+#include "FakeBreakpoint.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+#define TEST(expr)                                                  \
+	do {                                                            \
+		if (!(expr)) {                                              \
+			fprintf(stderr, "FAILED: [@%d] %s\n", __LINE__, #expr); \
+			abort();                                                \
+		}                                                           \
+	} while (0)
+
+namespace {
+
+constexpr size_t BreakpointCount   = 10000;
+constexpr size_t ReadCount         = 20000;
+constexpr size_t MaxBreakpointSize = 2;
+constexpr uint64_t TextBase        = 0x400000;
+constexpr uint64_t TextSize        = 0x1000000;
+
+template <class F>
+double timeIt(F func) {
+	const auto start = std::chrono::steady_clock::now();
+	func();
+	const auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void benchmarkRestore() {
+	std::mt19937_64 rng(1234);
+	std::uniform_int_distribution<uint64_t> addressDist(TextBase, TextBase + TextSize - 1);
+	std::uniform_int_distribution<size_t> sizeDist(1, MaxBreakpointSize);
+	std::uniform_int_distribution<size_t> lengthDist(16, 4096);
+
+	std::vector<std::unique_ptr<FakeBreakpoint>> breakpoints;
+	DebuggerCorePlugin::BreakpointIndex index(MaxBreakpointSize);
+
+	// like the real thing, there is at most one breakpoint per address
+	std::vector<uint64_t> addresses;
+	while (addresses.size() < BreakpointCount) {
+		const uint64_t address = addressDist(rng);
+		if (std::find(addresses.begin(), addresses.end(), address) == addresses.end()) {
+			addresses.push_back(address);
+		}
+	}
+
+	for (uint64_t address : addresses) {
+		breakpoints.push_back(std::make_unique<FakeBreakpoint>(address, sizeDist(rng)));
+		index.insert(breakpoints.back().get());
+	}
+
+	TEST(index.size() == BreakpointCount);
+
+	struct Read {
+		edb::address_t address;
+		size_t len;
+	};
+
+	std::vector<Read> reads;
+	for (size_t i = 0; i < ReadCount; ++i) {
+		reads.push_back(Read{addressDist(rng), lengthDist(rng)});
+	}
+
+	std::vector<uint8_t> expected(4096);
+	std::vector<uint8_t> actual(4096);
+
+	// make sure that both approaches agree
+	for (const Read &read : reads) {
+		std::fill(expected.begin(), expected.end(), 0);
+		std::fill(actual.begin(), actual.end(), 0);
+		restoreLinear(breakpoints, read.address, expected.data(), read.len);
+		index.restoreOriginalBytes(read.address, actual.data(), read.len);
+		TEST(expected == actual);
+	}
+
+	const double linearTime = timeIt([&]() {
+		for (const Read &read : reads) {
+			restoreLinear(breakpoints, read.address, expected.data(), read.len);
+		}
+	});
+
+	const double indexTime = timeIt([&]() {
+		for (const Read &read : reads) {
+			index.restoreOriginalBytes(read.address, actual.data(), read.len);
+		}
+	});
+
+	printf("%zu reads with %zu breakpoints: linear %.3f ms, index %.3f ms\n", ReadCount, BreakpointCount, linearTime, indexTime);
+}
+
+}
+
+int main() {
+	benchmarkRestore();
+}
@@ -0,0 +1,118 @@
+#include "BreakpointIndex.h"
+#include "FakeBreakpoint.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#define TEST(expr)                                                  \
+	do {                                                            \
+		if (!(expr)) {                                              \
+			fprintf(stderr, "FAILED: [@%d] %s\n", __LINE__, #expr); \
+			abort();                                                \
+		}                                                           \
+	} while (0)
+
+namespace {
+
+constexpr size_t BreakpointCount   = 1000;
+constexpr size_t ReadCount         = 2000;
+constexpr size_t MaxBreakpointSize = 2;
+constexpr uint64_t TextBase        = 0x400000;
+constexpr uint64_t TextSize        = 0x100000;
+
+void testEdges() {
+	DebuggerCorePlugin::BreakpointIndex index(MaxBreakpointSize);
+
+	FakeBreakpoint bp1(0x1000, 2);
+	FakeBreakpoint bp2(0x1010, 1);
+	FakeBreakpoint bp3(0, 2);
+	index.insert(&bp1);
+	index.insert(&bp2);
+	index.insert(&bp3);
+	TEST(index.size() == 3);
+
+	// a read starting in the middle of a breakpoint still sees its tail
+	uint8_t buf[4] = {};
+	index.restoreOriginalBytes(0x1001, buf, sizeof(buf));
+	TEST(buf[0] == bp1.originalBytes()[1]);
+	TEST(buf[1] == 0);
+
+	// a read ending right before a breakpoint doesn't see it
+	std::memset(buf, 0, sizeof(buf));
+	index.restoreOriginalBytes(0x100c, buf, sizeof(buf));
+	TEST(std::memcmp(buf, "\0\0\0\0", sizeof(buf)) == 0);
+
+	// no underflow at the bottom of the address space
+	std::memset(buf, 0, sizeof(buf));
+	index.restoreOriginalBytes(0, buf, sizeof(buf));
+	TEST(buf[1] == bp3.originalBytes()[1]);
+
+	index.remove(0x1000);
+	TEST(index.size() == 2);
+
+	std::memset(buf, 0, sizeof(buf));
+	index.restoreOriginalBytes(0x1000, buf, sizeof(buf));
+	TEST(std::memcmp(buf, "\0\0\0\0", sizeof(buf)) == 0);
+
+	index.clear();
+	TEST(index.empty());
+}
+
+void testAgainstLinear() {
+	std::mt19937_64 rng(1234);
+	std::uniform_int_distribution<uint64_t> addressDist(TextBase, TextBase + TextSize - 1);
+	std::uniform_int_distribution<size_t> sizeDist(1, MaxBreakpointSize);
+	std::uniform_int_distribution<size_t> lengthDist(16, 4096);
+
+	std::vector<std::unique_ptr<FakeBreakpoint>> breakpoints;
+	DebuggerCorePlugin::BreakpointIndex index(MaxBreakpointSize);
+
+	// like the real thing, there is at most one breakpoint per address
+	std::vector<uint64_t> addresses;
+	while (addresses.size() < BreakpointCount) {
+		const uint64_t address = addressDist(rng);
+		if (std::find(addresses.begin(), addresses.end(), address) == addresses.end()) {
+			addresses.push_back(address);
+		}
+	}
+
+	for (uint64_t address : addresses) {
+		breakpoints.push_back(std::make_unique<FakeBreakpoint>(address, sizeDist(rng)));
+		index.insert(breakpoints.back().get());
+	}
+
+	TEST(index.size() == BreakpointCount);
+
+	struct Read {
+		edb::address_t address;
+		size_t len;
+	};
+
+	std::vector<Read> reads;
+	for (size_t i = 0; i < ReadCount; ++i) {
+		reads.push_back(Read{addressDist(rng), lengthDist(rng)});
+	}
+
+	std::vector<uint8_t> expected(4096);
+	std::vector<uint8_t> actual(4096);
+
+	// make sure that both approaches agree
+	for (const Read &read : reads) {
+		std::fill(expected.begin(), expected.end(), 0);
+		std::fill(actual.begin(), actual.end(), 0);
+		restoreLinear(breakpoints, read.address, expected.data(), read.len);
+		index.restoreOriginalBytes(read.address, actual.data(), read.len);
+		TEST(expected == actual);
+	}
+}
+
+}
+
+int main() {
+	testEdges();
+	testAgainstLinear();
+}
@@ -0,0 +1,78 @@
+
+#include "BytePattern.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define TEST(expr)                                                  \
+	do {                                                            \
+		if (!(expr)) {                                              \
+			fprintf(stderr, "FAILED: [@%d] %s\n", __LINE__, #expr); \
+			abort();                                                \
+		}                                                           \
+	} while (0)
+
+namespace {
+
+std::vector<size_t> findAll(const BytePattern &pattern, const std::vector<uint8_t> &data) {
+	std::vector<size_t> offsets;
+
+	const uint8_t *const first = data.data();
+	const uint8_t *const last  = data.data() + data.size();
+	const uint8_t *p           = first;
+
+	while ((p = pattern.find(p, last)) != last) {
+		offsets.push_back(static_cast<size_t>(p - first));
+		++p;
+	}
+
+	return offsets;
+}
+
+void testSyntax() {
+	TEST(BytePattern::compile("48 8B ?? ? 00 00 E8")->size() == 7);
+	TEST(BytePattern::compile("488B")->size() == 2);
+	TEST(BytePattern::compile("(48|49 | 4C) 8B")->size() == 2);
+
+	TEST(!BytePattern::compile(""));
+	TEST(!BytePattern::compile("48 8"));
+	TEST(!BytePattern::compile("48 zz"));
+	TEST(!BytePattern::compile("(48|49"));
+	TEST(!BytePattern::compile("(48|)"));
+}
+
+void testMatching() {
+	const BytePattern pattern = *BytePattern::compile("4? (8B|89) ?5");
+
+	const uint8_t a[] = {0x4c, 0x8b, 0x05};
+	const uint8_t b[] = {0x48, 0x89, 0xf5};
+	const uint8_t c[] = {0x58, 0x8b, 0x05};
+	const uint8_t d[] = {0x48, 0x8a, 0x05};
+	const uint8_t e[] = {0x48, 0x8b, 0x06};
+
+	TEST(pattern.matches(a));
+	TEST(pattern.matches(b));
+	TEST(!pattern.matches(c));
+	TEST(!pattern.matches(d));
+	TEST(!pattern.matches(e));
+}
+
+void testFind() {
+	const std::vector<uint8_t> data = {0x00, 0xe8, 0x00, 0x00, 0x00, 0x00, 0xe8, 0x01, 0x02, 0x03, 0x04, 0xe8};
+
+	// a match must fit entirely in the buffer
+	TEST((findAll(*BytePattern::compile("E8 ?? ?? ?? ??"), data) == std::vector<size_t>{1, 6}));
+	TEST((findAll(*BytePattern::compile("00 00"), data) == std::vector<size_t>{2, 3, 4}));
+	TEST((findAll(*BytePattern::compile("?? E8"), data) == std::vector<size_t>{0, 5, 10}));
+	TEST((findAll(BytePattern::fromBytes(QByteArray("\x01\x02", 2)), data) == std::vector<size_t>{7}));
+	TEST(findAll(BytePattern::fromBytes(QByteArray("\x04\xe8\x00", 3)), data).empty());
+}
+
+}
+
+int main() {
+	testSyntax();
+	testMatching();
+	testFind();
+}
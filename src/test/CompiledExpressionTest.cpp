@@ -0,0 +1,264 @@
+
+#include "CompiledExpression.h"
+#include "Expression.h"
+#include "State.h"
+#include <cstdio>
+#include <cstdlib>
+
+#define TEST(expr)                                                  \
+	do {                                                            \
+		if (!(expr)) {                                              \
+			fprintf(stderr, "FAILED: [@%d] %s\n", __LINE__, #expr); \
+			abort();                                                \
+		}                                                           \
+	} while (0)
+
+namespace {
+
+edb::address_t getVariable(const QString &name, bool *ok, ExpressionError *error) {
+	*ok = true;
+	if (name == "a") {
+		return 0x1000;
+	} else if (name == "b") {
+		return 7;
+	} else if (name == "libc!puts") {
+		return 0x7f0012345678;
+	}
+
+	*ok    = false;
+	*error = ExpressionError(ExpressionError::UnknownVariable);
+	return 0;
+}
+
+// memory holds its own address plus one, below 0x10000
+edb::address_t getValue(edb::address_t address, bool *ok, ExpressionError *error) {
+	*ok = address < 0x10000;
+	if (!*ok) {
+		*error = ExpressionError(ExpressionError::CannotReadMemory);
+		return 0;
+	}
+	return address + 1;
+}
+
+std::optional<CompiledExpression::Variable> resolve(const QString &name, ExpressionError *error) {
+	bool ok;
+	const edb::address_t value = getVariable(name, &ok, error);
+	if (!ok) {
+		return {};
+	}
+
+	CompiledExpression::Variable variable;
+	variable.kind  = CompiledExpression::Variable::Constant;
+	variable.value = value;
+	return variable;
+}
+
+// registers are numbered rN and hold 0x100 * N, except for "big" which doesn't
+// fit in an address
+uint64_t registers[8];
+int resolved = 0;
+
+void resetRegisters() {
+	for (std::size_t i = 0; i < 8; ++i) {
+		registers[i] = 0x100 * i;
+	}
+}
+
+std::optional<CompiledExpression::Variable> resolveRegister(const QString &name, ExpressionError *error) {
+	++resolved;
+
+	CompiledExpression::Variable variable;
+	if (name.size() == 2 && name[0] == 'r' && name[1] >= '0' && name[1] <= '7') {
+		variable.kind  = CompiledExpression::Variable::GpRegister;
+		variable.value = name[1].digitValue();
+		return variable;
+	} else if (name == "ip") {
+		variable.kind = CompiledExpression::Variable::InstructionPointer;
+		return variable;
+	} else if (name == "flags") {
+		variable.kind = CompiledExpression::Variable::Flags;
+		return variable;
+	} else if (name == "big") {
+		variable.kind = CompiledExpression::Variable::NamedRegister;
+		variable.name = name;
+		return variable;
+	}
+
+	return resolve(name, error);
+}
+
+edb::address_t readRegister(const CompiledExpression::Variable &variable, bool *ok, ExpressionError *error) {
+	*ok = true;
+	switch (variable.kind) {
+	case CompiledExpression::Variable::GpRegister:
+		return registers[variable.value.toUint()];
+	case CompiledExpression::Variable::InstructionPointer:
+		return 0x401000;
+	case CompiledExpression::Variable::Flags:
+		return 0x246;
+	default:
+		*ok    = false;
+		*error = ExpressionError(ExpressionError::VariableLargerThanAddress);
+		return 0;
+	}
+}
+
+// the compiled form must agree with the interpreter, errors included
+void testAgreement(const char *text) {
+	const QString expression = QString::fromLatin1(text);
+
+	Expression<edb::address_t> interpreted(expression, getVariable, getValue);
+	const Result<edb::address_t, ExpressionError> expected = interpreted.evaluate();
+
+	State state;
+	Result<edb::address_t, ExpressionError> actual = make_unexpected(ExpressionError());
+	if (const Result<CompiledExpression, ExpressionError> compiled = CompiledExpression::compile(expression, resolve)) {
+		actual = compiled->evaluate(state, getValue);
+	} else {
+		actual = make_unexpected(compiled.error());
+	}
+
+	if (static_cast<bool>(expected) != static_cast<bool>(actual)) {
+		fprintf(stderr, "mismatch: %s\n", text);
+	}
+
+	TEST(static_cast<bool>(expected) == static_cast<bool>(actual));
+	if (expected) {
+		TEST(*expected == *actual);
+	} else {
+		TEST(QString(expected.error().what()) == QString(actual.error().what()));
+	}
+}
+
+void testExpressions() {
+	const char *const expressions[] = {
+		"1",
+		"0x10 + 0x20",
+		"1 + 2 * 3",
+		"(1 + 2) * 3",
+		"10 - 3 - 2",
+		"100 / 7 % 5",
+		"1 << 4 >> 2",
+		"a + b",
+		"a == 0x1000 && b != 7",
+		"a == 0x1000 || b != 7",
+		"a < b",
+		"a >= b",
+		"-1",
+		"~0",
+		"!b",
+		"!0",
+		"+b",
+		"[a]",
+		"[a + 8] - 9 == a",
+		"[[a]]",
+		"[a] == 0x1001 && b > 2",
+		"libc!puts",
+		"\"libc!puts\" & 0xffff",
+		"a ^ b | 3 & 1",
+		"b /0",
+		"b % 0",
+		"[0x100000]",
+		"unknown + 1",
+		"(1 + 2",
+		"1 + 2)",
+		"[a",
+		"a]",
+		"1 2",
+		"1 +",
+		"a = b",
+		"",
+		"0x1z",
+		"--1",
+	};
+
+	for (const char *expression : expressions) {
+		testAgreement(expression);
+	}
+}
+
+void testRegisters() {
+	resetRegisters();
+	resolved = 0;
+
+	const Result<CompiledExpression, ExpressionError> compiled = CompiledExpression::compile("r3 + r5 * 2 + a", resolveRegister);
+	TEST(compiled);
+	TEST(resolved == 3);
+
+	// registers are read when the expression is evaluated, not when it is compiled
+	Result<edb::address_t, ExpressionError> value = compiled->evaluate(readRegister, getValue);
+	TEST(value && *value == 0x300 + 0x500 * 2 + 0x1000);
+
+	registers[5] = 1;
+	value        = compiled->evaluate(readRegister, getValue);
+	TEST(value && *value == 0x300 + 2 + 0x1000);
+	TEST(resolved == 3);
+
+	value = CompiledExpression::compile("ip == 0x401000 && (flags & 0x40) != 0", resolveRegister)->evaluate(readRegister, getValue);
+	TEST(value && *value == 1);
+
+	// a register which can't be read is an error at evaluation time
+	const Result<CompiledExpression, ExpressionError> big = CompiledExpression::compile("big + 1", resolveRegister);
+	TEST(big);
+	value = big->evaluate(readRegister, getValue);
+	TEST(!value && QString(value.error().what()) == ExpressionError(ExpressionError::VariableLargerThanAddress).what());
+
+	value = big->evaluate(CompiledExpression::RegisterReader(), getValue);
+	TEST(!value && QString(value.error().what()) == ExpressionError(ExpressionError::UnknownVariable).what());
+}
+
+int reads = 0;
+
+edb::address_t countingGetValue(edb::address_t address, bool *ok, ExpressionError *error) {
+	++reads;
+	return getValue(address, ok, error);
+}
+
+void testDereference() {
+	resetRegisters();
+
+	const Result<CompiledExpression, ExpressionError> compiled = CompiledExpression::compile("[r3 + 8] + [[r1]]", resolveRegister);
+	TEST(compiled);
+
+	// one read for [r3 + 8] and two for [[r1]], every time
+	reads = 0;
+	Result<edb::address_t, ExpressionError> value = compiled->evaluate(readRegister, countingGetValue);
+	TEST(value && *value == 0x309 + 0x102);
+	TEST(reads == 3);
+
+	value = compiled->evaluate(readRegister, countingGetValue);
+	TEST(value && *value == 0x309 + 0x102);
+	TEST(reads == 6);
+
+	// the address comes from the register's current value
+	registers[3] = 0x2000;
+	value        = compiled->evaluate(readRegister, countingGetValue);
+	TEST(value && *value == 0x2009 + 0x102);
+
+	registers[3] = 0x100000;
+	value        = compiled->evaluate(readRegister, countingGetValue);
+	TEST(!value && QString(value.error().what()) == ExpressionError(ExpressionError::CannotReadMemory).what());
+
+	value = compiled->evaluate(readRegister, CompiledExpression::MemoryReader());
+	TEST(!value && QString(value.error().what()) == ExpressionError(ExpressionError::CannotReadMemory).what());
+}
+
+void testHotLoop() {
+	const Result<CompiledExpression, ExpressionError> compiled = CompiledExpression::compile("[a] == 0 && b == 3", resolve);
+	TEST(compiled);
+
+	State state;
+	for (int i = 0; i < 1000000; ++i) {
+		const Result<edb::address_t, ExpressionError> value = compiled->evaluate(state, getValue);
+		TEST(value && *value == 0);
+	}
+}
+
+}
+
+int main() {
+	testExpressions();
+	testRegisters();
+	testDereference();
+	testHotLoop();
+}
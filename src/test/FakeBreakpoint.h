@@ -0,0 +1,53 @@
+#ifndef FAKE_BREAKPOINT_H_20201016_
+#define FAKE_BREAKPOINT_H_20201016_
+
+#include "IBreakpoint.h"
+#include <memory>
+#include <vector>
+
+class FakeBreakpoint final : public IBreakpoint {
+public:
+	FakeBreakpoint(edb::address_t address, size_t size)
+		: address_(address), bytes_(size) {
+		for (size_t i = 0; i < size; ++i) {
+			bytes_[i] = static_cast<uint8_t>(address + i);
+		}
+	}
+
+public:
+	edb::address_t address() const override { return address_; }
+	uint64_t hitCount() const override { return 0; }
+	bool enabled() const override { return true; }
+	bool oneTime() const override { return false; }
+	bool internal() const override { return false; }
+	const uint8_t *originalBytes() const override { return bytes_.data(); }
+	size_t size() const override { return bytes_.size(); }
+	TypeId type() const override { return TypeId::Automatic; }
+
+public:
+	bool enable() override { return true; }
+	bool disable() override { return true; }
+	void hit() override {}
+	void setOneTime(bool) override {}
+	void setInternal(bool) override {}
+	void setType(TypeId) override {}
+
+private:
+	edb::address_t address_;
+	std::vector<uint8_t> bytes_;
+};
+
+// what PlatformProcess::readBytes used to do, visit every single breakpoint
+inline void restoreLinear(const std::vector<std::unique_ptr<FakeBreakpoint>> &breakpoints, edb::address_t address, uint8_t *ptr, size_t len) {
+	for (const auto &bp : breakpoints) {
+		const uint8_t *bpBytes      = bp->originalBytes();
+		const edb::address_t bpAddr = bp->address();
+		for (size_t i = 0; i < bp->size(); ++i) {
+			if (bpAddr + i >= address && bpAddr + i < address + len) {
+				ptr[bpAddr + i - address] = bpBytes[i];
+			}
+		}
+	}
+}
+
+#endif
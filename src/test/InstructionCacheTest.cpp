@@ -0,0 +1,67 @@
+
+#include "InstructionCache.h"
+#include <cstdio>
+#include <cstdlib>
+
+#define TEST(expr)                                                  \
+	do {                                                            \
+		if (!(expr)) {                                              \
+			fprintf(stderr, "FAILED: [@%d] %s\n", __LINE__, #expr); \
+			abort();                                                \
+		}                                                           \
+	} while (0)
+
+#if defined(EDB_X86) || defined(EDB_X86_64)
+namespace {
+
+void testLookup() {
+	InstructionCache cache;
+
+	// call 0x1005; jne 0x1000; ret
+	uint8_t code[] = {0xe8, 0x00, 0x00, 0x00, 0x00, 0x75, 0xf9, 0xc3};
+
+	InstructionCache::Entry call = cache.lookup(0x1000, code, code + sizeof(code));
+	TEST(call.valid && call.size == 5);
+	TEST(call.flow == InstructionCache::Flow::Call);
+	TEST(call.hasTarget && call.target == 0x1005);
+	TEST(call.operandCount == 1 && call.immediateOperands == 1);
+
+	const InstructionCache::Entry jne = cache.lookup(0x1005, code + 5, code + sizeof(code));
+	TEST(jne.flow == InstructionCache::Flow::ConditionalJump && jne.target == 0x1000);
+
+	const InstructionCache::Entry ret = cache.lookup(0x1007, code + 7, code + sizeof(code));
+	TEST(ret.size == 1 && ret.flow == InstructionCache::Flow::Return && !ret.hasTarget);
+	TEST(cache.statistics().misses == 3 && cache.statistics().hits == 0);
+
+	// the same bytes at the same address are a hit, even with less after them
+	call = cache.lookup(0x1000, code, code + 5);
+	TEST(call.flow == InstructionCache::Flow::Call);
+	TEST(cache.statistics().hits == 1);
+
+	// different bytes aren't
+	code[1] = 0x10;
+	call    = cache.lookup(0x1000, code, code + sizeof(code));
+	TEST(call.target == 0x1015);
+	TEST(cache.statistics().hits == 1 && cache.statistics().misses == 4);
+
+	// bytes which don't decode have to be seen with all of the same bytes
+	const uint8_t truncated[] = {0xe8, 0x00};
+	TEST(!cache.lookup(0x2000, truncated, truncated + 2).valid);
+	TEST(cache.lookup(0x2000, code, code + sizeof(code)).valid);
+
+	// anything which overlaps a write is forgotten
+	cache.invalidate(0x1006, 1);
+	cache.lookup(0x1000, code, code + sizeof(code));
+	cache.lookup(0x1005, code + 5, code + sizeof(code));
+	TEST(cache.statistics().hits == 2);
+}
+
+}
+#endif
+
+int main() {
+#if defined(EDB_X86) || defined(EDB_X86_64)
+	CapstoneEDB::init(CapstoneEDB::Architecture::ARCH_AMD64);
+	testLookup();
+#endif
+}
@@ -0,0 +1,100 @@
+#include "InstructionIndex.h"
+#include "Instruction.h"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#define TEST(expr)                                                  \
+	do {                                                            \
+		if (!(expr)) {                                              \
+			fprintf(stderr, "FAILED: [@%d] %s\n", __LINE__, #expr); \
+			abort();                                                \
+		}                                                           \
+	} while (0)
+
+#if defined(EDB_X86) || defined(EDB_X86_64)
+namespace {
+
+const edb::address_t Base = 0x400000;
+
+InstructionIndex::ReadFunction reader(const QByteArray &bytes) {
+	return [&bytes](std::size_t offset, std::size_t size) {
+		return bytes.mid(static_cast<int>(offset), static_cast<int>(size));
+	};
+}
+
+void testPrevious() {
+	InstructionIndex::Boundaries boundaries(Base, 200);
+	boundaries.set(0);
+	boundaries.set(63);
+	boundaries.set(64);
+	boundaries.set(190);
+
+	TEST(!boundaries.previous(0));
+	TEST(*boundaries.previous(1) == 0);
+	TEST(*boundaries.previous(63) == 0);
+	TEST(*boundaries.previous(64) == 63);
+	TEST(*boundaries.previous(65) == 64);
+	TEST(*boundaries.previous(190) == 64);
+	TEST(*boundaries.previous(200) == 190);
+
+	boundaries.reset(0);
+	TEST(!boundaries.previous(63));
+}
+
+void testSweep() {
+
+	// push rbp; mov rbp, rsp; nop; ret
+	const QByteArray code("\x55\x48\x89\xe5\x90\xc3", 6);
+
+	std::shared_ptr<InstructionIndex::Boundaries> boundaries = InstructionIndex::sweep(code, Base, {});
+	TEST(boundaries->test(0) && boundaries->test(1) && boundaries->test(4) && boundaries->test(5));
+	TEST(!boundaries->test(2) && !boundaries->test(3));
+
+	// starting again at a known function puts the sweep back in step
+	boundaries = InstructionIndex::sweep(code, Base, {Base + 2});
+	TEST(boundaries->test(0) && boundaries->test(1) && boundaries->test(2));
+	TEST(!boundaries->test(3));
+}
+
+void testResweep() {
+
+	// patching random bytes and then sweeping again around them has to give
+	// the same index as sweeping the whole thing from scratch
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<int> byte(0, 255);
+
+	QByteArray code(0x3000, '\0');
+	for (char &ch : code) {
+		ch = static_cast<char>(byte(rng));
+	}
+
+	std::shared_ptr<InstructionIndex::Boundaries> boundaries = InstructionIndex::sweep(code, Base, {});
+
+	std::uniform_int_distribution<int> where(0, code.size() - 1);
+	std::uniform_int_distribution<int> length(1, 16);
+
+	for (int i = 0; i < 500; ++i) {
+		const std::size_t first = static_cast<std::size_t>(where(rng));
+		const std::size_t last  = std::min<std::size_t>(first + static_cast<std::size_t>(length(rng)), static_cast<std::size_t>(code.size()));
+
+		for (std::size_t offset = first; offset < last; ++offset) {
+			code[static_cast<int>(offset)] = static_cast<char>(byte(rng));
+		}
+
+		InstructionIndex::resweep(boundaries.get(), first, last, reader(code));
+		TEST(boundaries->bits == InstructionIndex::sweep(code, Base, {})->bits);
+	}
+}
+
+}
+#endif
+
+int main() {
+#if defined(EDB_X86) || defined(EDB_X86_64)
+	CapstoneEDB::init(CapstoneEDB::Architecture::ARCH_AMD64);
+	testPrevious();
+	testSweep();
+	testResweep();
+#endif
+}
@@ -0,0 +1,73 @@
+
+#include "StringExtractor.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define TEST(expr)                                                  \
+	do {                                                            \
+		if (!(expr)) {                                              \
+			fprintf(stderr, "FAILED: [@%d] %s\n", __LINE__, #expr); \
+			abort();                                                \
+		}                                                           \
+	} while (0)
+
+namespace {
+
+std::vector<uint8_t> bytes(const char *s, size_t n) {
+	return std::vector<uint8_t>(s, s + n);
+}
+
+void testLength() {
+	const auto ascii = bytes("Hello,\tWorld!\r\n..and a long enough tail\x01xyz", 43);
+	TEST(StringExtractor::asciiLength(ascii.data(), ascii.size()) == 39);
+	TEST(StringExtractor::asciiLength(ascii.data(), 10) == 10);
+	TEST(StringExtractor::asciiLength(ascii.data() + 39, 4) == 0);
+
+	const auto utf16 = bytes("a\0b\0c\0d\0e\0f\0g\0h\0i\0\x7f\0\x80\0", 22);
+	TEST(StringExtractor::utf16Length(utf16.data(), utf16.size() / 2) == 10);
+	TEST(StringExtractor::utf16Length(utf16.data() + 1, (utf16.size() - 1) / 2) == 0);
+}
+
+void testExtract() {
+	StringExtractor extractor(4, 8);
+
+	const auto data = bytes("\0\0abc\0defghijklmno\0\0w\0x\0y\0z\0\xff", 29);
+
+	QVector<StringExtractor::Match> matches;
+	const std::size_t next = extractor.extract(data.data(), data.size(), data.size(), 0x1000, &matches);
+
+	// long strings are split at the maximum length
+	TEST(next == data.size());
+	TEST(matches.size() == 3);
+	TEST(matches[0].address == 0x1006 && matches[0].length == 8 && matches[0].encoding == StringExtractor::Encoding::Ascii);
+	TEST(matches[1].address == 0x100e && matches[1].length == 4 && matches[1].encoding == StringExtractor::Encoding::Ascii);
+	TEST(matches[2].address == 0x1014 && matches[2].length == 4 && matches[2].encoding == StringExtractor::Encoding::Utf16);
+
+	// strings starting before the limit may extend past it
+	matches.clear();
+	TEST(extractor.extract(data.data(), data.size(), 8, 0, &matches) == 14);
+	TEST(matches.size() == 1);
+
+	matches.clear();
+	extractor.setSearchUtf16(false);
+	extractor.extract(data.data(), data.size(), data.size(), 0, &matches);
+	TEST(matches.size() == 2);
+}
+
+void testToString() {
+	const auto data = bytes("a\"b\tc\n", 6);
+	TEST(StringExtractor::toString(data.data(), 6, StringExtractor::Encoding::Ascii) == QLatin1String("a\\\"b\\tc\\n"));
+
+	const auto utf16 = bytes("h\0i\0", 4);
+	TEST(StringExtractor::toString(utf16.data(), 2, StringExtractor::Encoding::Utf16) == QLatin1String("hi"));
+}
+
+}
+
+int main() {
+	testLength();
+	testExtract();
+	testToString();
+}
@@ -0,0 +1,114 @@
+#include "SymbolIndex.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#define TEST(expr)                                                  \
+	do {                                                            \
+		if (!(expr)) {                                              \
+			fprintf(stderr, "FAILED: [@%d] %s\n", __LINE__, #expr); \
+			abort();                                                \
+		}                                                           \
+	} while (0)
+
+namespace {
+
+void build(SymbolIndex *index) {
+	index->add("malloc");                // 0
+	index->add("__libc_malloc");         // 1
+	index->add("malloc_trim");           // 2
+	index->add("free");                  // 3
+	index->add("MallocExtension");       // 4
+	index->add("printf");                // 5
+	index->add("vfprintf");              // 6
+	index->add("pthread_mutex_lock");    // 7
+	index->add("pthread_mutex_unlock");  // 8
+	index->add("__pthread_mutex_lock");  // 9
+	index->build();
+}
+
+void testExactAndPrefix() {
+	SymbolIndex index;
+	build(&index);
+	TEST(index.size() == 10);
+
+	const std::vector<SymbolIndex::Result> results = index.search("malloc", 10);
+
+	// the name itself, then the ones starting with it regardless of case,
+	// then the ones containing it
+	TEST(results.size() == 4);
+	TEST(results[0].id == 0 && results[0].match == SymbolIndex::Match::Exact);
+	TEST(results[1].match == SymbolIndex::Match::Prefix);
+	TEST(results[2].match == SymbolIndex::Match::Prefix);
+	TEST((results[1].id == 2 && results[2].id == 4) || (results[1].id == 4 && results[2].id == 2));
+	TEST(results[3].id == 1 && results[3].match == SymbolIndex::Match::Substring);
+
+	TEST(index.search("MALLOC", 1).size() == 1);
+	TEST(index.search("malloc", 1)[0].id == 0);
+	TEST(index.search("", 10).empty());
+}
+
+void testSubstring() {
+	SymbolIndex index;
+	build(&index);
+
+	// short queries can't use the trigrams
+	const std::vector<SymbolIndex::Result> short_results = index.search("nt", 10);
+	TEST(short_results.size() == 2);
+	TEST(short_results[0].id == 5 && short_results[1].id == 6);
+
+	// shorter names first
+	const std::vector<SymbolIndex::Result> results = index.search("mutex_lock", 10);
+	TEST(results.size() >= 2);
+	TEST(results[0].id == 7 && results[0].match == SymbolIndex::Match::Substring);
+	TEST(results[1].id == 9 && results[1].match == SymbolIndex::Match::Substring);
+}
+
+void testFuzzy() {
+	SymbolIndex index;
+	build(&index);
+
+	// a typo still finds the names that look like it
+	const std::vector<SymbolIndex::Result> results = index.search("pthread_mutx_lock", 10);
+	TEST(!results.empty());
+	TEST(results[0].id == 7 && results[0].match == SymbolIndex::Match::Fuzzy);
+
+	for (const SymbolIndex::Result &result : results) {
+		TEST(result.id != 3 && result.id != 5);
+	}
+
+	TEST(index.search("zzzz", 10).empty());
+}
+
+void testFilter() {
+	SymbolIndex index;
+	build(&index);
+
+	// the filter applies to every kind of match, and the rejected names don't
+	// count towards the limit
+	auto not_malloc = [](uint32_t id) { return id != 0; };
+	const std::vector<SymbolIndex::Result> prefix = index.search("malloc", 1, not_malloc);
+	TEST(prefix.size() == 1);
+	TEST(prefix[0].id != 0 && prefix[0].match == SymbolIndex::Match::Prefix);
+
+	const std::vector<SymbolIndex::Result> substring = index.search("mutex_lock", 10, [](uint32_t id) { return id == 9; });
+	TEST(substring.size() == 1);
+	TEST(substring[0].id == 9 && substring[0].match == SymbolIndex::Match::Substring);
+
+	const std::vector<SymbolIndex::Result> fuzzy = index.search("pthread_mutx_lock", 10, [](uint32_t id) { return id != 7; });
+	TEST(!fuzzy.empty());
+	for (const SymbolIndex::Result &result : fuzzy) {
+		TEST(result.id != 7);
+	}
+
+	TEST(index.search("malloc", 10, [](uint32_t) { return false; }).empty());
+}
+
+}
+
+int main() {
+	testExactAndPrefix();
+	testSubstring();
+	testFuzzy();
+	testFilter();
+}
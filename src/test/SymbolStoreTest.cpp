@@ -0,0 +1,95 @@
+#include "SymbolStore.h"
+#include <QFile>
+#include <QTemporaryDir>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#define TEST(expr)                                                  \
+	do {                                                            \
+		if (!(expr)) {                                              \
+			fprintf(stderr, "FAILED: [@%d] %s\n", __LINE__, #expr); \
+			abort();                                                \
+		}                                                           \
+	} while (0)
+
+namespace {
+
+SymbolStore::Record record(edb::address_t address, uint32_t size, char type, const char *name) {
+	SymbolStore::Record r;
+	r.address = address;
+	r.size    = size;
+	r.type    = type;
+	r.name    = QString::fromUtf8(name);
+	return r;
+}
+
+void testRoundTrip(const QString &filename) {
+
+	const QByteArray md5 = QByteArray::fromHex("00112233445566778899aabbccddeeff");
+
+	std::vector<SymbolStore::Record> records;
+	records.push_back(record(0x3000, 0x10, 'T', "main"));
+	records.push_back(record(0x1000, 0x20, 'T', "_start"));
+	records.push_back(record(0x2000, 0x08, 'D', "data"));
+	records.push_back(record(0x4000, 0x10, 'P', "exit@plt"));
+	records.push_back(record(0x5000, 0x04, 'D', "data"));
+	records.push_back(record(0x6000, 0x04, 'T', "\xc3\xbcnicode"));
+
+	TEST(SymbolStore::write(filename, "/usr/bin/test", md5, records));
+
+	const std::shared_ptr<SymbolStore> store = SymbolStore::open(filename);
+	TEST(store);
+	TEST(store->size() == 6);
+	TEST(store->md5() == md5);
+	TEST(store->binary() == "/usr/bin/test");
+
+	// sorted by address
+	TEST(store->address(0) == 0x1000 && store->name(0) == "_start");
+	TEST(store->address(2) == 0x3000 && store->name(2) == "main");
+	TEST(store->symbolSize(2) == 0x10 && store->type(2) == 'T');
+
+	TEST(store->upperBound(0, store->size(), 0x2fff) == 2);
+	TEST(store->upperBound(0, store->size(), 0x3000) == 3);
+	TEST(store->lowerBound(0, store->size(), 0x3000) == 2);
+	TEST(store->lowerBound(0, store->size(), 0x7000) == 6);
+
+	TEST(*store->find("main") == 2);
+	TEST(*store->find("exit@plt") == 3);
+	TEST(*store->find(QString::fromUtf8("\xc3\xbcnicode").toUtf8()) == 5);
+	TEST(!store->find("mai"));
+	TEST(!store->find(""));
+
+	// the last one wins
+	TEST(*store->find("data") == 4);
+}
+
+void testEmpty(const QString &filename) {
+	TEST(SymbolStore::write(filename, "/usr/bin/empty", QByteArray(), {}));
+
+	const std::shared_ptr<SymbolStore> store = SymbolStore::open(filename);
+	TEST(store);
+	TEST(store->size() == 0);
+	TEST(!store->find("main"));
+}
+
+void testCorrupt(const QString &filename) {
+	QFile file(filename);
+	TEST(file.open(QIODevice::WriteOnly));
+	file.write("000000000000000000000000000000000000000000000000");
+	file.close();
+
+	TEST(!SymbolStore::open(filename));
+	TEST(!SymbolStore::open(filename + ".missing"));
+}
+
+}
+
+int main() {
+	QTemporaryDir dir;
+	TEST(dir.isValid());
+
+	testRoundTrip(dir.filePath("test.sym"));
+	testEmpty(dir.filePath("empty.sym"));
+	testCorrupt(dir.filePath("corrupt.sym"));
+}
@@ -0,0 +1,253 @@
+#include "IRegion.h"
+#include "Instruction.h"
+#include "Trampoline.h"
+#include <QString>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define TEST(expr)                                                  \
+	do {                                                            \
+		if (!(expr)) {                                              \
+			fprintf(stderr, "FAILED: [@%d] %s\n", __LINE__, #expr); \
+			abort();                                                \
+		}                                                           \
+	} while (0)
+
+using DebuggerCorePlugin::Trampoline;
+using DebuggerCorePlugin::TrampolineArena;
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+// lea rsp, [rsp - 128]; pushfq; push rax; push rcx
+const Bytes Prologue = {0x48, 0x8d, 0x64, 0x24, 0x80, 0x9c, 0x50, 0x51};
+
+// pop rcx; pop rax; popfq; lea rsp, [rsp + 128]
+const Bytes Epilogue = {0x59, 0x58, 0x9d, 0x48, 0x8d, 0xa4, 0x24, 0x80, 0x00, 0x00, 0x00};
+
+// mov eax, 1
+const Bytes Displaced = {0xb8, 0x01, 0x00, 0x00, 0x00};
+
+constexpr uint64_t Resume = 0x401005;
+
+Bytes operator+(Bytes lhs, const Bytes &rhs) {
+	lhs.insert(lhs.end(), rhs.begin(), rhs.end());
+	return lhs;
+}
+
+Bytes rel32(uint32_t value) {
+	return {static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 24)};
+}
+
+Bytes imm64(uint64_t value) {
+	return rel32(static_cast<uint32_t>(value)) + rel32(static_cast<uint32_t>(value >> 32));
+}
+
+// mov rcx, imm64
+Bytes loadRcx(uint64_t value) {
+	return Bytes{0x48, 0xb9} + imm64(value);
+}
+
+// cmp rax, rcx
+const Bytes Compare = {0x48, 0x39, 0xc8};
+
+// everything after the comparisons: the epilogue and trap, the jump over
+// the second epilogue, then the displaced instruction and the jump back
+Bytes tail() {
+	return Epilogue + Bytes{0xcc} + Bytes{0xe9} + rel32(static_cast<uint32_t>(Epilogue.size())) + Epilogue + Displaced + Bytes{0xff, 0x25} + rel32(0) + imm64(Resume);
+}
+
+std::optional<Trampoline> assemble(const char *condition) {
+	return Trampoline::assemble(QString::fromLatin1(condition), Displaced, Resume);
+}
+
+// the code which loads rax and rcx for the first comparison
+Bytes firstLoads(const Trampoline &trampoline, std::size_t size) {
+	return Bytes(trampoline.code().begin() + Prologue.size(), trampoline.code().begin() + Prologue.size() + size);
+}
+
+void testDisplacedLength() {
+
+	// sub rsp, 0x100
+	const uint8_t sub[] = {0x48, 0x81, 0xec, 0x00, 0x01, 0x00, 0x00, 0xc3};
+	TEST(Trampoline::displacedLength(sub, sizeof(sub), 0x1000) == 7);
+	TEST(Trampoline::displacedLength(Displaced.data(), Displaced.size(), 0x1000) == 5);
+
+	// the jump would overwrite the start of the instruction after mov rbp, rsp
+	const uint8_t mov[] = {0x48, 0x89, 0xe5, 0x48, 0x81, 0xec, 0x00, 0x01, 0x00, 0x00};
+	TEST(Trampoline::displacedLength(mov, sizeof(mov), 0x1000) == 0);
+
+	// call rel32 and mov rax, [rip] behave differently somewhere else
+	const uint8_t call[] = {0xe8, 0x00, 0x00, 0x00, 0x00};
+	TEST(Trampoline::displacedLength(call, sizeof(call), 0x1000) == 0);
+
+	const uint8_t rip[] = {0x48, 0x8b, 0x05, 0x00, 0x00, 0x00, 0x00};
+	TEST(Trampoline::displacedLength(rip, sizeof(rip), 0x1000) == 0);
+
+	TEST(Trampoline::displacedLength(sub, 4, 0x1000) == 0);
+}
+
+void testLayout() {
+
+	const std::optional<Trampoline> trampoline = assemble("rdi == 5");
+	TEST(trampoline);
+
+	// mov rax, rdi; mov rcx, 5; cmp rax, rcx; jne resume
+	const Bytes expected = Prologue + Bytes{0x48, 0x89, 0xf8} + loadRcx(5) + Compare + Bytes{0x0f, 0x85} + rel32(static_cast<uint32_t>(Epilogue.size() + 1 + 5)) + tail();
+	TEST(trampoline->code() == expected);
+
+	// just past the int3, and at the copy of the displaced instruction
+	const std::size_t trap = Prologue.size() + 3 + 10 + 3 + 6 + Epilogue.size() + 1;
+	TEST(trampoline->trapOffset() == trap);
+	TEST(trampoline->displacedOffset() == trap + 5 + Epilogue.size());
+	TEST(std::memcmp(trampoline->code().data() + trampoline->displacedOffset(), Displaced.data(), Displaced.size()) == 0);
+}
+
+void testDisjunction() {
+
+	const std::optional<Trampoline> trampoline = assemble("rdi == 1 || rsi == 2");
+	TEST(trampoline);
+
+	// each comparison jumps to the trap when it holds, falling through both
+	// jumps to the resume path
+	const Bytes first  = Bytes{0x48, 0x89, 0xf8} + loadRcx(1) + Compare + Bytes{0x0f, 0x84} + rel32(22 + 5);
+	const Bytes second = Bytes{0x48, 0x89, 0xf0} + loadRcx(2) + Compare + Bytes{0x0f, 0x84} + rel32(5);
+	const Bytes resume = Bytes{0xe9} + rel32(static_cast<uint32_t>(Epilogue.size() + 1 + 5));
+	TEST(trampoline->code() == Prologue + first + second + resume + tail());
+}
+
+void testRegisters() {
+
+	// r8 and up need REX.R
+	std::optional<Trampoline> trampoline = assemble("r8 == r15");
+	TEST(trampoline);
+	TEST(firstLoads(*trampoline, 6) == (Bytes{0x4c, 0x89, 0xc0, 0x4c, 0x89, 0xf9}));
+
+	// rax and rcx come from where the prologue saved them, rsp from before
+	// the prologue moved it
+	trampoline = assemble("rcx == rsp");
+	TEST(trampoline);
+	TEST(firstLoads(*trampoline, 13) == (Bytes{0x48, 0x8b, 0x44, 0x24, 0x00, 0x48, 0x8d, 0x8c, 0x24, 0x98, 0x00, 0x00, 0x00}));
+
+	trampoline = assemble("rax != 0");
+	TEST(trampoline);
+	TEST(firstLoads(*trampoline, 5) == (Bytes{0x48, 0x8b, 0x44, 0x24, 0x08}));
+
+	// a lone operand is compared with zero
+	trampoline = assemble("rbx");
+	TEST(trampoline);
+	TEST(firstLoads(*trampoline, 13) == (Bytes{0x48, 0x89, 0xd8} + loadRcx(0)));
+}
+
+void testZeroExtension() {
+
+	// the 32-bit registers load all 64 bits and then clear the top half
+	std::optional<Trampoline> trampoline = assemble("edi == r9d");
+	TEST(trampoline);
+	TEST(firstLoads(*trampoline, 10) == (Bytes{0x48, 0x89, 0xf8, 0x89, 0xc0, 0x4c, 0x89, 0xc9, 0x89, 0xc9}));
+
+	trampoline = assemble("ecx == 1");
+	TEST(trampoline);
+	TEST(firstLoads(*trampoline, 7) == (Bytes{0x48, 0x8b, 0x44, 0x24, 0x00, 0x89, 0xc0}));
+}
+
+void testRejected() {
+	TEST(!assemble(""));
+	TEST(!assemble("rdi =="));
+	TEST(!assemble("rdi + 1 == 5"));
+	TEST(!assemble("[rdi] == 5"));
+	TEST(!assemble("rdi == 1 && rsi == 2 || rdx"));
+	TEST(!assemble("rdi == 1 || rsi == 2 && rdx"));
+	TEST(assemble("rdi == 1 && rsi == 2 && rdx"));
+}
+
+// just enough of a mapping for the arena to look at
+class Region : public IRegion {
+public:
+	Region(edb::address_t start, edb::address_t end, const QString &name)
+		: start_(start), end_(end), name_(name) {
+	}
+
+public:
+	IRegion *clone() const override { return new Region(start_, end_, name_); }
+	bool accessible() const override { return true; }
+	bool readable() const override { return true; }
+	bool writable() const override { return false; }
+	bool executable() const override { return true; }
+	size_t size() const override { return end_ - start_; }
+	void setPermissions(bool, bool, bool) override {}
+	void setStart(edb::address_t address) override { start_ = address; }
+	void setEnd(edb::address_t address) override { end_ = address; }
+	edb::address_t start() const override { return start_; }
+	edb::address_t end() const override { return end_; }
+	edb::address_t base() const override { return start_; }
+	QString name() const override { return name_; }
+	permissions_t permissions() const override { return 0; }
+
+private:
+	edb::address_t start_;
+	edb::address_t end_;
+	QString name_;
+};
+
+void testUnmappedCave() {
+
+	// how much code each library has, the cave starts 16 bytes after it
+	std::size_t codeSize = 0x800;
+	int lookups          = 0;
+
+	TrampolineArena arena([&codeSize, &lookups](const std::shared_ptr<IRegion> &region) {
+		++lookups;
+		return region->start() + codeSize;
+	});
+
+	auto first  = std::make_shared<Region>(0x400000, 0x401000, QString::fromLatin1("/lib/first.so"));
+	auto second = std::make_shared<Region>(0x500000, 0x501000, QString::fromLatin1("/lib/second.so"));
+
+	TEST(arena.allocate(1, {first}, 0x400100, 0x40) == 0x400810);
+	TEST(arena.allocate(1, {first}, 0x400200, 0x40) == 0x400850);
+	TEST(arena.allocate(1, {second}, 0x500100, 0x40) == 0x500810);
+	TEST(lookups == 2);
+
+	arena.addTrap(0x40082a, 0x400100);
+	arena.addTrap(0x40086a, 0x400200);
+	arena.addTrap(0x50082a, 0x500100);
+
+	// unmapping the first library loses both of its trampolines, but not the
+	// one in the second
+	std::vector<edb::address_t> sites = arena.removeRegions({first});
+	std::sort(sites.begin(), sites.end());
+	TEST(sites == (std::vector<edb::address_t>{0x400100, 0x400200}));
+	TEST(!arena.siteForTrap(0x40082a));
+	TEST(!arena.siteForTrap(0x40086a));
+	TEST(arena.siteForTrap(0x50082a) == edb::address_t(0x500100));
+
+	// something else mapped at the same address has its own cave
+	codeSize   = 0xf00;
+	auto third = std::make_shared<Region>(0x400000, 0x401000, QString::fromLatin1("/lib/third.so"));
+	TEST(arena.allocate(1, {third}, 0x400100, 0x40) == 0x400f10);
+	TEST(lookups == 3);
+
+	// until it is full
+	TEST(arena.allocate(1, {third}, 0x400100, 0xc0) == 0);
+	TEST(arena.removeRegions({third}).empty());
+}
+
+}
+
+int main() {
+#if defined(EDB_X86_64)
+	CapstoneEDB::init(CapstoneEDB::Architecture::ARCH_AMD64);
+	testDisplacedLength();
+	testLayout();
+	testDisjunction();
+	testRegisters();
+	testZeroExtension();
+	testRejected();
+	testUnmappedCave();
+#endif
+}
@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "QDisassemblyView.h"
+#include "AnnotationCache.h"
 #include "ArchProcessor.h"
 #include "Configuration.h"
 #include "Function.h"
@@ -27,6 +28,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "ISymbolManager.h"
 #include "IThread.h"
 #include "Instruction.h"
+#include "InstructionCache.h"
+#include "InstructionIndex.h"
 #include "MemoryRegions.h"
 #include "SessionManager.h"
 #include "State.h"
@@ -115,9 +118,8 @@ bool near_line(int x, int linex) {
 // Name:
 // Desc:
 //------------------------------------------------------------------------------
-int instruction_size(const uint8_t *buffer, std::size_t size) {
-	edb::Instruction inst(buffer, buffer + size, 0);
-	return inst.byteSize();
+int instruction_size(edb::address_t address, const uint8_t *buffer, std::size_t size) {
+	return edb::v1::instruction_cache().lookup(address, buffer, buffer + size).size;
 }
 
 //------------------------------------------------------------------------------
@@ -176,6 +178,11 @@ QDisassemblyView::QDisassemblyView(QWidget *parent)
 	setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
 
 	connect(verticalScrollBar(), &QScrollBar::actionTriggered, this, &QDisassemblyView::scrollbarActionTriggered);
+
+	// the comments column shows placeholders until the real ones are known
+	connect(&edb::v1::annotation_cache(), &AnnotationCache::updated, viewport(), [this]() {
+		viewport()->update();
+	});
 }
 
 //------------------------------------------------------------------------------
@@ -273,14 +280,21 @@ void QDisassemblyView::keyPressEvent(QKeyEvent *event) {
 //------------------------------------------------------------------------------
 int QDisassemblyView::previousInstruction(IAnalyzer *analyzer, int current_address) {
 
-	// If we have an analyzer, and the current address is within a function
-	// then first we find the begining of that function.
+	// The index of where every instruction in the region starts gives an
+	// exact answer, but it takes a moment to build the first time around.
+	//
+	// Failing that, if we have an analyzer, and the current address is within
+	// a function then first we find the begining of that function.
 	// Then, we attempt to disassemble from there until we run into
 	// the address we were on (stopping one instruction early).
 	// this allows us to identify with good accuracy where the
 	// previous instruction was making upward scrolling more functional.
 	//
 	// If all else fails, fall back on the old heuristic which works "ok"
+	if (const std::optional<edb::address_t> address = edb::v1::instruction_index().previousInstruction(region_, addressOffset_ + current_address)) {
+		return static_cast<int>((*address - addressOffset_).toUint());
+	}
+
 	if (analyzer) {
 		edb::address_t address = addressOffset_ + current_address;
 
@@ -290,30 +304,30 @@ int QDisassemblyView::previousInstruction(IAnalyzer *analyzer, int current_addre
 			if (address != *function_address) {
 				edb::address_t function_start = *function_address;
 
-				// disassemble from function start until the NEXT address is where we started
-				while (true) {
-					uint8_t buf[edb::Instruction::MaxSize];
+				// read everything from the function start up to where we are
+				// in one go, plus enough to finish decoding the last instruction
+				std::vector<uint8_t> code((address - function_start).toUint() + edb::Instruction::MaxSize);
+				std::size_t code_size = code.size();
 
-					size_t buf_size = sizeof(buf);
-					if (region_) {
-						buf_size = std::min<size_t>((function_start - region_->base()), sizeof(buf));
-					}
+				if (edb::v1::get_instruction_bytes(function_start, code.data(), &code_size)) {
+					const uint8_t *p         = code.data();
+					const uint8_t *const end = code.data() + code_size;
 
-					if (edb::v1::get_instruction_bytes(function_start, buf, &buf_size)) {
-						const edb::Instruction inst(buf, buf + buf_size, function_start);
-						if (!inst) {
+					// disassemble from function start until the NEXT address is where we started
+					while (p < end) {
+						const InstructionCache::Entry inst = edb::v1::instruction_cache().lookup(function_start, p, end);
+						if (!inst.valid) {
 							break;
 						}
 
 						// if the NEXT address would be our target, then
 						// we are at the previous instruction!
-						if (function_start + inst.byteSize() >= current_address + addressOffset_) {
+						if (function_start + inst.size >= current_address + addressOffset_) {
 							break;
 						}
 
-						function_start += inst.byteSize();
-					} else {
-						break;
+						function_start += inst.size;
+						p += inst.size;
 					}
 				}
 
@@ -375,8 +389,7 @@ int QDisassemblyView::followingInstruction(int current_address) {
 	if (!edb::v1::get_instruction_bytes(addressOffset_ + current_address, buf, &buf_size)) {
 		return current_address + 1;
 	} else {
-		const edb::Instruction inst(buf, buf + buf_size, current_address);
-		return current_address + inst.byteSize();
+		return current_address + instruction_size(addressOffset_ + current_address, buf, buf_size);
 	}
 }
 
@@ -458,9 +471,16 @@ void QDisassemblyView::scrollbarActionTriggered(int action) {
 		verticalScrollBar()->setSliderPosition(address);
 	} break;
 
+	case QAbstractSlider::SliderMove: {
+		// keep the top line on an instruction boundary while dragging, if we know where they are
+		const edb::address_t address = addressOffset_ + verticalScrollBar()->sliderPosition();
+		if (const std::optional<edb::address_t> start = edb::v1::instruction_index().instructionStart(region_, address)) {
+			verticalScrollBar()->setSliderPosition(static_cast<int>((*start - addressOffset_).toUint()));
+		}
+	} break;
+
 	case QAbstractSlider::SliderToMinimum:
 	case QAbstractSlider::SliderToMaximum:
-	case QAbstractSlider::SliderMove:
 	case QAbstractSlider::SliderNoAction:
 	default:
 		break;
@@ -792,7 +812,7 @@ int QDisassemblyView::getSelectedLineNumber() const {
 // Name: drawHeaderAndBackground
 // Desc:
 //------------------------------------------------------------------------------
-void QDisassemblyView::drawHeaderAndBackground(QPainter &painter, const DrawingContext *ctx, const std::unique_ptr<IBinary> &binary_info) {
+void QDisassemblyView::drawHeaderAndBackground(QPainter &painter, const DrawingContext *ctx, const std::shared_ptr<IBinary> &binary_info) {
 
 	painter.save();
 
@@ -1199,9 +1219,12 @@ void QDisassemblyView::drawComments(QPainter &painter, const DrawingContext *ctx
 					}
 				}
 
-				QString string_param;
-				if (edb::v1::get_human_string_at_address(ascii_address, string_param)) {
-					annotation.append(string_param);
+				if (ascii_address != 0) {
+					annotation.append(edb::v1::annotation_cache().find(AnnotationCache::Kind::String, ascii_address, [](edb::address_t string_address) {
+						QString string_param;
+						edb::v1::get_human_string_at_address(string_address, string_param);
+						return string_param;
+					}));
 				}
 			}
 		}
@@ -1814,7 +1837,7 @@ Result<int, QString> QDisassemblyView::getInstructionSize(edb::address_t address
 		bool ok = edb::v1::get_instruction_bytes(address, buf, size);
 
 		if (ok) {
-			return instruction_size(buf, *size);
+			return instruction_size(address, buf, *size);
 		}
 	}
 
@@ -1909,8 +1932,8 @@ bool QDisassemblyView::event(QEvent *event) {
 				// do the longest read we can while still not passing the region end
 				size_t buf_size = std::min<edb::address_t>((region_->end() - address), sizeof(buf));
 				if (edb::v1::get_instruction_bytes(address, buf, &buf_size)) {
-					const edb::Instruction inst(buf, buf + buf_size, address);
-					const QString byte_buffer = format_instruction_bytes(inst);
+					const int size            = instruction_size(address, buf, buf_size);
+					const QString byte_buffer = edb::v1::format_bytes(buf, size);
 
 					if ((line2() + byte_buffer.size() * fontWidth_) > line3()) {
 						QToolTip::showText(helpEvent->globalPos(), byte_buffer);
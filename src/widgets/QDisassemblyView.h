@@ -131,7 +131,7 @@ private:
 	void updateSelectedAddress(QMouseEvent *event);
 
 	void drawInstruction(QPainter &painter, const edb::Instruction &inst, const DrawingContext *ctx, int y, bool selected);
-	void drawHeaderAndBackground(QPainter &painter, const DrawingContext *ctx, const std::unique_ptr<IBinary> &binary_info);
+	void drawHeaderAndBackground(QPainter &painter, const DrawingContext *ctx, const std::shared_ptr<IBinary> &binary_info);
 	void drawRegiserBadges(QPainter &painter, DrawingContext *ctx);
 	void drawSymbolNames(QPainter &painter, const DrawingContext *ctx);
 	void drawSidebarElements(QPainter &painter, const DrawingContext *ctx);